@@ -0,0 +1,256 @@
+// The Strawberry Programming Language Toolchain.
+// Copyright (c) 2026 Lua (TeamPuzel)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <ostream>
+#include <print>
+#include <string_view>
+#include <utility>
+#include "primitive.hpp"
+
+/// Allocation accounting, attributing every allocation to the compiler phase which made it.
+///
+/// It is opt-in at build time. `make build-alloc` defines `STRC_ALLOC_STATS`, which replaces the global
+/// `operator new` and `operator delete` in `main.cpp` and prints a table of every phase when strc exits.
+/// Otherwise phase tags compile to nothing and the allocator is left alone.
+namespace str::alloc {
+    /// The phases allocations are attributed to. Anything outside of a tagged scope is `Other`.
+    enum class Phase : u8 {
+        Other,
+        Tokenize,
+        Parse,
+        Evaluate,
+        Diagnostics
+    };
+
+    inline constexpr usize PHASE_COUNT = 5;
+
+    inline constexpr auto PHASE_NAMES = std::to_array<std::string_view>({
+        "other", "tokenize", "parse", "evaluate", "diagnostics"
+    });
+
+#if defined(STRC_ALLOC_STATS)
+    namespace detail {
+        /// Precedes every allocation, so a free is attributed to the phase which allocated the memory
+        /// no matter which thread or phase it happens in.
+        struct alignas(16) Header final {
+            u64 size;
+            u32 offset;
+            Phase phase;
+        };
+
+        static_assert(sizeof(Header) == 16);
+
+        /// Live bytes are only published once a thread's balance for a phase drifts this far, so the
+        /// shared counters are rarely touched. Peaks are accordingly only precise to this much per thread.
+        inline constexpr i64 FLUSH_THRESHOLD = 64 * 1024;
+
+        /// The counters of one thread. Only the owning thread writes them, the atomics only make reading
+        /// them for the report well defined.
+        struct Counters final {
+            std::array<std::atomic<u64>, PHASE_COUNT> count {};
+            std::array<std::atomic<u64>, PHASE_COUNT> bytes {};
+            std::array<i64, PHASE_COUNT> pending {};
+            Counters* next = nullptr;
+        };
+
+        /// Every thread's counters. They are never freed, so threads which have exited are still reported.
+        inline std::atomic<Counters*> threads = nullptr;
+        inline std::array<std::atomic<i64>, PHASE_COUNT> live {};
+        inline std::array<std::atomic<i64>, PHASE_COUNT> peak {};
+
+        inline thread_local Phase phase = Phase::Other;
+        inline thread_local Counters* counters = nullptr;
+
+        /// Answers the counters of the calling thread, registering them on first use.
+        /// They are allocated with malloc since this runs inside of `operator new`.
+        inline auto local() -> Counters& {
+            if (not counters) [[unlikely]] {
+                void* memory = std::malloc(sizeof(Counters));
+                if (not memory) std::abort();
+
+                counters = new (memory) Counters;
+                counters->next = threads.load(std::memory_order_relaxed);
+                while (not threads.compare_exchange_weak(
+                    counters->next, counters, std::memory_order_release, std::memory_order_relaxed
+                )) {}
+            }
+
+            return *counters;
+        }
+
+        inline void add(std::atomic<u64>& counter, u64 value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        /// Adds to the live bytes of a phase, raising its peak if it is a new high.
+        inline void publish(usize index, i64 balance) {
+            i64 now = live[index].fetch_add(balance, std::memory_order_relaxed) + balance;
+
+            i64 previous = peak[index].load(std::memory_order_relaxed);
+            while (now > previous and not peak[index].compare_exchange_weak(previous, now, std::memory_order_relaxed)) {}
+        }
+
+        /// Publishes the pending live balance of a phase of one thread.
+        inline void flush(Counters& local, usize index) {
+            publish(index, std::exchange(local.pending[index], 0));
+        }
+    }
+
+    /// Allocates memory attributed to the current phase of the calling thread, answering null on failure.
+    inline auto allocate(usize size, usize alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) noexcept -> void* {
+        usize prefix = std::max(alignment, sizeof(detail::Header));
+        if (size > std::numeric_limits<usize>::max() - prefix) return nullptr;
+
+        void* base = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            base = std::malloc(prefix + size);
+        } else if (posix_memalign(&base, alignment, prefix + size) != 0) {
+            base = nullptr;
+        }
+        if (not base) return nullptr;
+
+        Phase phase = detail::phase;
+        usize index = usize(phase);
+
+        auto header = new (static_cast<char*>(base) + prefix - sizeof(detail::Header)) detail::Header {
+            .size = size,
+            .offset = u32(prefix),
+            .phase = phase
+        };
+
+        auto& local = detail::local();
+        detail::add(local.count[index], 1);
+        detail::add(local.bytes[index], size);
+
+        local.pending[index] += i64(size);
+        if (local.pending[index] >= detail::FLUSH_THRESHOLD) detail::flush(local, index);
+
+        return header + 1;
+    }
+
+    /// Allocates like `allocate`, but retries through the new handler and throws like `operator new`.
+    inline auto allocate_or_throw(usize size, usize alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) -> void* {
+        while (true) {
+            if (void* pointer = allocate(size, alignment)) return pointer;
+
+            auto handler = std::get_new_handler();
+            if (not handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    /// Frees memory from `allocate`, crediting the phase which allocated it.
+    inline void deallocate(void* pointer) noexcept {
+        if (not pointer) return;
+
+        auto header = static_cast<detail::Header*>(pointer) - 1;
+        usize index = usize(header->phase);
+
+        auto& local = detail::local();
+        local.pending[index] -= i64(header->size);
+        if (local.pending[index] <= -detail::FLUSH_THRESHOLD) detail::flush(local, index);
+
+        std::free(static_cast<char*>(pointer) - header->offset);
+    }
+
+    /// Answers the number of allocations every thread made so far, in every phase.
+    inline auto allocation_count() -> u64 {
+        u64 total = 0;
+
+        for (auto thread = detail::threads.load(std::memory_order_acquire); thread; thread = thread->next) {
+            for (auto const& count : thread->count) total += count.load(std::memory_order_relaxed);
+        }
+
+        return total;
+    }
+
+    /// Attributes the allocations of the calling thread to a phase for as long as it lives.
+    class Tag final {
+        Phase previous;
+
+      public:
+        explicit Tag(Phase phase) : previous(std::exchange(detail::phase, phase)) {}
+        ~Tag() { detail::phase = previous; }
+
+        Tag(Tag const&) = delete;
+        auto operator = (Tag const&) -> Tag& = delete;
+    };
+
+    /// Writes the allocation count, bytes allocated, peak live bytes and bytes still live of every phase.
+    /// It must only be called once every other thread has finished allocating, since it publishes the
+    /// pending balances of every thread.
+    inline void write_report(std::ostream& out) {
+        auto threads = detail::threads.load(std::memory_order_acquire);
+
+        // Memory allocated on one thread is often freed on another, so the balances of all threads are
+        // published together, publishing them one by one could raise a peak which never happened.
+        for (usize index = 0; index < PHASE_COUNT; index += 1) {
+            i64 balance = 0;
+            for (auto thread = threads; thread; thread = thread->next) balance += std::exchange(thread->pending[index], 0);
+            detail::publish(index, balance);
+        }
+
+        std::array<u64, PHASE_COUNT> count {};
+        std::array<u64, PHASE_COUNT> bytes {};
+
+        for (auto thread = threads; thread; thread = thread->next) {
+            for (usize index = 0; index < PHASE_COUNT; index += 1) {
+                count[index] += thread->count[index].load(std::memory_order_relaxed);
+                bytes[index] += thread->bytes[index].load(std::memory_order_relaxed);
+            }
+        }
+
+        std::array<i64, PHASE_COUNT> peak {};
+        std::array<i64, PHASE_COUNT> live {};
+
+        for (usize index = 0; index < PHASE_COUNT; index += 1) {
+            peak[index] = detail::peak[index].load(std::memory_order_relaxed);
+            live[index] = detail::live[index].load(std::memory_order_relaxed);
+        }
+
+        std::println(out, "{:<12} {:>12} {:>14} {:>14} {:>14}", "phase", "allocations", "bytes", "peak live", "live at exit");
+        for (usize index = 0; index < PHASE_COUNT; index += 1) {
+            std::println(
+                out, "{:<12} {:>12} {:>14} {:>14} {:>14}",
+                PHASE_NAMES[index], count[index], bytes[index], peak[index], live[index]
+            );
+        }
+    }
+#else
+    /// Attributes allocations to a phase, which does nothing unless allocation accounting is built in.
+    class Tag final {
+      public:
+        explicit constexpr Tag(Phase) {}
+        ~Tag() {}
+
+        Tag(Tag const&) = delete;
+        auto operator = (Tag const&) -> Tag& = delete;
+    };
+#endif
+}
@@ -0,0 +1,562 @@
+// The Strawberry Programming Language Toolchain.
+// Copyright (c) 2026 Lua (TeamPuzel)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <iostream>
+#include <print>
+#include <chrono>
+#include <thread>
+#include "strc.hpp"
+#include "primitive.hpp"
+
+namespace str::bench {
+    /// Measures how many tokens the parser requests against how many are actually lexed.
+    ///
+    /// A streaming token stream re-lexes every token of a lookahead, so its count is the number of reads the
+    /// parser performs. The materialized token buffer lexes every token exactly once.
+    inline void token_lookahead(std::span<const SourceUnit> source_units) {
+        u64 lexed = 0;
+        u64 streaming = 0;
+
+        for (auto const& source_unit : source_units) {
+            try {
+                auto tokens = tokenize(source_unit);
+                (void) parse(tokens);
+                lexed += tokens.get_lexed_count();
+                streaming += tokens.get_streaming_lexed_count();
+            } catch (Diagnostic& diagnostic) {
+                std::println(std::cout, "skipping {}: {}", source_unit.source, diagnostic.what());
+            }
+        }
+
+        std::println(std::cout, "token lookahead:");
+        std::println(std::cout, "  lexed (streaming):    {}", streaming);
+        std::println(std::cout, "  lexed (materialized): {}", lexed);
+
+        if (lexed > 0) {
+            std::println(std::cout, "  reduction:            {:.2f}x", f64(streaming) / f64(lexed));
+        }
+    }
+
+    /// Measures tokenizer throughput with the scalar and vectorized scanning paths,
+    /// and verifies that both produce identical tokens.
+    inline auto tokenizer_throughput(std::span<const SourceUnit> source_units) -> bool {
+        static constexpr usize iterations = 64;
+
+        usize bytes = 0;
+        for (auto const& source_unit : source_units) bytes += source_unit.text.size();
+
+        auto measure = [&] (bool vectorized) -> f64 {
+            scan::vectorized = vectorized;
+            usize tokens = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (usize i = 0; i < iterations; i += 1) {
+                for (auto const& source_unit : source_units) tokens += tokenize(source_unit).get_lexed_count();
+            }
+            auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+            // Keeps the token count observable so the loop can't be discarded.
+            if (tokens == 0) std::println(std::cout, "  no tokens were lexed");
+
+            return f64(bytes * iterations) / seconds / 1e6;
+        };
+
+        bool identical = true;
+        for (auto const& source_unit : source_units) {
+            scan::vectorized = false;
+            auto scalar = tokenize(source_unit);
+            scan::vectorized = true;
+            auto vector = tokenize(source_unit);
+
+            if (not std::ranges::equal(scalar.get_tokens(), vector.get_tokens())) {
+                std::println(std::cout, "token mismatch between scanning paths in {}", source_unit.source);
+                identical = false;
+            }
+        }
+
+        f64 scalar = measure(false);
+        f64 vector = measure(true);
+
+        std::println(std::cout, "tokenizer throughput ({} bytes, {} iterations):", bytes, iterations);
+        std::println(std::cout, "  scalar:     {:.1f} MB/s", scalar);
+        std::println(std::cout, "  vectorized: {:.1f} MB/s", vector);
+        std::println(std::cout, "  tokens:     {}", identical ? "identical" : "mismatched");
+
+        return identical;
+    }
+
+    /// Counts the heap allocations made while building syntax trees with every node boxed on the heap,
+    /// and with the nodes of each tree allocated from its arena, then times tearing both down.
+    ///
+    /// Heap allocations are only counted in builds with allocation accounting, see `make build-alloc`.
+    inline void ast_allocation(std::span<const SourceUnit> source_units) {
+        auto heap_allocations = [] () -> u64 {
+#if defined(STRC_ALLOC_STATS)
+            return alloc::allocation_count();
+#else
+            return 0;
+#endif
+        };
+
+        // Parses like `parse`, but without an arena in scope, so every node and child vector is on the heap.
+        auto parse_boxed = [] (TokenStream& tokens) -> ArenaVector<Decl> {
+            Parser parser;
+            ArenaVector<Decl> decls;
+            (void) parser.parse_module_header(tokens);
+
+            while (not tokens.finished()) {
+                tokens.drop_while(&Token::is<Token::NewLine>);
+                if (tokens.finished()) break;
+                decls.emplace_back(parser.parse_decl(tokens));
+            }
+
+            return decls;
+        };
+
+        std::vector<ArenaVector<Decl>> boxed;
+        std::vector<Ast> asts;
+        boxed.reserve(source_units.size());
+        asts.reserve(source_units.size());
+
+        u64 boxed_allocations = 0;
+        u64 arena_allocations = 0;
+
+        for (auto const& source_unit : source_units) {
+            try {
+                auto boxed_tokens = tokenize(source_unit);
+                auto arena_tokens = tokenize(source_unit);
+
+                u64 before = heap_allocations();
+                boxed.push_back(parse_boxed(boxed_tokens));
+                u64 between = heap_allocations();
+                asts.push_back(parse(arena_tokens));
+
+                boxed_allocations += between - before;
+                arena_allocations += heap_allocations() - between;
+            } catch (Diagnostic& diagnostic) {
+                std::println(std::cout, "skipping {}: {}", source_unit.source, diagnostic.what());
+            }
+        }
+
+        usize allocations = 0;
+        usize chunks = 0;
+        usize bytes = 0;
+
+        for (auto const& ast : asts) {
+            allocations += ast.get_arena().get_allocations();
+            chunks += ast.get_arena().get_chunks();
+            bytes += ast.get_arena().get_bytes();
+        }
+
+        auto teardown = [] (auto& trees) {
+            auto start = std::chrono::steady_clock::now();
+            trees.clear();
+            return std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        f64 boxed_teardown = teardown(boxed);
+        f64 arena_teardown = teardown(asts);
+
+        std::println(std::cout, "ast allocation:");
+#if defined(STRC_ALLOC_STATS)
+        std::println(std::cout, "  heap allocations (boxed):  {}", boxed_allocations);
+        std::println(std::cout, "  heap allocations (arena):  {}", arena_allocations);
+#else
+        std::println(std::cout, "  heap allocations:          not counted, build with make build-alloc");
+#endif
+        std::println(std::cout, "  arena allocations:         {}", allocations);
+        std::println(std::cout, "  arena chunks:              {}", chunks);
+        std::println(std::cout, "  arena bytes:               {}", bytes);
+        std::println(std::cout, "  teardown (boxed):          {:.3f} ms", boxed_teardown * 1e3);
+        std::println(std::cout, "  teardown (arena):          {:.3f} ms", arena_teardown * 1e3);
+    }
+
+    /// Measures how parsing the corpus scales with the number of threads,
+    /// and verifies that every thread count merges modules in the same order.
+    inline auto parse_scaling(std::span<const SourceUnit> source_units) -> bool {
+        static constexpr usize iterations = 16;
+
+        usize max_jobs = std::max<usize>(std::thread::hardware_concurrency(), 1);
+
+        // The order of units in each module, which must not depend on scheduling.
+        auto layout = [] (Modules const& modules) {
+            std::vector<std::pair<std::string, std::vector<std::string_view>>> layout;
+            for (auto const& [path, asts] : modules) {
+                auto& [name, sources] = layout.emplace_back(std::string(path), std::vector<std::string_view>());
+                for (auto const& ast : asts) sources.push_back(ast.source);
+            }
+            std::ranges::sort(layout);
+            return layout;
+        };
+
+        auto reference = run::parse_modules(source_units);
+        if (not reference) {
+            std::println(std::cout, "parse scaling: skipped, the corpus does not parse");
+            return true;
+        }
+
+        auto expected = layout(*reference);
+        bool deterministic = true;
+        f64 baseline = 0;
+
+        std::println(std::cout, "parse scaling ({} units, {} iterations):", source_units.size(), iterations);
+
+        std::vector<usize> thread_counts;
+        for (usize jobs = 1; jobs < max_jobs; jobs *= 2) thread_counts.push_back(jobs);
+        thread_counts.push_back(max_jobs);
+
+        for (usize jobs : thread_counts) {
+            auto start = std::chrono::steady_clock::now();
+            for (usize i = 0; i < iterations; i += 1) {
+                auto modules = run::parse_modules(source_units, { .jobs = jobs });
+                if (not modules or layout(*modules) != expected) deterministic = false;
+            }
+            auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+            if (jobs == 1) baseline = seconds;
+            std::println(std::cout, "  {:>3} threads: {:8.2f} ms  {:.2f}x", jobs, seconds * 1e3 / iterations, baseline / seconds);
+        }
+
+        std::println(std::cout, "  merge order: {}", deterministic ? "deterministic" : "mismatched");
+
+        return deterministic;
+    }
+
+    /// Compares the binary and json coders on the line tables of the corpus,
+    /// and verifies that both decode what they encoded.
+    inline auto coding_throughput(std::span<const SourceUnit> source_units) -> bool {
+        static constexpr usize iterations = 64;
+
+        std::vector<std::vector<u32>> tables;
+        for (auto const& source_unit : source_units) tables.push_back(source_unit.lines);
+
+        bool identical = true;
+
+        auto measure = [&] (auto coder) -> std::pair<f64, usize> {
+            usize size = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            for (usize i = 0; i < iterations; i += 1) {
+                auto encoded = coder.encode(tables);
+                size = encoded.size();
+                if (coder.template decode<std::vector<std::vector<u32>>>(encoded) != tables) identical = false;
+            }
+            auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+            return { seconds, size };
+        };
+
+        auto [json_seconds, json_size] = measure(coding::Json());
+        auto [binary_seconds, binary_size] = measure(coding::Binary());
+
+        std::println(std::cout, "coding round trip ({} line tables, {} iterations):", tables.size(), iterations);
+        std::println(std::cout, "  json:   {:8.3f} ms  {} bytes", json_seconds * 1e3 / iterations, json_size);
+        std::println(std::cout, "  binary: {:8.3f} ms  {} bytes", binary_seconds * 1e3 / iterations, binary_size);
+        std::println(std::cout, "  round trip: {}", identical ? "identical" : "mismatched");
+
+        return identical;
+    }
+
+    /// Verifies that the binary coder decodes what it encoded for sum, optional and owning types, and for
+    /// diagnostics, which are decoded through their constructor rather than member by member. Also verifies
+    /// that a corrupt enumerator is rejected, and that the syntax trees of the corpus format the same
+    /// once they went through the parse cache encoding.
+    inline auto coding_round_trips(std::span<const SourceUnit> source_units) -> bool {
+        coding::Binary coder;
+        bool identical = true;
+
+        std::println(std::cout, "coding round trips:");
+
+        auto check = [&] (std::string_view name, auto const& value, auto equal) {
+            using T = std::remove_cvref_t<decltype(value)>;
+
+            bool same = equal(coder.template decode<T>(coder.encode(value)), value);
+            std::println(std::cout, "  {:<20} {}", name, same ? "identical" : "mismatched");
+            identical = identical and same;
+        };
+
+        auto equal = [] (auto const& a, auto const& b) { return a == b; };
+
+        auto same_pointee = [] (auto const& a, auto const& b) {
+            return a == nullptr ? b == nullptr : b != nullptr and *a == *b;
+        };
+
+        auto same_diagnostic = [] (Diagnostic const& a, Diagnostic const& b) {
+            auto same_provenance = std::visit(overloaded {
+                [] (Provenance::Span x, Provenance::Span y) {
+                    return x.source == y.source and x.begin == y.begin and x.end == y.end;
+                },
+                [] (Provenance::Source x, Provenance::Source y) { return x.source == y.source; },
+                [] (auto, auto) { return false; }
+            }, a.provenance.data, b.provenance.data);
+
+            return a.severity == b.severity and same_provenance and a.reason == b.reason and a.help == b.help;
+        };
+
+        using Variant = std::variant<u32, std::string, std::vector<i64>>;
+
+        check("variant index 0", Variant(u32(7)), equal);
+        check("variant index 1", Variant(std::string("lexer")), equal);
+        check("variant index 2", Variant(std::vector<i64> { -1, 0, i64(1) << 40 }), equal);
+        check("optional empty", std::optional<std::string>(), equal);
+        check("optional value", std::optional<std::string>("parser"), equal);
+        check("unique_ptr null", std::unique_ptr<std::vector<u32>>(), same_pointee);
+        check("unique_ptr value", std::make_unique<std::vector<u32>>(std::vector<u32> { 1, 2, 3 }), same_pointee);
+        check(
+            "diagnostic span",
+            Diagnostic::error(Provenance(Provenance::Span(3, 10, 14)), "unexpected token", "remove the token"),
+            same_diagnostic
+        );
+        check("diagnostic source", Diagnostic::warning(Provenance(u16(2)), "unused import"), same_diagnostic);
+
+        bool rejected = false;
+        try {
+            (void) coder.decode<Diagnostic::Severity>(coder.encode(std::to_underlying(Diagnostic::Severity::Error) + 100));
+        } catch (coding::Binary::Error const&) {
+            rejected = true;
+        }
+
+        std::println(std::cout, "  {:<20} {}", "invalid enumerator", rejected ? "rejected" : "accepted");
+        identical = identical and rejected;
+
+        // Syntax trees go through the hooks of the parse cache, the rendering of every declaration must survive.
+        usize units = 0;
+        usize mismatched = 0;
+
+        for (auto const& source_unit : source_units) {
+            std::optional<Ast> ast;
+            try {
+                auto tokens = tokenize(source_unit);
+                ast.emplace(parse(tokens));
+            } catch (Diagnostic&) {
+                continue;
+            }
+
+            auto original = ast->get_decls();
+            units += 1;
+
+            try {
+                cache::Hooks encode_hooks(source_unit);
+                auto content = coder.encode(original, encode_hooks);
+
+                Arena arena;
+                ArenaScope scope(arena);
+                cache::Hooks decode_hooks(source_unit);
+                auto decls = coder.decode<ArenaVector<Decl>>(content, decode_hooks);
+
+                bool same = decls.size() == original.size();
+                for (usize i = 0; same and i < decls.size(); i += 1) {
+                    same = std::format("{}", decls[i]) == std::format("{}", original[i]);
+                }
+
+                if (not same) mismatched += 1;
+            } catch (coding::Binary::Error const&) {
+                mismatched += 1;
+            }
+        }
+
+        std::println(
+            std::cout, "  {:<20} {}",
+            std::format("trees of {} units", units), mismatched == 0 ? "identical" : std::format("{} mismatched", mismatched)
+        );
+        identical = identical and mismatched == 0;
+
+        return identical;
+    }
+
+    /// Measures `Integer` arithmetic in the inline 64 bit range, where it competes with machine arithmetic,
+    /// and with 128 and 1024 bit products, where it runs the limb kernels. Verifies that products divide back exactly,
+    /// and that multi limb divisions with remainders, including one needing the add back correction, come out right.
+    inline auto integer_arithmetic() -> bool {
+        using raw::Integer;
+
+        static constexpr usize iterations = 1'000'000;
+        static constexpr usize wide_iterations = 10'000;
+
+        auto nanoseconds = [] (auto start, usize count) {
+            return std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count() / f64(count);
+        };
+
+        // A multiply, add and modulo chain which never leaves 64 bits, the shape of a tight const loop.
+        i64 machine = 1;
+        auto start = std::chrono::steady_clock::now();
+        for (usize i = 0; i < iterations; i += 1) machine = (machine * 31 + i64(i)) % 1'000'003;
+        f64 machine_ns = nanoseconds(start, iterations);
+
+        Integer small = 1;
+        start = std::chrono::steady_clock::now();
+        for (usize i = 0; i < iterations; i += 1) small = (small * 31 + Integer(i)) % 1'000'003;
+        f64 small_ns = nanoseconds(start, iterations);
+
+        bool exact = small == machine;
+
+        auto measure = [&] (Integer const& a, Integer const& b, usize count) -> std::pair<f64, f64> {
+            Integer product;
+            auto start = std::chrono::steady_clock::now();
+            for (usize i = 0; i < count; i += 1) product = a * (b + Integer(i));
+            f64 multiply_ns = nanoseconds(start, count);
+
+            auto [quotient, remainder] = Integer::divide(product, a);
+            if (quotient != b + Integer(count - 1) or remainder != 0) exact = false;
+
+            Integer sum;
+            start = std::chrono::steady_clock::now();
+            for (usize i = 0; i < count; i += 1) sum += product / (b + Integer(i));
+            f64 divide_ns = nanoseconds(start, count);
+
+            if (sum == 0) exact = false;
+
+            return { multiply_ns, divide_ns };
+        };
+
+        // An operand of the given width, with bits set all over so no limb is trivial.
+        auto operand = [] (usize bits) {
+            std::string digits = "0x";
+            while (digits.size() < bits / 4 + 2) digits += "9e3779b97f4a7c15";
+            digits.resize(bits / 4 + 2);
+            return *Integer::parse(digits);
+        };
+
+        // Divisions with known quotients and nonzero remainders, as hexadecimal dividend, divisor, quotient
+        // and remainder.
+        static constexpr std::array<std::array<std::string_view, 4>, 6> divisions = {{
+            // A quotient digit is estimated one too large here, which takes the add back correction.
+            { "0x7fffffffffffffff800000000000000000000000000000000000000000000000", "0x800000000000000000000000000000000000000000000001", "0xfffffffffffffffe", "0x7fffffffffffffffffffffffffffffff0000000000000002" },
+            // 192 / 120 bits.
+            { "0x23171ff4a6a3a4506513270e269e0d37f2a74de452e6b438", "0x9818e8892f902bd23f0824128b2f33", "0x3b0fcb7f5755df5914", "0x240bed329214bec6296b617031493c" },
+            // 320 / 200 bits.
+            { "0xeb0d549b6f03675a1600a35a099950d836f675cc81e74ef5e8e25d940ed904759531985d5d9dc9f8", "0xd30f21ddb66cad4a268d116ece1738f7d93d9c172411e20b8f", "0x11d1a0f0056a11807b9b06a70908fe3", "0xa418906a052b9ca7512bdd2cb2ef23732ee3dcdff92d48a92b" },
+            // 128 / 61 bits, a single limb divisor.
+            { "0xb9263059f28c105d1fb17c2390c192cf", "0x1413eed6a170b338", "0x938b802f8a3907be8", "0x1864a4ea503400f" },
+            // Division truncates, so the remainder takes the sign of the dividend.
+            { "-0x23171ff4a6a3a4506513270e269e0d37f2a74de452e6b438", "0x9818e8892f902bd23f0824128b2f33", "-0x3b0fcb7f5755df5914", "-0x240bed329214bec6296b617031493c" },
+            { "0x23171ff4a6a3a4506513270e269e0d37f2a74de452e6b438", "-0x9818e8892f902bd23f0824128b2f33", "-0x3b0fcb7f5755df5914", "0x240bed329214bec6296b617031493c" }
+        }};
+
+        for (auto [dividend, divisor, quotient, remainder] : divisions) {
+            auto result = Integer::divide(*Integer::parse(dividend), *Integer::parse(divisor));
+            if (result != std::pair(*Integer::parse(quotient), *Integer::parse(remainder))) exact = false;
+        }
+
+        auto [narrow_multiply, narrow_divide] = measure(operand(64), operand(64), iterations);
+        auto [wide_multiply, wide_divide] = measure(operand(512), operand(512), wide_iterations);
+
+        std::println(std::cout, "integer arithmetic:");
+        std::println(std::cout, "  i64 mul/add/mod:        {:8.2f} ns", machine_ns);
+        std::println(std::cout, "  Integer mul/add/mod:    {:8.2f} ns", small_ns);
+        std::println(std::cout, "  64 x 64 bit mul:        {:8.2f} ns  128 / 64 bit div:  {:8.2f} ns", narrow_multiply, narrow_divide);
+        std::println(std::cout, "  512 x 512 bit mul:      {:8.2f} ns  1024 / 512 bit div: {:8.2f} ns", wide_multiply, wide_divide);
+        std::println(std::cout, "  results: {}", exact ? "exact" : "mismatched");
+
+        return exact;
+    }
+
+    /// Asks the kernel to drop the cached pages of the files, so the next read has to go to the disk.
+    /// It is only advice, and pages of files open elsewhere may stay cached.
+    inline void evict_page_cache(std::span<const std::filesystem::path> paths) {
+    #if defined(__linux__)
+        for (auto const& path : paths) {
+            i32 fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) continue;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    #else
+        (void) paths;
+    #endif
+    }
+
+    /// Measures the wall clock time of reading the corpus with every loader, with warm and evicted page caches,
+    /// and verifies that every loader reads the same texts.
+    inline auto source_loading(std::span<const SourceUnit> source_units) -> bool {
+        static constexpr usize iterations = 16;
+
+        std::vector<std::filesystem::path> paths;
+        for (auto const& source_unit : source_units) paths.push_back(source_unit.source);
+
+        auto loaders = std::to_array<std::pair<run::Loader, std::string_view>>({
+            { run::Loader::Sequential, "sequential" },
+            { run::Loader::Threads, "threads" },
+            { run::Loader::Uring, "io_uring" },
+            { run::Loader::Mapped, "mmap" }
+        });
+
+        bool identical = true;
+
+        std::println(std::cout, "source loading ({} files, {} iterations):", paths.size(), iterations);
+
+        for (auto [loader, name] : loaders) {
+            if (loader == run::Loader::Uring and not uring::supported) continue;
+
+            f64 warm = 0;
+            f64 cold = 0;
+
+            for (usize i = 0; i < iterations; i += 1) {
+                for (bool evicted : { false, true }) {
+                    if (evicted) evict_page_cache(paths);
+
+                    std::vector<SourceUnit> loaded;
+                    auto start = std::chrono::steady_clock::now();
+                    run::read_source_units(paths, loaded, loader);
+                    auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+                    (evicted ? cold : warm) += seconds;
+
+                    if (loaded.size() != source_units.size()) {
+                        identical = false;
+                        continue;
+                    }
+
+                    for (usize unit = 0; unit < loaded.size(); unit += 1) {
+                        if (loaded[unit].text != source_units[unit].text) identical = false;
+                    }
+                }
+            }
+
+            std::println(
+                std::cout, "  {:<10}  warm: {:8.3f} ms  evicted: {:8.3f} ms",
+                name, warm * 1e3 / iterations, cold * 1e3 / iterations
+            );
+        }
+
+        std::println(std::cout, "  texts: {}", identical ? "identical" : "mismatched");
+
+        return identical;
+    }
+
+    /// The entry point for the bench subcommand.
+    inline i32 main() {
+        auto source_units = run::collect_all_source_units();
+
+        if (not source_loading(source_units)) return -1;
+        token_lookahead(source_units);
+        ast_allocation(source_units);
+        if (not tokenizer_throughput(source_units)) return -1;
+        if (not parse_scaling(source_units)) return -1;
+        if (not coding_throughput(source_units)) return -1;
+        if (not coding_round_trips(source_units)) return -1;
+        if (not integer_arithmetic()) return -1;
+
+        return 0;
+    }
+}
@@ -22,6 +22,8 @@
 #pragma once
 
 #include <meta>
+#include <algorithm>
+#include <array>
 #include <type_traits>
 #include <concepts>
 #include <string_view>
@@ -29,6 +31,13 @@
 #include <ranges>
 #include <optional>
 #include <charconv>
+#include <variant>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <limits>
+#include <bit>
+#include <cstring>
 #include "primitive.hpp"
 
 namespace str::coding {
@@ -378,3 +387,348 @@ namespace str::coding {
     static_assert(Coder<Json, std::string>);
     static_assert(Decoder<Json, std::string_view>);
 }
+
+namespace str::coding::detail {
+    template <typename T> constexpr bool is_variant_v = false;
+    template <typename... Ts> constexpr bool is_variant_v<std::variant<Ts...>> = true;
+
+    template <typename T> constexpr bool is_unique_ptr_v = false;
+    template <typename T> constexpr bool is_unique_ptr_v<std::unique_ptr<T>> = true;
+
+    template <typename T, usize I> using member_type_t =
+        std::remove_cvref_t<typename [: std::meta::type_of(reflected_members<T>()[I]) :]>;
+
+    /// Answers true if any member of a type is annotated to be left out of its encoding.
+    template <typename T> consteval auto has_ignored_members() -> bool {
+        for (auto member : reflected_members<T>()) {
+            if (std::meta::annotation_of_type<annotations::detail::ignore_t>(member)) return true;
+        }
+        return false;
+    }
+
+    /// Answers the value of every enumerator of an enum, with the same workaround as `reflected_members`.
+    template <typename T> consteval auto enumerator_values() {
+        constexpr auto size = std::meta::enumerators_of(^^T).size();
+        std::array<T, size> arr;
+        auto vec = std::meta::enumerators_of(^^T);
+        for (usize i = 0; i < size; i += 1) arr[i] = std::meta::extract<T>(vec[i]);
+        return arr;
+    }
+
+    /// Binary coding without any domain specific representations.
+    struct NoBinaryHooks final {};
+}
+
+namespace str::coding {
+    /// A compact binary format for persisting data structures and loading them back quickly.
+    ///
+    /// Integers are LEB128 varints, signed ones zigzag encoded, and floating point numbers are stored as
+    /// little endian bits. Strings, ranges, optionals, variants and unique pointers are prefixed with their
+    /// length, presence or alternative index. Contiguous ranges of numbers are stored as raw little endian
+    /// arrays so they decode with a single copy. Classes are encoded member by member in declaration order,
+    /// so `ignore` skips a member while `rename` has no effect as members are never named. Enums are stored
+    /// as their underlying value, which only decodes if it is the value of one of their enumerators.
+    ///
+    /// Decoding into `std::string_view` answers views into the encoded input without copying, the input must
+    /// therefore outlive the decoded value. Classes which are default constructible have their members assigned,
+    /// other classes are constructed from all of their members in declaration order.
+    ///
+    /// Types which need a different representation can be handled by a hooks object passed alongside
+    /// the value. It is consulted before the generic representation and is expected to provide
+    /// `encode(binary, out, value)` and `decode(binary, in, std::type_identity<T>)` for the types
+    /// it handles, constrained so that they do not match anything else.
+    struct Binary final {
+        class Error final : std::exception {
+            std::string reason;
+
+          public:
+            constexpr explicit Error(std::string reason) : reason(std::move(reason)) {}
+
+            auto what() const noexcept -> char const* override {
+                return reason.c_str();
+            }
+        };
+
+        template <typename T, typename Hooks> constexpr auto encode(T&& value, Hooks& hooks) -> std::string {
+            std::string out;
+            encode_into(out, value, hooks);
+            return out;
+        }
+
+        template <typename T> constexpr auto encode(T&& value) -> std::string {
+            detail::NoBinaryHooks hooks;
+            return encode(std::forward<T>(value), hooks);
+        }
+
+        template <typename T, typename Hooks> constexpr auto decode(std::string_view format, Hooks& hooks) -> T {
+            auto value = decode_from<T>(format, hooks);
+            if (not format.empty()) throw Error("trailing bytes");
+            return value;
+        }
+
+        template <typename T> constexpr auto decode(std::string_view format) -> T {
+            detail::NoBinaryHooks hooks;
+            return decode<T>(format, hooks);
+        }
+
+        constexpr void encode_varint(std::string& out, u64 value) {
+            while (value >= 0x80) {
+                out.push_back(char(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(char(value));
+        }
+
+        constexpr auto decode_varint(std::string_view& in) -> u64 {
+            u64 value = 0;
+
+            for (u32 shift = 0; shift < 64; shift += 7) {
+                if (in.empty()) throw Error("unexpected end");
+
+                u8 byte = u8(in.front());
+                in.remove_prefix(1);
+
+                value |= u64(byte & 0x7f) << shift;
+                if (not (byte & 0x80)) return value;
+            }
+
+            throw Error("varint too long");
+        }
+
+        constexpr void encode_bytes(std::string& out, std::string_view value) {
+            encode_varint(out, value.size());
+            out.append(value);
+        }
+
+        constexpr auto decode_bytes(std::string_view& in) -> std::string_view {
+            u64 size = decode_varint(in);
+            if (size > in.size()) throw Error("unexpected end");
+
+            auto value = in.substr(0, size);
+            in.remove_prefix(size);
+            return value;
+        }
+
+        /// Appends the encoding of a value, this is what hooks use to encode nested values.
+        template <typename T, typename Hooks> constexpr void encode_into(std::string& out, T const& value, Hooks& hooks) {
+            using Decay = std::decay_t<T>;
+
+            if constexpr (requires { hooks.encode(*this, out, value); }) {
+                hooks.encode(*this, out, value);
+            } else if constexpr (detail::is_optional_v<Decay>) {
+                encode_varint(out, value.has_value());
+                if (value) encode_into(out, *value, hooks);
+            } else if constexpr (detail::is_unique_ptr_v<Decay>) {
+                encode_varint(out, value != nullptr);
+                if (value) encode_into(out, *value, hooks);
+            } else if constexpr (detail::is_variant_v<Decay>) {
+                encode_varint(out, value.index());
+                std::visit([&] (auto const& alternative) { encode_into(out, alternative, hooks); }, value);
+            } else if constexpr (std::same_as<Decay, bool>) {
+                out.push_back(char(value));
+            } else if constexpr (std::is_enum_v<Decay>) {
+                encode_into(out, std::to_underlying(value), hooks);
+            } else if constexpr (std::unsigned_integral<Decay>) {
+                encode_varint(out, value);
+            } else if constexpr (std::signed_integral<Decay>) {
+                encode_varint(out, (u64(value) << 1) ^ u64(i64(value) >> 63));
+            } else if constexpr (std::floating_point<Decay>) {
+                encode_number(out, value);
+            } else if constexpr (std::is_convertible_v<Decay, std::string_view>) {
+                encode_bytes(out, std::string_view(value));
+            } else if constexpr (std::ranges::range<Decay>) {
+                using Element = std::ranges::range_value_t<Decay>;
+
+                if constexpr (std::ranges::contiguous_range<Decay> and is_raw_number<Element>) {
+                    encode_varint(out, std::ranges::size(value));
+
+                    if (not std::is_constant_evaluated() and std::endian::native == std::endian::little) {
+                        out.append(
+                            reinterpret_cast<char const*>(std::ranges::data(value)),
+                            std::ranges::size(value) * sizeof(Element)
+                        );
+                    } else {
+                        for (auto element : value) encode_number(out, element);
+                    }
+                } else {
+                    encode_varint(out, std::ranges::distance(value));
+                    for (auto const& element : value) encode_into(out, element, hooks);
+                }
+            } else if constexpr (std::is_class_v<Decay>) {
+                constexpr auto members = detail::reflected_members<Decay>();
+                template for (constexpr auto member : members) {
+                    constexpr auto ignore =
+                        std::meta::annotation_of_type<annotations::detail::ignore_t>(member);
+
+                    if constexpr (not ignore) encode_into(out, value.[:member:], hooks);
+                }
+            } else {
+                static_assert(sizeof(T) == 0, "unsupported binary type");
+            }
+        }
+
+        /// Decodes a value from the front of the input, this is what hooks use to decode nested values.
+        template <typename T, typename Hooks> constexpr auto decode_from(std::string_view& in, Hooks& hooks) -> T {
+            using Decay = std::decay_t<T>;
+
+            if constexpr (requires { hooks.decode(*this, in, std::type_identity<Decay>()); }) {
+                return hooks.decode(*this, in, std::type_identity<Decay>());
+            } else if constexpr (detail::is_optional_v<Decay>) {
+                if (decode_varint(in) == 0) return std::nullopt;
+                return Decay(decode_from<detail::optional_value_t<Decay>>(in, hooks));
+            } else if constexpr (detail::is_unique_ptr_v<Decay>) {
+                if (decode_varint(in) == 0) return nullptr;
+                return std::make_unique<typename Decay::element_type>(decode_from<typename Decay::element_type>(in, hooks));
+            } else if constexpr (detail::is_variant_v<Decay>) {
+                u64 index = decode_varint(in);
+
+                return [&] <usize... I> (std::index_sequence<I...>) -> Decay {
+                    std::optional<Decay> result;
+                    ((
+                        index == I ? (
+                            result.emplace(
+                                std::in_place_index<I>,
+                                decode_from<std::variant_alternative_t<I, Decay>>(in, hooks)
+                            ),
+                            true
+                        ) : false
+                    ) or ...);
+
+                    if (not result) throw Error("invalid variant index");
+                    return std::move(*result);
+                }(std::make_index_sequence<std::variant_size_v<Decay>>());
+            } else if constexpr (std::same_as<Decay, bool>) {
+                if (in.empty()) throw Error("unexpected end");
+                char byte = in.front();
+                in.remove_prefix(1);
+                return byte != 0;
+            } else if constexpr (std::is_enum_v<Decay>) {
+                constexpr auto enumerators = detail::enumerator_values<Decay>();
+
+                auto value = Decay(decode_from<std::underlying_type_t<Decay>>(in, hooks));
+                if (not std::ranges::contains(enumerators, value)) throw Error("invalid enumerator");
+                return value;
+            } else if constexpr (std::unsigned_integral<Decay>) {
+                u64 value = decode_varint(in);
+                if (value > std::numeric_limits<Decay>::max()) throw Error("integer out of range");
+                return Decay(value);
+            } else if constexpr (std::signed_integral<Decay>) {
+                u64 value = decode_varint(in);
+                i64 signed_value = i64(value >> 1) ^ -i64(value & 1);
+                if (not std::in_range<Decay>(signed_value)) throw Error("integer out of range");
+                return Decay(signed_value);
+            } else if constexpr (std::floating_point<Decay>) {
+                return decode_number<Decay>(in);
+            } else if constexpr (std::same_as<Decay, std::string_view>) {
+                return decode_bytes(in);
+            } else if constexpr (std::is_convertible_v<Decay, std::string_view>) {
+                return Decay(decode_bytes(in));
+            } else if constexpr (std::ranges::range<Decay>) {
+                using Element = std::ranges::range_value_t<Decay>;
+
+                u64 size = decode_varint(in);
+                Decay range;
+
+                if constexpr (std::ranges::contiguous_range<Decay> and is_raw_number<Element>) {
+                    if (size > in.size() / sizeof(Element)) throw Error("unexpected end");
+
+                    range.resize(size);
+
+                    if (not std::is_constant_evaluated() and std::endian::native == std::endian::little) {
+                        std::memcpy(std::ranges::data(range), in.data(), size * sizeof(Element));
+                        in.remove_prefix(size * sizeof(Element));
+                    } else {
+                        for (auto& element : range) element = decode_number<Element>(in);
+                    }
+                } else {
+                    // Elements may encode to nothing, so the input only bounds the reservation.
+                    if constexpr (requires { range.reserve(size); }) range.reserve(std::min<u64>(size, in.size()));
+
+                    for (u64 i = 0; i < size; i += 1) range.push_back(decode_from<Element>(in, hooks));
+                }
+
+                return range;
+            } else if constexpr (std::is_class_v<Decay> and std::default_initializable<Decay>) {
+                Decay object;
+
+                constexpr auto members = detail::reflected_members<Decay>();
+                template for (constexpr auto member : members) {
+                    constexpr auto ignore =
+                        std::meta::annotation_of_type<annotations::detail::ignore_t>(member);
+
+                    if constexpr (not ignore) {
+                        object.[:member:] = decode_from<std::remove_cvref_t<decltype(object.[:member:])>>(in, hooks);
+                    }
+                }
+
+                return object;
+            } else if constexpr (std::is_class_v<Decay>) {
+                constexpr auto members = detail::reflected_members<Decay>();
+
+                // Every member is passed to the constructor, so none can be missing from the encoding.
+                static_assert(
+                    not detail::has_ignored_members<Decay>(),
+                    "types with ignored members must be default initializable to be decoded"
+                );
+
+                return [&] <usize... I> (std::index_sequence<I...>) -> Decay {
+                    // Braced initialization decodes the members in declaration order.
+                    std::tuple<detail::member_type_t<Decay, I>...> values {
+                        decode_from<detail::member_type_t<Decay, I>>(in, hooks)...
+                    };
+
+                    if constexpr (std::is_aggregate_v<Decay>) {
+                        return Decay { std::move(std::get<I>(values))... };
+                    } else {
+                        return Decay(std::move(std::get<I>(values))...);
+                    }
+                }(std::make_index_sequence<members.size()>());
+            } else {
+                static_assert(sizeof(T) == 0, "unsupported binary type");
+            }
+        }
+
+      private:
+        template <typename T> static constexpr bool is_raw_number =
+            (std::integral<T> or std::floating_point<T>) and not std::same_as<T, bool>;
+
+        template <typename T> static constexpr auto raw_bits(T value) {
+            if constexpr (sizeof(T) == 1) {
+                return std::bit_cast<u8>(value);
+            } else if constexpr (sizeof(T) == 2) {
+                return std::bit_cast<u16>(value);
+            } else if constexpr (sizeof(T) == 4) {
+                return std::bit_cast<u32>(value);
+            } else {
+                return std::bit_cast<u64>(value);
+            }
+        }
+
+        template <typename T> constexpr void encode_number(std::string& out, T value) {
+            auto bits = raw_bits(value);
+            for (usize i = 0; i < sizeof(T); i += 1) out.push_back(char(u8(bits >> (8 * i))));
+        }
+
+        template <typename T> constexpr auto decode_number(std::string_view& in) -> T {
+            if (in.size() < sizeof(T)) throw Error("unexpected end");
+
+            decltype(raw_bits(T())) bits = 0;
+            if consteval {
+                for (usize i = 0; i < sizeof(T); i += 1) bits |= decltype(bits)(u8(in[i])) << (8 * i);
+            } else {
+                std::memcpy(&bits, in.data(), sizeof(T));
+                if constexpr (std::endian::native == std::endian::big) bits = std::byteswap(bits);
+            }
+
+            in.remove_prefix(sizeof(T));
+            return std::bit_cast<T>(bits);
+        }
+    };
+
+    template <> struct SupportsEncodingFormat<Binary, std::string> : std::true_type {};
+    template <> struct SupportsDecodingFormat<Binary, std::string> : std::true_type {};
+    template <> struct SupportsDecodingFormat<Binary, std::string_view> : std::true_type {};
+
+    static_assert(Coder<Binary, std::string>);
+    static_assert(Decoder<Binary, std::string_view>);
+}
@@ -0,0 +1,481 @@
+// The Strawberry Programming Language Toolchain.
+// Copyright (c) 2026 Lua (TeamPuzel)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <format>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "primitive.hpp"
+
+namespace str::raw {
+    namespace detail {
+        __extension__ typedef unsigned __int128 u128;
+
+        /// A magnitude in 64 bit limbs, least significant first.
+        using Limbs = std::vector<u64>;
+
+        inline void trim(Limbs& limbs) {
+            while (not limbs.empty() and limbs.back() == 0) limbs.pop_back();
+        }
+
+        /// Compares magnitudes without leading zero limbs.
+        inline auto compare(std::span<const u64> a, std::span<const u64> b) -> std::strong_ordering {
+            if (a.size() != b.size()) return a.size() <=> b.size();
+
+            for (usize i = a.size(); i-- > 0;) {
+                if (a[i] != b[i]) return a[i] <=> b[i];
+            }
+
+            return std::strong_ordering::equal;
+        }
+
+        inline auto add(std::span<const u64> a, std::span<const u64> b) -> Limbs {
+            if (a.size() < b.size()) std::swap(a, b);
+
+            Limbs sum(a.size() + 1);
+            u64 carry = 0;
+
+            for (usize i = 0; i < a.size(); i += 1) {
+                u128 limb = u128(a[i]) + (i < b.size() ? b[i] : 0) + carry;
+                sum[i] = u64(limb);
+                carry = u64(limb >> 64);
+            }
+
+            sum.back() = carry;
+            trim(sum);
+            return sum;
+        }
+
+        /// Subtracts magnitudes, `a` must not be smaller than `b`.
+        inline auto subtract(std::span<const u64> a, std::span<const u64> b) -> Limbs {
+            Limbs difference(a.size());
+            u64 borrow = 0;
+
+            for (usize i = 0; i < a.size(); i += 1) {
+                u64 subtrahend = i < b.size() ? b[i] : 0;
+                u64 limb = a[i] - subtrahend - borrow;
+                borrow = a[i] < subtrahend or a[i] - subtrahend < borrow;
+                difference[i] = limb;
+            }
+
+            trim(difference);
+            return difference;
+        }
+
+        /// Schoolbook multiplication with 128 bit partial products. The operands of compile time math are
+        /// a handful of limbs, where this beats asymptotically faster algorithms outright.
+        inline auto multiply(std::span<const u64> a, std::span<const u64> b) -> Limbs {
+            if (a.empty() or b.empty()) return {};
+
+            Limbs product(a.size() + b.size());
+
+            for (usize i = 0; i < a.size(); i += 1) {
+                u64 carry = 0;
+
+                for (usize j = 0; j < b.size(); j += 1) {
+                    // At most (2^64 - 1)^2 + 2 * (2^64 - 1), which is exactly the largest 128 bit value.
+                    u128 limb = u128(a[i]) * b[j] + product[i + j] + carry;
+                    product[i + j] = u64(limb);
+                    carry = u64(limb >> 64);
+                }
+
+                product[i + b.size()] = carry;
+            }
+
+            trim(product);
+            return product;
+        }
+
+        /// Divides magnitudes, answering the quotient and the remainder. `b` must not be zero.
+        ///
+        /// Single limb divisors take a short division. Longer ones use Knuth's algorithm D, which estimates
+        /// every quotient limb from the leading limbs with a 128 by 64 bit division.
+        inline auto divide(std::span<const u64> a, std::span<const u64> b) -> std::pair<Limbs, Limbs> {
+            if (compare(a, b) < 0) return { {}, Limbs(a.begin(), a.end()) };
+
+            if (b.size() == 1) {
+                Limbs quotient(a.size());
+                u64 remainder = 0;
+
+                for (usize i = a.size(); i-- > 0;) {
+                    u128 dividend = u128(remainder) << 64 | a[i];
+                    quotient[i] = u64(dividend / b[0]);
+                    remainder = u64(dividend % b[0]);
+                }
+
+                trim(quotient);
+                return { std::move(quotient), remainder ? Limbs { remainder } : Limbs {} };
+            }
+
+            usize n = b.size();
+            usize m = a.size() - n;
+
+            // Shifting both operands until the divisor's top bit is set keeps the estimates at most two off.
+            u32 shift = std::countl_zero(b.back());
+            auto shifted = [shift] (std::span<const u64> limbs, usize i) -> u64 {
+                u64 high = i < limbs.size() ? limbs[i] << shift : 0;
+                u64 low = shift > 0 and i > 0 and i - 1 < limbs.size() ? limbs[i - 1] >> (64 - shift) : 0;
+                return high | low;
+            };
+
+            Limbs divisor(n);
+            for (usize i = 0; i < n; i += 1) divisor[i] = shifted(b, i);
+
+            Limbs dividend(a.size() + 1);
+            for (usize i = 0; i <= a.size(); i += 1) dividend[i] = shifted(a, i);
+
+            Limbs quotient(m + 1);
+            u64 top = divisor[n - 1];
+            u64 next = divisor[n - 2];
+
+            for (usize j = m + 1; j-- > 0;) {
+                u128 numerator = u128(dividend[j + n]) << 64 | dividend[j + n - 1];
+                u128 estimate = numerator / top;
+                u128 rest = numerator % top;
+
+                while (estimate >> 64 or estimate * next > (rest << 64 | dividend[j + n - 2])) {
+                    estimate -= 1;
+                    rest += top;
+                    if (rest >> 64) break;
+                }
+
+                u64 carry = 0;
+                u64 borrow = 0;
+
+                for (usize i = 0; i < n; i += 1) {
+                    u128 product = estimate * divisor[i] + carry;
+                    carry = u64(product >> 64);
+
+                    u64 low = u64(product);
+                    u64 limb = dividend[i + j];
+                    dividend[i + j] = limb - low - borrow;
+                    borrow = limb < low or limb - low < borrow;
+                }
+
+                u64 limb = dividend[j + n];
+                dividend[j + n] = limb - carry - borrow;
+                borrow = limb < carry or limb - carry < borrow;
+
+                quotient[j] = u64(estimate);
+
+                // The estimate was one too large, which is rare, so the divisor is added back.
+                if (borrow) {
+                    quotient[j] -= 1;
+                    u64 add_carry = 0;
+
+                    for (usize i = 0; i < n; i += 1) {
+                        u128 sum = u128(dividend[i + j]) + divisor[i] + add_carry;
+                        dividend[i + j] = u64(sum);
+                        add_carry = u64(sum >> 64);
+                    }
+
+                    dividend[j + n] += add_carry;
+                }
+            }
+
+            Limbs remainder(n);
+            for (usize i = 0; i < n; i += 1) {
+                remainder[i] = dividend[i] >> shift | (shift > 0 ? dividend[i + 1] << (64 - shift) : 0);
+            }
+
+            trim(quotient);
+            trim(remainder);
+            return { std::move(quotient), std::move(remainder) };
+        }
+    }
+
+    /// Implementation of the `Integer` intrinsic type, an integer of unbounded size.
+    ///
+    /// Values which fit in 64 bits are held inline and computed with overflow checked machine arithmetic.
+    /// Only a result which overflows is promoted to a magnitude of 64 bit limbs on the heap, and results
+    /// which fit again are demoted, so every value has exactly one representation.
+    class Integer final {
+        /// The value while it is small, otherwise its sign, `-1` or `1`.
+        i64 value = 0;
+        /// The magnitude of a big value, without leading zero limbs. Empty while the value is small.
+        detail::Limbs magnitude;
+
+        /// The sign and magnitude of a value, with the magnitude of a small value kept in `storage`.
+        auto parts(u64& storage) const -> std::pair<bool, std::span<const u64>> {
+            if (not magnitude.empty()) return { value < 0, magnitude };
+
+            storage = value < 0 ? 0 - u64(value) : u64(value);
+            return { value < 0, value == 0 ? std::span<const u64>() : std::span<const u64>(&storage, 1) };
+        }
+
+        /// Makes the canonical integer of a sign and magnitude.
+        static auto make(bool negative, detail::Limbs limbs) -> Integer {
+            detail::trim(limbs);
+
+            if (limbs.empty()) return Integer();
+
+            if (limbs.size() == 1) {
+                u64 limb = limbs[0];
+                if (not negative and limb <= u64(std::numeric_limits<i64>::max())) return Integer(i64(limb));
+                if (negative and limb <= u64(std::numeric_limits<i64>::max()) + 1) return Integer(i64(0 - limb));
+            }
+
+            Integer integer;
+            integer.value = negative ? -1 : 1;
+            integer.magnitude = std::move(limbs);
+            return integer;
+        }
+
+        static auto add(bool a_negative, std::span<const u64> a, bool b_negative, std::span<const u64> b) -> Integer {
+            if (a_negative == b_negative) return make(a_negative, detail::add(a, b));
+
+            auto order = detail::compare(a, b);
+            if (order == 0) return Integer();
+            if (order > 0) return make(a_negative, detail::subtract(a, b));
+            return make(b_negative, detail::subtract(b, a));
+        }
+
+        static auto add_slow(Integer const& a, Integer const& b, bool negate_b) -> Integer {
+            u64 a_storage;
+            u64 b_storage;
+            auto [a_negative, a_limbs] = a.parts(a_storage);
+            auto [b_negative, b_limbs] = b.parts(b_storage);
+            if (b_limbs.empty()) return a;
+
+            return add(a_negative, a_limbs, b_negative != negate_b, b_limbs);
+        }
+
+      public:
+        constexpr Integer() noexcept = default;
+
+        Integer(std::signed_integral auto value) noexcept : value(value) {}
+
+        Integer(std::unsigned_integral auto value) {
+            if (u64(value) <= u64(std::numeric_limits<i64>::max())) {
+                this->value = i64(value);
+            } else {
+                this->value = 1;
+                magnitude = { u64(value) };
+            }
+        }
+
+        /// Parses a literal in decimal, or in hexadecimal, octal or binary with a `0x`, `0o` or `0b` prefix,
+        /// with an optional leading minus. Underscores may separate digits.
+        static auto parse(std::string_view text) -> std::optional<Integer> {
+            bool negative = text.starts_with('-');
+            if (negative) text.remove_prefix(1);
+
+            u32 base = 10;
+            if (text.size() > 2 and text[0] == '0') {
+                switch (text[1]) {
+                    case 'x': base = 16; break;
+                    case 'o': base = 8;  break;
+                    case 'b': base = 2;  break;
+                }
+                if (base != 10) text.remove_prefix(2);
+            }
+
+            detail::Limbs limbs;
+            bool digits = false;
+
+            // Digits are gathered into a machine word while the chunk still fits, then folded in at once.
+            u64 chunk = 0;
+            u64 scale = 1;
+
+            auto fold = [&] {
+                u64 carry = chunk;
+                for (auto& limb : limbs) {
+                    detail::u128 product = detail::u128(limb) * scale + carry;
+                    limb = u64(product);
+                    carry = u64(product >> 64);
+                }
+                if (carry) limbs.push_back(carry);
+
+                chunk = 0;
+                scale = 1;
+            };
+
+            for (char c : text) {
+                if (c == '_' and digits) continue;
+
+                u32 digit;
+                if (c >= '0' and c <= '9') digit = c - '0';
+                else if (c >= 'a' and c <= 'f') digit = c - 'a' + 10;
+                else if (c >= 'A' and c <= 'F') digit = c - 'A' + 10;
+                else return std::nullopt;
+
+                if (digit >= base) return std::nullopt;
+
+                if (scale > std::numeric_limits<u64>::max() / base) fold();
+                chunk = chunk * base + digit;
+                scale *= base;
+                digits = true;
+            }
+
+            if (not digits) return std::nullopt;
+            fold();
+
+            return make(negative, std::move(limbs));
+        }
+
+        auto is_small() const noexcept -> bool { return magnitude.empty(); }
+
+        /// Answers the value if it fits in 64 bits.
+        auto get_small() const noexcept -> std::optional<i64> {
+            if (not is_small()) return std::nullopt;
+            return value;
+        }
+
+        auto is_negative() const noexcept -> bool { return value < 0; }
+
+        /// Answers the low bits of the two's complement of the value, which is how it converts to an `Int`
+        /// of the given size. The size must be at most 64.
+        auto truncate(u64 size) const -> u64 {
+            if (size > 64) throw std::logic_error("truncating to more than 64 bits");
+
+            u64 low = is_small() ? u64(value) : (value < 0 ? 0 - magnitude[0] : magnitude[0]);
+            return size == 64 ? low : low & ((u64(1) << size) - 1);
+        }
+
+        friend auto operator + (Integer const& a, Integer const& b) -> Integer {
+            i64 sum;
+            if (a.is_small() and b.is_small() and not __builtin_add_overflow(a.value, b.value, &sum)) return sum;
+            return add_slow(a, b, false);
+        }
+
+        friend auto operator - (Integer const& a, Integer const& b) -> Integer {
+            i64 difference;
+            if (a.is_small() and b.is_small() and not __builtin_sub_overflow(a.value, b.value, &difference)) return difference;
+            return add_slow(a, b, true);
+        }
+
+        friend auto operator * (Integer const& a, Integer const& b) -> Integer {
+            i64 product;
+            if (a.is_small() and b.is_small() and not __builtin_mul_overflow(a.value, b.value, &product)) return product;
+
+            u64 a_storage;
+            u64 b_storage;
+            auto [a_negative, a_limbs] = a.parts(a_storage);
+            auto [b_negative, b_limbs] = b.parts(b_storage);
+
+            return make(a_negative != b_negative, detail::multiply(a_limbs, b_limbs));
+        }
+
+        /// Divides, rounding the quotient toward zero, so the remainder takes the sign of the dividend.
+        /// Throws `std::domain_error` when dividing by zero.
+        static auto divide(Integer const& a, Integer const& b) -> std::pair<Integer, Integer> {
+            if (b.is_small() and b.value == 0) throw std::domain_error("division by zero");
+
+            // The only overflowing small division is the most negative value by minus one.
+            if (a.is_small() and b.is_small() and not (a.value == std::numeric_limits<i64>::min() and b.value == -1)) {
+                return { Integer(a.value / b.value), Integer(a.value % b.value) };
+            }
+
+            u64 a_storage;
+            u64 b_storage;
+            auto [a_negative, a_limbs] = a.parts(a_storage);
+            auto [b_negative, b_limbs] = b.parts(b_storage);
+
+            auto [quotient, remainder] = detail::divide(a_limbs, b_limbs);
+            return { make(a_negative != b_negative, std::move(quotient)), make(a_negative, std::move(remainder)) };
+        }
+
+        friend auto operator / (Integer const& a, Integer const& b) -> Integer { return divide(a, b).first; }
+        friend auto operator % (Integer const& a, Integer const& b) -> Integer { return divide(a, b).second; }
+
+        friend auto operator - (Integer const& a) -> Integer { return Integer() - a; }
+
+        auto operator += (Integer const& other) -> Integer& { return *this = *this + other; }
+        auto operator -= (Integer const& other) -> Integer& { return *this = *this - other; }
+        auto operator *= (Integer const& other) -> Integer& { return *this = *this * other; }
+        auto operator /= (Integer const& other) -> Integer& { return *this = *this / other; }
+        auto operator %= (Integer const& other) -> Integer& { return *this = *this % other; }
+
+        friend auto operator == (Integer const& a, Integer const& b) noexcept -> bool = default;
+
+        /// Every big value lies outside of the small range, so small and big values order by sign alone.
+        friend auto operator <=> (Integer const& a, Integer const& b) noexcept -> std::strong_ordering {
+            if (a.is_small() and b.is_small()) return a.value <=> b.value;
+            if (a.is_small()) return b.value < 0 ? std::strong_ordering::greater : std::strong_ordering::less;
+            if (b.is_small()) return a.value < 0 ? std::strong_ordering::less : std::strong_ordering::greater;
+            if (a.value != b.value) return a.value <=> b.value;
+
+            auto order = detail::compare(a.magnitude, b.magnitude);
+            return a.value < 0 ? 0 <=> order : order;
+        }
+
+        /// Answers the count of limbs held on the heap, which is zero while the value is small.
+        auto get_limb_count() const noexcept -> usize {
+            return magnitude.size();
+        }
+
+        auto hash() const noexcept -> u64 {
+            u64 hash = u64(value) * 0x9e3779b97f4a7c15;
+            for (u64 limb : magnitude) hash = (hash ^ limb) * 0xd6e8feb86659fd93;
+            return hash;
+        }
+
+        auto to_string() const -> std::string {
+            if (is_small()) return std::to_string(value);
+
+            // Peels off 19 decimal digits at a time, the most a single limb division can answer.
+            static constexpr u64 chunk = 10'000'000'000'000'000'000u;
+
+            detail::Limbs rest = magnitude;
+            std::vector<u64> chunks;
+
+            while (not rest.empty()) {
+                u64 remainder = 0;
+                for (usize i = rest.size(); i-- > 0;) {
+                    detail::u128 dividend = detail::u128(remainder) << 64 | rest[i];
+                    rest[i] = u64(dividend / chunk);
+                    remainder = u64(dividend % chunk);
+                }
+                detail::trim(rest);
+                chunks.push_back(remainder);
+            }
+
+            std::string text = value < 0 ? "-" : "";
+            text += std::to_string(chunks.back());
+            for (usize i = chunks.size() - 1; i-- > 0;) text += std::format("{:019}", chunks[i]);
+
+            return text;
+        }
+    };
+}
+
+template <> struct std::hash<str::raw::Integer> {
+    auto operator()(str::raw::Integer const& integer) const noexcept -> usize {
+        return integer.hash();
+    }
+};
+
+template <> struct std::formatter<str::raw::Integer, char> : std::formatter<std::string_view, char> {
+    auto format(str::raw::Integer const& integer, std::format_context& ctx) const {
+        return std::formatter<std::string_view, char>::format(integer.to_string(), ctx);
+    }
+};
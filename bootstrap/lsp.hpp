@@ -124,7 +124,7 @@ namespace str::lsp {
         std::fflush(stdout);
     }
 
-    inline auto to_lsp_diagnostic(str::Diagnostic const& diagnostic) -> Diagnostic {
+    inline auto to_lsp_diagnostic(str::Diagnostic const& diagnostic, str::SourceUnit const& source_unit) -> Diagnostic {
         Diagnostic lsp_diagnostic;
 
         switch (diagnostic.severity) {
@@ -138,16 +138,13 @@ namespace str::lsp {
 
         std::visit(overloaded {
             [&] (str::Provenance::Span const& span) {
-                lsp_diagnostic.range.start.line = span.start.line > 0 ? span.start.line - 1 : 0;
+                auto start = source_unit.location(span.begin);
+                auto end = source_unit.location(span.last());
 
-                lsp_diagnostic.range.start.character =
-                    (span.start.column >= span.start.count)
-                        ? span.start.column - span.start.count
-                        : 0;
-
-                lsp_diagnostic.range.end.line = span.end.line > 0 ? span.end.line - 1 : 0;
-
-                lsp_diagnostic.range.end.character = span.end.column;
+                lsp_diagnostic.range.start.line = start.line - 1;
+                lsp_diagnostic.range.start.character = start.column - 1;
+                lsp_diagnostic.range.end.line = end.line - 1;
+                lsp_diagnostic.range.end.character = end.column;
             },
             [&] (str::Provenance::Source const& source) {
                 lsp_diagnostic.range.start.line = 0;
@@ -160,39 +157,78 @@ namespace str::lsp {
         return lsp_diagnostic;
     }
 
+    namespace stats {
+        inline str::stats::Counter messages { "lsp.messages" };
+        inline str::stats::Counter json_errors { "lsp.json_errors" };
+        inline str::stats::Counter published_diagnostics { "lsp.published_diagnostics" };
+    }
+
     inline void publish_diagnostics(
         std::string_view uri,
         std::span<const str::Diagnostic> diagnostics,
+        std::span<const str::SourceUnit> source_units,
         str::coding::Json& json
     ) {
-        auto source_units = str::run::collect_all_source_units();
-
         PublishDiagnosticsNotification notification;
         notification.params.uri = std::string(uri);
 
+        str::run::SourceUnitIndex index(source_units);
+
         for (auto const& diagnostic : diagnostics) {
-            std::string_view diagnostic_source;
+            u16 diagnostic_id;
 
             if (std::holds_alternative<str::Provenance::Span>(diagnostic.provenance.data)) {
-                diagnostic_source = std::get<str::Provenance::Span>(diagnostic.provenance.data).start.source;
+                diagnostic_id = std::get<str::Provenance::Span>(diagnostic.provenance.data).source;
             } else {
-                diagnostic_source = std::get<str::Provenance::Source>(diagnostic.provenance.data).source;
+                diagnostic_id = std::get<str::Provenance::Source>(diagnostic.provenance.data).source;
             }
 
+            auto source_unit = index.find(diagnostic_id);
+            if (not source_unit) continue;
+
+            std::string_view diagnostic_source = source_unit->source;
+
             if (uri.ends_with(diagnostic_source) or diagnostic_source.ends_with(uri)) {
-                notification.params.diagnostics.push_back(to_lsp_diagnostic(diagnostic));
+                notification.params.diagnostics.push_back(to_lsp_diagnostic(diagnostic, *source_unit));
             }
         }
 
+        stats::published_diagnostics.add(notification.params.diagnostics.size());
         send(json.encode(notification));
     }
 
     /// The entry point for the serve subcommand.
-    inline i32 main() {
+    ///
+    /// With `--stats` every statistic gathered over the session is written once the client disconnects,
+    /// to standard error or to the file given with `--stats=<file>`, since standard output is the protocol.
+    inline i32 main(std::span<const std::string_view> args) {
+        std::optional<std::string> stats_path;
+
+        for (auto arg : args) {
+            if (arg == "--stats") {
+                stats_path = "";
+            } else if (arg.starts_with("--stats=")) {
+                stats_path = std::string(arg.substr(8));
+                if (stats_path->empty()) {
+                    std::println(std::cerr, "error: expected a file name after --stats=");
+                    return -1;
+                }
+            } else {
+                std::println(std::cerr, "error: unknown option '{}'", arg);
+                return -1;
+            }
+        }
+
+        if (stats_path) str::stats::enabled = true;
+        ScopeExit write = [&] {
+            if (stats_path) str::run::write_reports({ .stats = stats_path });
+        };
+
         std::cin.tie(nullptr);
         std::ios_base::sync_with_stdio(false);
 
         str::coding::Json json;
+        str::cache::ParseCache cache(str::CACHE_PATH);
 
         while (true) {
             try {
@@ -208,6 +244,7 @@ namespace str::lsp {
 
                     std::string content(length, ' ');
                     std::cin.read(content.data(), length);
+                    stats::messages.add();
 
                     std::cerr << "[strc] receiving: " << content << std::endl;
                     auto base = json.decode<BaseMessage>(content);
@@ -221,27 +258,28 @@ namespace str::lsp {
                         auto request = json.decode<DidOpenNotification>(content);
                         std::string_view uri = request.params.text_document.uri;
 
+                        // Sources are read rather than mapped, the editor may rewrite a file in place while it is parsed.
                         auto source_units = str::run::collect_all_source_units();
-                        auto modules = str::run::parse_modules(source_units);
+                        auto modules = str::run::parse_modules(source_units, {}, &cache);
 
                         if (not modules) {
-                            publish_diagnostics(uri, modules.error(), json);
+                            publish_diagnostics(uri, modules.error(), source_units, json);
                         } else {
                             auto sir = str::evaluate(std::move(modules.value()), std::move(source_units));
-                            publish_diagnostics(uri, sir.get_diagnostics(), json);
+                            publish_diagnostics(uri, sir.get_diagnostics(), sir.get_source_units(), json);
                         }
                     } else if (base.method == "textDocument/didSave") {
                         auto request = json.decode<DidSaveNotification>(content);
                         std::string_view uri = request.params.text_document.uri;
 
                         auto source_units = str::run::collect_all_source_units();
-                        auto modules = str::run::parse_modules(source_units);
+                        auto modules = str::run::parse_modules(source_units, {}, &cache);
 
                         if (not modules) {
-                            publish_diagnostics(uri, modules.error(), json);
+                            publish_diagnostics(uri, modules.error(), source_units, json);
                         } else {
                             auto sir = str::evaluate(std::move(modules.value()), std::move(source_units));
-                            publish_diagnostics(uri, sir.get_diagnostics(), json);
+                            publish_diagnostics(uri, sir.get_diagnostics(), sir.get_source_units(), json);
                         }
                     } else if (base.method == "initialized") {
                         // pass
@@ -257,6 +295,7 @@ namespace str::lsp {
                     }
                 }
             } catch (coding::Json::Error& error) {
+                stats::json_errors.add();
                 std::cerr << "[strc] json error: " << error.what() << std::endl;
             }
         }
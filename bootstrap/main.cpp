@@ -23,9 +23,51 @@
 #include <print>
 #include "strc.hpp"
 #include "lsp.hpp"
+#include "bench.hpp"
+#include "watch.hpp"
+#include "alloc.hpp"
 #include "primitive.hpp"
 
+#if defined(STRC_ALLOC_STATS)
+// Every replaceable allocation function goes through the accounting allocator, see `alloc.hpp`.
+
+auto operator new (usize size) -> void* { return str::alloc::allocate_or_throw(size); }
+auto operator new[] (usize size) -> void* { return str::alloc::allocate_or_throw(size); }
+auto operator new (usize size, std::nothrow_t const&) noexcept -> void* { return str::alloc::allocate(size); }
+auto operator new[] (usize size, std::nothrow_t const&) noexcept -> void* { return str::alloc::allocate(size); }
+
+auto operator new (usize size, std::align_val_t alignment) -> void* {
+    return str::alloc::allocate_or_throw(size, usize(alignment));
+}
+auto operator new[] (usize size, std::align_val_t alignment) -> void* {
+    return str::alloc::allocate_or_throw(size, usize(alignment));
+}
+auto operator new (usize size, std::align_val_t alignment, std::nothrow_t const&) noexcept -> void* {
+    return str::alloc::allocate(size, usize(alignment));
+}
+auto operator new[] (usize size, std::align_val_t alignment, std::nothrow_t const&) noexcept -> void* {
+    return str::alloc::allocate(size, usize(alignment));
+}
+
+void operator delete (void* pointer) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer) noexcept { str::alloc::deallocate(pointer); }
+void operator delete (void* pointer, usize) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer, usize) noexcept { str::alloc::deallocate(pointer); }
+void operator delete (void* pointer, std::nothrow_t const&) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer, std::nothrow_t const&) noexcept { str::alloc::deallocate(pointer); }
+void operator delete (void* pointer, std::align_val_t) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer, std::align_val_t) noexcept { str::alloc::deallocate(pointer); }
+void operator delete (void* pointer, usize, std::align_val_t) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer, usize, std::align_val_t) noexcept { str::alloc::deallocate(pointer); }
+void operator delete (void* pointer, std::align_val_t, std::nothrow_t const&) noexcept { str::alloc::deallocate(pointer); }
+void operator delete[] (void* pointer, std::align_val_t, std::nothrow_t const&) noexcept { str::alloc::deallocate(pointer); }
+#endif
+
 i32 main(i32 argc, char** argv) {
+#if defined(STRC_ALLOC_STATS)
+    str::ScopeExit report = [] { str::alloc::write_report(std::cerr); };
+#endif
+
     auto args = std::span(argv, argc)
         | std::views::drop(1)
         | std::views::transform([] (char* arg) { return std::string_view(arg); });
@@ -34,11 +76,18 @@ i32 main(i32 argc, char** argv) {
         auto subcommand = args[0];
 
         if (subcommand == "run") {
-            return str::run::main();
+            auto options = args | std::views::drop(1) | std::ranges::to<std::vector>();
+            return str::run::main(options);
         } else if (subcommand == "test") {
             return str::test::main();
         } else if (subcommand == "serve") {
-            return str::lsp::main();
+            auto options = args | std::views::drop(1) | std::ranges::to<std::vector>();
+            return str::lsp::main(options);
+        } else if (subcommand == "bench") {
+            return str::bench::main();
+        } else if (subcommand == "watch") {
+            auto options = args | std::views::drop(1) | std::ranges::to<std::vector>();
+            return str::watch::main(options);
         }
     }
 
@@ -53,10 +102,21 @@ i32 main(i32 argc, char** argv) {
         "subcommands:\n"
         "  run        Run the bootstrap compiler\n"
         "  test       Run unit tests on the bootstrap compiler\n"
-        "  serve      Run the bootstrap language server\n\n"
+        "  serve      Run the bootstrap language server\n"
+        "  bench      Run performance measurements on the bootstrap compiler\n"
+        "  watch      Rebuild on every source change, serving builds over a local socket\n\n"
 
         "options:\n"
-        "  There are no options in the bootstrap compiler, it is hardcoded to its only purpose.\n"
+        "  run -j <n>          Parse source units on n threads\n"
+        "  run --lazy-bodies   Parse function bodies only once they are needed\n"
+        "  run --no-cache      Parse every source unit instead of reusing cached trees\n"
+        "  run --mmap          Map source files into memory instead of reading them\n"
+        "  run --time-report   Print how long each compiler phase took\n"
+        "  run --trace=<file>  Write a Chrome trace of every compiler phase, for Perfetto\n"
+        "  run --stats         Print compiler statistics as JSON\n"
+        "  run --stats=<file>  Write compiler statistics as JSON to a file, to diff between builds\n"
+        "  serve --stats       Print language server statistics as JSON on exit, or to a file with --stats=<file>\n"
+        "  watch --client      Ask the running watch daemon for a build\n"
     );
 
     return 0;
@@ -32,15 +32,45 @@
 #include <utility>
 #include <functional>
 #include <ranges>
+#include <algorithm>
+#include <limits>
 #include <meta>
 #include <print>
 #include <expected>
 #include <filesystem>
 #include <ostream>
+#include <fstream>
 #include <iostream>
 #include <cstdio>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <deque>
+#include <list>
+#include <bit>
+#include <memory>
+#include <new>
+#include <thread>
+#include <charconv>
+#include <random>
+#include <chrono>
+#include <tuple>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "coding.hpp"
+#include "uring.hpp"
+#include "alloc.hpp"
+#include "integer.hpp"
 #include "primitive.hpp"
 
+namespace str::cache {
+    class Hooks;
+}
+
 namespace str {
     /// C++ nonsense for discount pattern matching with `std::visit`.
     template <typename... Ts> struct overloaded : Ts... { using Ts::operator()...; };
@@ -61,6 +91,282 @@ namespace str {
         constexpr ~ScopeExit() { fn(); }
     };
 
+    constexpr usize GENERIC_PRECEDENCE = 7;
+    constexpr usize STRICT_PRECEDENCE = 1000;
+
+    constexpr auto precedence(std::string_view pattern) -> usize {
+        if (pattern == "=")   return 0; // Assignment. Not needed here? It is a right associative postfix expression.
+
+        if (pattern == "or")  return 1; // Logical or.
+        if (pattern == "and") return 2; // Logical and.
+
+        if (pattern == "==")  return 3; // Equal to.
+        if (pattern == "!=")  return 3; // Not equal to.
+
+        if (pattern == "<")   return 4; // Less than.
+        if (pattern == "<=")  return 4; // Less than or equal to.
+        if (pattern == ">")   return 4; // Greater than.
+        if (pattern == ">=")  return 4; // Greater than or equal to.
+
+        if (pattern == "+")   return 5; // Addition operator.
+        if (pattern == "-")   return 5; // Subtraction operator.
+
+        if (pattern == "*")   return 6; // Multiplication operator.
+        if (pattern == "/")   return 6; // True division operator.
+        if (pattern == "\\")  return 6; // Pseudo division operator.
+        if (pattern == "%")   return 6; // Remainder operator.
+
+        return 7;
+    }
+
+    /// Keywords the parser dispatches on. Their values are also the symbol ids the interner pre-seeds
+    /// their spellings at, so recognizing a keyword is just reading the symbol of a token.
+    enum class Keyword : u8 {
+        None,
+        Module,
+        Import,
+        Fun,
+        Init,
+        Deinit,
+        Struct,
+        Enum,
+        Category,
+        Extend,
+        Type,
+        Class,
+        Let,
+        Object,
+        Annotation,
+        Decay,
+        Operator,
+        Prefix,
+        Infix,
+        Postfix,
+        Get,
+        Set,
+        Mut,
+        Pub,
+        Unsafe,
+        Open,
+        Override,
+        Inherent,
+        Const,
+        Static,
+        Inline,
+        Implicit,
+        Final,
+        Base,
+        And,
+        Or,
+        Not
+    };
+
+    /// Spellings the lexer recognizes with a perfect hash instead of interning them.
+    namespace builtin {
+        /// Keywords first in the order of `Keyword`, followed by the remaining built in operators.
+        /// The index of a spelling is its pre-seeded symbol id, the empty spelling is the zero symbol.
+        inline constexpr auto spellings = std::to_array<std::string_view>({
+            "",
+            "module", "import", "fun", "init", "deinit", "struct", "enum", "category", "extend", "type",
+            "class", "let", "object", "annotation", "decay", "operator", "prefix", "infix", "postfix",
+            "get", "set", "mut", "pub", "unsafe", "open", "override", "inherent", "const", "static",
+            "inline", "implicit", "final", "base", "and", "or", "not",
+            "=", "==", "!=", "<", "<=", ">", ">=", "+", "-", "*", "/", "\\", "%"
+        });
+
+        inline constexpr usize keyword_count = usize(Keyword::Not) + 1;
+
+        /// The precedence of every spelling, so that the lexer can attach it to the token.
+        inline constexpr auto precedences = [] {
+            std::array<u8, spellings.size()> table = {};
+            for (usize i = 0; i < spellings.size(); i += 1) table[i] = precedence(spellings[i]);
+            return table;
+        }();
+
+        /// FNV-1a, the seed is only mixed in when selecting a slot so the search below stays cheap.
+        constexpr auto hash(std::string_view spelling) -> u32 {
+            u32 hash = 2166136261u;
+
+            for (char c : spelling) {
+                hash ^= u8(c);
+                hash *= 16777619u;
+            }
+
+            return hash;
+        }
+
+        inline constexpr usize slot_count = std::bit_ceil(spellings.size() * 4);
+        inline constexpr usize slot_bits = std::countr_zero(slot_count);
+
+        /// Fibonacci hashing of the seeded hash, taking the high bits which depend on every input bit.
+        constexpr auto slot(u32 hash, u32 seed) -> usize {
+            return u32((hash ^ seed) * 2654435761u) >> (32 - slot_bits);
+        }
+
+        /// The first seed for which no two spellings share a slot, found at compile time.
+        inline constexpr u32 seed = [] {
+            std::array<u32, spellings.size()> hashes = {};
+            for (usize i = 0; i < spellings.size(); i += 1) hashes[i] = hash(spellings[i]);
+
+            for (u32 seed = 0;; seed += 1) {
+                std::array<bool, slot_count> occupied = {};
+                bool perfect = true;
+
+                for (usize i = 1; i < spellings.size() and perfect; i += 1) {
+                    auto index = slot(hashes[i], seed);
+                    perfect = not occupied[index];
+                    occupied[index] = true;
+                }
+
+                if (perfect) return seed;
+            }
+        }();
+
+        /// The spelling index occupying every slot, zero for empty slots.
+        inline constexpr auto slots = [] {
+            std::array<u8, slot_count> table = {};
+            for (usize i = 1; i < spellings.size(); i += 1) table[slot(hash(spellings[i]), seed)] = i;
+            return table;
+        }();
+
+        static_assert(spellings.size() <= std::numeric_limits<u8>::max());
+        static_assert(spellings[usize(Keyword::Not)] == "not");
+
+        /// Answers the pre-seeded symbol id of a built in spelling, or zero if it is not one.
+        constexpr auto find(std::string_view spelling) -> u32 {
+            u8 index = slots[slot(hash(spelling), seed)];
+            return index != 0 and spellings[index] == spelling ? index : 0;
+        }
+
+        static_assert(find("fun") == u32(Keyword::Fun) and find("or") == u32(Keyword::Or) and find("fn") == 0);
+    }
+
+    /// A thread safe table assigning every distinct spelling a dense 32 bit symbol id.
+    ///
+    /// Spellings are owned by the interner and live until the program exits, so views of them can be freely
+    /// shared between source units and threads. Interning only locks the shard selected by the hash of the
+    /// spelling, and answering the spelling of an id never locks.
+    class Interner final {
+        static constexpr usize shard_count = 32;
+        static constexpr usize chunk_bits = 12;
+        static constexpr usize chunk_size = usize(1) << chunk_bits;
+        static constexpr usize chunk_count = usize(1) << 12;
+
+        struct Shard final {
+            std::mutex mutex;
+            std::unordered_map<std::string_view, u32> ids;
+            /// Elements of a deque are never relocated, so views of the spellings remain valid.
+            std::deque<std::string> spellings;
+        };
+
+        std::array<Shard, shard_count> shards;
+        /// The id to spelling table, allocated in chunks so that it can grow without moving published entries.
+        std::array<std::atomic<std::string_view*>, chunk_count> chunks = {};
+        std::atomic<u32> next = 0;
+
+        auto entry(u32 id) -> std::string_view& {
+            auto& chunk = chunks[id >> chunk_bits];
+            auto entries = chunk.load(std::memory_order_acquire);
+
+            if (not entries) {
+                auto fresh = new std::string_view[chunk_size];
+
+                if (chunk.compare_exchange_strong(entries, fresh, std::memory_order_acq_rel)) {
+                    entries = fresh;
+                } else {
+                    delete[] fresh;
+                }
+            }
+
+            return entries[id & (chunk_size - 1)];
+        }
+
+      public:
+        Interner() {
+            // The empty spelling is always the zero symbol, it is what a default symbol refers to.
+            // Built in spellings follow so that their ids match the lexer tables.
+            for (auto spelling : builtin::spellings) intern(spelling);
+        }
+
+        Interner(Interner const&) = delete;
+        Interner(Interner&&) = delete;
+        Interner& operator=(Interner const&) = delete;
+        Interner& operator=(Interner&&) = delete;
+
+        ~Interner() {
+            for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+        }
+
+        /// Answers the symbol id of a spelling, assigning the next one if the spelling was never seen before.
+        auto intern(std::string_view spelling) -> u32 {
+            auto& shard = shards[std::hash<std::string_view>()(spelling) % shard_count];
+            std::scoped_lock lock(shard.mutex);
+
+            if (auto existing = shard.ids.find(spelling); existing != shard.ids.end()) return existing->second;
+
+            u32 id = next.fetch_add(1, std::memory_order_relaxed);
+            if (id >= chunk_size * chunk_count) throw std::length_error("symbol table exhausted");
+
+            std::string_view owned = shard.spellings.emplace_back(spelling);
+            entry(id) = owned;
+            shard.ids.emplace(owned, id);
+
+            return id;
+        }
+
+        /// Answers the spelling of a symbol id. The id must have been answered by this interner.
+        auto spelling(u32 id) const -> std::string_view {
+            return chunks[id >> chunk_bits].load(std::memory_order_acquire)[id & (chunk_size - 1)];
+        }
+
+        /// Answers the count of distinct spellings interned so far.
+        auto count() const -> u32 {
+            return next.load(std::memory_order_relaxed);
+        }
+    };
+
+    /// The interner shared by the whole compiler.
+    inline auto interner() -> Interner& {
+        static Interner instance;
+        return instance;
+    }
+
+    /// An interned spelling of an identifier, operator or path component.
+    ///
+    /// Symbols compare and hash as their integer id, the spelling is only looked up to present them.
+    class Symbol final {
+        u32 id = 0;
+
+        constexpr explicit Symbol(u32 id, std::nullptr_t) noexcept : id(id) {}
+
+      public:
+        constexpr Symbol() noexcept = default;
+        Symbol(std::string_view spelling) : id(interner().intern(spelling)) {}
+
+        /// Answers the symbol of an id previously answered by the interner.
+        static constexpr auto from_id(u32 id) noexcept -> Symbol {
+            return Symbol(id, nullptr);
+        }
+
+        constexpr auto get_id() const noexcept -> u32 {
+            return id;
+        }
+
+        auto spelling() const -> std::string_view {
+            return interner().spelling(id);
+        }
+
+        operator std::string_view() const {
+            return spelling();
+        }
+
+        constexpr auto operator == (Symbol const& other) const noexcept -> bool = default;
+
+        auto operator == (std::string_view other) const -> bool {
+            return spelling() == other;
+        }
+    };
+
     /// A single valid token of the Strawberry language.
     class Token final {
       public:
@@ -125,11 +431,13 @@ namespace str {
         /// A pure identifier, used for a wide range of constructs including keywords.
         struct Identifier final {
             std::string_view content;
+            Symbol symbol;
         };
 
         /// A symbolic identifier, mainly used by operators except for `and` `or` and `not`.
         struct Symbolic final {
             std::string_view content;
+            Symbol symbol;
         };
 
         using Data = std::variant<
@@ -159,87 +467,120 @@ namespace str {
             Symbolic
         >;
 
-        Data data;
-        std::string_view source;
-        u32 position;
-        u32 count;
-        u32 line;
-        u32 column;
+        /// The kind tag of a token, in the same order as the alternatives of `Data`.
+        enum class Kind : u8 {
+            Error,
+            NewLine,
+            ParenLeft,
+            ParenRight,
+            BraceLeft,
+            BraceRight,
+            BracketLeft,
+            BracketRight,
+            Pipe,
+            Comma,
+            Colon,
+            DoubleColon,
+            SemiColon,
+            At,
+            Pound,
+            Tick,
+            Dot,
+            Arrow,
+            Comment,
+            Number,
+            String,
+            MultilineString,
+            Identifier,
+            Symbolic
+        };
 
-        u32 indentation;
-        bool leading_whitespace;
-        bool trailing_whitespace;
+        /// Answers the kind tag corresponding to an alternative of `Data`.
+        template <typename T> static consteval auto kind_of() -> Kind {
+            return [] <usize... I> (std::index_sequence<I...>) {
+                usize index = 0;
+                ((std::same_as<T, std::variant_alternative_t<I, Data>> ? (index = I, true) : false) or ...);
+                return Kind(index);
+            }(std::make_index_sequence<std::variant_size_v<Data>>());
+        }
+
+        // The token is deliberately packed, the parser walks a contiguous buffer of them so the more
+        // fit in a cache line the better. The payload is not stored at all, it is a view of the text
+        // recovered by the token stream, and line and column are derived from the source unit line table.
+        // Identifiers are interned as they are lexed, so only they have a meaningful symbol id.
+        Kind kind;
+        bool leading_whitespace : 1;
+        bool trailing_whitespace : 1;
+        /// Set for symbolic identifiers containing a dot, which are allowed as infix operators without whitespace.
+        bool dotted : 1;
+        /// The precedence of the identifier when used as an infix operator.
+        u8 precedence : 3;
+        u16 source;
+        u32 offset;
+        u32 length;
+        u32 symbol;
 
         template <typename T> auto is() const -> bool {
-            return std::holds_alternative<T>(data);
-        }
-
-        template <typename T> auto is(auto&& predicate) const -> bool {
-            if (std::holds_alternative<T>(data)) {
-                return std::invoke(predicate, std::as_const(std::get<T>(data)));
-            } else {
-                return false;
-            }
-        }
-
-        template <typename T> auto get() const -> T {
-            return std::get<T>(data);
+            return kind == kind_of<T>();
         }
 
-        template <typename T> auto get_as() const -> std::optional<T> {
-            if (std::holds_alternative<T>(data)) {
-                return std::get<T>(data);
-            } else {
-                return std::nullopt;
-            }
+        /// Answers the keyword of an identifier token, or `Keyword::None` for every other token.
+        auto keyword() const -> Keyword {
+            return kind == Kind::Identifier and symbol < builtin::keyword_count ? Keyword(symbol) : Keyword::None;
         }
 
-        /// For a symbolic or pure identifier it answers the content, otherwise `std::nullopt`
-        auto identifier_content() const -> std::optional<std::string_view> {
-            return std::visit(overloaded {
-                [] (Token::Identifier tok) -> std::optional<std::string_view> { return tok.content; },
-                [] (Token::Symbolic tok) -> std::optional<std::string_view> { return tok.content; },
-                [] (auto tok) -> std::optional<std::string_view> { return std::nullopt; }
-            }, data);
-        }
+        auto operator==(Token const&) const -> bool = default;
 
       private:
         friend class TokenStream;
+        friend class cache::Hooks;
 
         constexpr Token(
-            std::string_view source,
-            u32 position,
-            u32 count,
-            u32 line,
-            u32 column,
-            u32 indentation,
+            Kind kind,
+            u16 source,
+            u32 offset,
+            u32 length,
+            u32 symbol,
             bool leading_whitespace,
             bool trailing_whitespace,
-            Data data
-        ) : data(data)
-          , source(source)
-          , position(position)
-          , count(count)
-          , line(line)
-          , column(column)
-          , indentation(indentation)
+            bool dotted,
+            u8 precedence
+        ) : kind(kind)
           , leading_whitespace(leading_whitespace)
           , trailing_whitespace(trailing_whitespace)
+          , dotted(dotted)
+          , precedence(precedence)
+          , source(source)
+          , offset(offset)
+          , length(length)
+          , symbol(symbol)
         {}
     };
 
+    static_assert(sizeof(Token) == 16);
+    static_assert(std::variant_size_v<Token::Data> == usize(Token::Kind::Symbolic) + 1);
+
     /// A unified domain describing where in the source unit text (if anywhere) a construct originates.
     class Provenance final {
       public:
-        /// An exact token span.
+        /// An exact span of source text, as a half open byte range into the text of a source unit.
+        ///
+        /// Spans are stored in every node and diagnostic, so they only keep what is needed to find the text again.
+        /// Lines and columns are derived from the source unit line table only when a span is presented.
         struct Span final {
-            Token start;
-            Token end;
+            u16 source;
+            u32 begin;
+            u32 end;
+
+            /// Answers the offset of the last byte in the span, or the start of an empty span.
+            constexpr auto last() const -> u32 {
+                return end > begin ? end - 1 : begin;
+            }
         };
 
         /// A generic source unit provenance uncertain about the exact origin.
         struct Source final {
-            std::string_view source;
+            u16 source;
         };
 
         // TODO: Third provenance class, `Synthetic`.
@@ -249,10 +590,13 @@ namespace str {
 
         Data data;
 
-        constexpr Provenance(Token start, Token end) noexcept : data(Span(start, end)) {}
+        constexpr Provenance(Span span) noexcept : data(span) {}
+        constexpr explicit Provenance(Data data) noexcept : data(data) {}
+        constexpr Provenance(Token start, Token end) noexcept
+            : data(Span(start.source, start.offset, end.offset + end.length)) {}
         constexpr Provenance(Token token) noexcept : Provenance(token, token) {}
 
-        constexpr explicit Provenance(std::string_view source) noexcept : data(Source(source)) {}
+        constexpr explicit Provenance(u16 source) noexcept : data(Source(source)) {}
 
         /// Utility for merging provenances together if possible.
         constexpr Provenance(Provenance start, Provenance end) noexcept : Provenance(merge(start, end)) {}
@@ -260,16 +604,17 @@ namespace str {
       private:
         static constexpr auto merge(Provenance start, Provenance end) -> Provenance {
             if (std::holds_alternative<Span>(start.data) and std::holds_alternative<Span>(end.data)) {
-                return Provenance(
-                    std::get<Provenance::Span>(start.data).start,
-                    std::get<Provenance::Span>(end.data).end
-                );
+                auto start_span = std::get<Span>(start.data);
+                auto end_span = std::get<Span>(end.data);
+                return Span(start_span.source, start_span.begin, end_span.end);
             } else {
                 return start;
             }
         }
     };
 
+    static_assert(sizeof(Provenance) <= 16);
+
     /// A compile diagnostic, used to communicate issues during the compilation process.
     ///
     /// Diagnostics are all associated with provenance information identifying as precisely as possible
@@ -306,7 +651,12 @@ namespace str {
             : severity(severity), provenance(provenance), reason(std::move(reason)) {}
 
         /// Constructs a diagnostic with a reason and helpful description.
-        constexpr Diagnostic(Severity severity, Provenance provenance, std::string reason, std::string help) noexcept
+        constexpr Diagnostic(
+            Severity severity,
+            Provenance provenance,
+            std::string reason,
+            std::optional<std::string> help
+        ) noexcept
             : severity(severity), provenance(provenance), reason(std::move(reason)), help(std::move(help)) {}
 
         auto what() const noexcept -> char const* override {
@@ -353,127 +703,771 @@ namespace str {
             return Diagnostic(Severity::Runtime, provenance, std::move(reason), std::move(help));
         }
     };
-}
-
-template <> struct std::formatter<str::Token, char> {
-    constexpr auto parse(std::format_parse_context& ctx) {
-        auto it = ctx.begin();
-        if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Token");
-        return it;
-    }
-
-    constexpr auto format(str::Token const& token, std::format_context& ctx) const {
-        using namespace str;
-        return std::visit(overloaded {
-            [&ctx] (Token::Error _)        { return std::format_to(ctx.out(), "Error");        },
-            [&ctx] (Token::NewLine _)      { return std::format_to(ctx.out(), "NewLine");      },
-            [&ctx] (Token::ParenLeft _)    { return std::format_to(ctx.out(), "ParenLeft");    },
-            [&ctx] (Token::ParenRight _)   { return std::format_to(ctx.out(), "ParenRight");   },
-            [&ctx] (Token::BraceLeft _)    { return std::format_to(ctx.out(), "BraceLeft");    },
-            [&ctx] (Token::BraceRight _)   { return std::format_to(ctx.out(), "BraceRight");   },
-            [&ctx] (Token::BracketLeft _)  { return std::format_to(ctx.out(), "BracketLeft");  },
-            [&ctx] (Token::BracketRight _) { return std::format_to(ctx.out(), "BracketRight"); },
-            [&ctx] (Token::Pipe _)         { return std::format_to(ctx.out(), "Pipe");         },
-            [&ctx] (Token::Comma _)        { return std::format_to(ctx.out(), "Comma");        },
-            [&ctx] (Token::Colon _)        { return std::format_to(ctx.out(), "Colon");        },
-            [&ctx] (Token::DoubleColon _)  { return std::format_to(ctx.out(), "DoubleColon");  },
-            [&ctx] (Token::SemiColon _)    { return std::format_to(ctx.out(), "SemiColon");    },
-            [&ctx] (Token::At _)           { return std::format_to(ctx.out(), "At");           },
-            [&ctx] (Token::Pound _)        { return std::format_to(ctx.out(), "Pound");        },
-            [&ctx] (Token::Tick _)         { return std::format_to(ctx.out(), "Tick");         },
-            [&ctx] (Token::Dot _)          { return std::format_to(ctx.out(), "Dot");          },
-            [&ctx] (Token::Arrow _)        { return std::format_to(ctx.out(), "Arrow");        },
 
-            [&ctx] (Token::Comment tok) {
-                return std::format_to(ctx.out(), "Comment(selector: {}, content: {})", tok.selector, tok.content);
-            },
-            [&ctx] (Token::Number tok) {
-                return std::format_to(ctx.out(), "Number(content: {})", tok.content);
-            },
-            [&ctx] (Token::String tok) {
-                return std::format_to(ctx.out(), "String(content: {})", tok.content);
-            },
-            [&ctx] (Token::MultilineString tok) {
-                return std::format_to(ctx.out(), "MultilineString(content: {})", tok.content);
-            },
-            [&ctx] (Token::Identifier tok) {
-                return std::format_to(ctx.out(), "Identifier(content: {})", tok.content);
-            },
-            [&ctx] (Token::Symbolic tok) {
-                return std::format_to(ctx.out(), "Symbolic(content: {})", tok.content);
-            }
-        }, token.data);
-    }
-};
+    /// A one based line and column within the text of a source unit.
+    struct Location final {
+        u32 line;
+        u32 column;
+    };
 
-namespace str {
-    /// A validated stream of Strawberry tokens with very powerful pattern matching templates and other utilities.
-    /// All tokens it produces are bound by the lifetime of the provided text and source views it operates on.
-    class TokenStream final {
+    /// The text of a single source file along with its identity.
+    ///
+    /// The text is a view into storage the unit shares ownership of. Units loaded together share
+    /// a single buffer holding all of their texts.
+    struct SourceUnit final {
         std::string_view text;
-        std::string_view source;
-        u32 index = 0;
-        u32 line = 1;
-        u32 column = 1;
-        u32 consumed_count = 0;
-        u32 indentation = 0;
-        std::optional<Token> last_token;
-        std::vector<Token> provenance_stack;
+        std::string source;
+        /// The small integer identity tokens and provenance use to refer to the source unit.
+        u16 id = 0;
+        /// The byte offset at which every line of the text starts, in order.
+        std::vector<u32> lines = {};
+        /// Keeps the storage the text views alive.
+        std::shared_ptr<const void> storage = nullptr;
+
+        /// Makes a source unit owning a copy of the text, with its line table built.
+        static auto from_string(std::string text, std::string source, u16 id = 0) -> SourceUnit {
+            auto owned = std::make_shared<const std::string>(std::move(text));
+
+            SourceUnit source_unit {
+                .text = *owned,
+                .source = std::move(source),
+                .id = id,
+                .storage = std::move(owned)
+            };
+            source_unit.index_lines();
 
-      public:
-        /// Answers a view of the text of the source unit being tokenized.
-        auto get_text() const -> std::string_view {
-            return text;
+            return source_unit;
         }
 
-        /// Answers the source identity of the source unit being tokenized.
-        auto get_source() const -> std::string_view {
-            return source;
+        /// Builds the line start table, it must be done once after the text is loaded.
+        void index_lines() {
+            lines.clear();
+            lines.push_back(0);
+
+            for (usize i = 0; i < text.size(); i += 1) {
+                if (text[i] == '\n') lines.push_back(i + 1);
+            }
         }
 
-      private:
-        void unchecked_span_push() {
-            std::optional token = peek();
-            if (not token) throw Diagnostic::error(failure_provenance(), "unexpected end of stream");
-            provenance_stack.push_back(*token);
+        /// Answers the location of a byte offset into the text.
+        auto location(u32 offset) const -> Location {
+            auto next = std::ranges::upper_bound(lines, offset);
+            u32 line = std::ranges::distance(lines.begin(), next);
+            return { .line = line, .column = offset - lines[line - 1] + 1 };
         }
 
-        auto unchecked_span_pop() -> Provenance {
-            if (not last_token) std::logic_error("attempted to obtain provenance span without consuming tokens");
+        /// Answers the text of a one based line, without its line terminator.
+        auto line(u32 number) const -> std::string_view {
+            if (number == 0 or number > lines.size()) return {};
 
-            Token start = provenance_stack.back(); provenance_stack.pop_back();
-            Token end = *last_token;
+            u32 start = lines[number - 1];
+            u32 end = number < lines.size() ? lines[number] - 1 : text.size();
 
-            return { start, end };
+            return text.substr(start, end - start);
         }
+    };
+}
 
-        friend constexpr auto tokenize(std::string_view text, std::string_view source) -> TokenStream;
+namespace str::trace {
+    /// Whether scopes record anything. It is set before any work starts and never changes while scopes
+    /// are alive, so it is read without synchronization and a disabled scope costs a single branch.
+    inline bool enabled = false;
+
+    /// A finished scope, with times in nanoseconds since tracing started.
+    struct Event final {
+        /// The phase, always a string literal.
+        std::string_view name;
+        /// What the phase worked on, such as a source path or a declaration.
+        std::string detail;
+        u64 begin;
+        u64 duration;
+        /// A small id of the recording thread, in order of the first event each thread recorded.
+        u32 thread;
+    };
 
-        constexpr TokenStream(std::string_view text, std::string_view source)
-            : text(text), source(source){}
+    namespace detail {
+        /// The events of one thread. Threads only ever append to their own buffer, so no lock is held
+        /// while recording; the lock only guards registering a buffer.
+        struct Buffer final {
+            u32 thread;
+            std::vector<Event> events;
+        };
 
-      public:
-        /// A scope guard ensuring that
-        class ProvenanceScope final {
-            friend class TokenStream;
+        inline std::mutex mutex;
+        /// A deque so buffers never move while their threads hold on to them.
+        inline std::deque<Buffer> buffers;
+        inline std::chrono::steady_clock::time_point epoch;
 
-            TokenStream* tokens;
-            i32 exceptions;
+        inline auto buffer() -> Buffer& {
+            thread_local Buffer* buffer = nullptr;
 
-            explicit ProvenanceScope(TokenStream* tokens) : tokens(tokens), exceptions(std::uncaught_exceptions()) {}
+            if (not buffer) {
+                std::lock_guard lock(mutex);
+                buffer = &buffers.emplace_back(Buffer { .thread = u32(buffers.size()) });
+            }
 
-          public:
-            ProvenanceScope(ProvenanceScope const&) = delete;
-            ProvenanceScope(ProvenanceScope&&) = delete;
-            ProvenanceScope& operator=(ProvenanceScope const&) = delete;
-            ProvenanceScope& operator=(ProvenanceScope&&) = delete;
+            return *buffer;
+        }
 
-            ~ProvenanceScope() noexcept(false) {
-                if (tokens and exceptions == std::uncaught_exceptions())
-                    throw std::logic_error("unconsumed provenance stack scope");
-            }
+        inline auto now() -> u64 {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+        }
 
-            /// Balances the span answering the resulting provenance at the current point in time.
+        /// Escapes a string for a JSON string literal.
+        inline void escape(std::string& out, std::string_view text) {
+            for (char c : text) {
+                switch (c) {
+                    case '"':  out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n";  break;
+                    case '\t': out += "\\t";  break;
+                    default:
+                        if (u8(c) < 0x20) {
+                            std::format_to(std::back_inserter(out), "\\u{:04x}", u8(c));
+                        } else {
+                            out += c;
+                        }
+                }
+            }
+        }
+    }
+
+    /// Starts recording, from a single thread before any scope is opened. That thread gets the first id.
+    inline void start() {
+        detail::epoch = std::chrono::steady_clock::now();
+        detail::buffer();
+        enabled = true;
+    }
+
+    /// Times the enclosing block as the given phase.
+    ///
+    /// When tracing is disabled nothing is read from the clock and the detail is never built, which is
+    /// why it is given as a function rather than a string.
+    class Scope final {
+        std::string_view name;
+        std::string detail;
+        u64 begin = 0;
+        bool active;
+
+      public:
+        explicit Scope(std::string_view name) : name(name), active(enabled) {
+            if (active) begin = detail::now();
+        }
+
+        Scope(std::string_view name, std::invocable auto&& describe) : Scope(name) {
+            if (active) detail = describe();
+        }
+
+        Scope(Scope const&) = delete;
+        auto operator = (Scope const&) -> Scope& = delete;
+
+        /// Sets the detail after the fact, for work that only knows what it was once it is done.
+        void describe(std::invocable auto&& describe) {
+            if (active) detail = describe();
+        }
+
+        ~Scope() {
+            if (not active) return;
+
+            u64 end = detail::now();
+            auto& buffer = detail::buffer();
+            buffer.events.push_back(Event {
+                .name = name,
+                .detail = std::move(detail),
+                .begin = begin,
+                .duration = end - begin,
+                .thread = buffer.thread
+            });
+        }
+    };
+
+    /// Answers every recorded event ordered by start time. It must only be called once every thread
+    /// which recorded events has finished or joined.
+    inline auto events() -> std::vector<Event> {
+        std::lock_guard lock(detail::mutex);
+
+        std::vector<Event> events;
+        for (auto const& buffer : detail::buffers) events.append_range(buffer.events);
+
+        std::ranges::sort(events, {}, &Event::begin);
+        return events;
+    }
+
+    /// Writes a summary of where the time went, per phase, with the slowest phase first.
+    ///
+    /// Phases running on several threads are summed over them, so their totals can exceed the wall time.
+    /// Nested phases are also counted within the phases containing them.
+    inline void write_time_report(std::ostream& out, std::span<const Event> events) {
+        struct Phase final {
+            std::string_view name;
+            u64 total = 0;
+            u64 longest = 0;
+            usize count = 0;
+        };
+
+        std::vector<Phase> phases;
+        u64 end = 0;
+
+        for (auto const& event : events) {
+            auto phase = std::ranges::find(phases, event.name, &Phase::name);
+            if (phase == phases.end()) phase = phases.insert(phases.end(), Phase { .name = event.name });
+
+            phase->total += event.duration;
+            phase->longest = std::max(phase->longest, event.duration);
+            phase->count += 1;
+            end = std::max(end, event.begin + event.duration);
+        }
+
+        std::ranges::sort(phases, std::ranges::greater(), &Phase::total);
+
+        auto ms = [] (u64 ns) { return f64(ns) / 1e6; };
+
+        std::println(out, "{:<16} {:>12} {:>8} {:>12}", "phase", "total", "count", "longest");
+        for (auto const& phase : phases) {
+            std::println(
+                out, "{:<16} {:>9.3f} ms {:>8} {:>9.3f} ms",
+                phase.name, ms(phase.total), phase.count, ms(phase.longest)
+            );
+        }
+        std::println(out, "{:<16} {:>9.3f} ms", "wall", ms(end));
+    }
+
+    /// Writes the events in the Chrome trace event format, which Perfetto and `chrome://tracing` load.
+    inline void write_chrome_trace(std::ostream& out, std::span<const Event> events) {
+        std::string json = "{\"traceEvents\":[";
+        u32 threads = 0;
+
+        for (auto const& event : events) {
+            threads = std::max(threads, event.thread + 1);
+
+            std::format_to(
+                std::back_inserter(json),
+                "{{\"name\":\"{}\",\"cat\":\"strc\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":1,\"tid\":{}",
+                event.name, f64(event.begin) / 1e3, f64(event.duration) / 1e3, event.thread
+            );
+
+            if (not event.detail.empty()) {
+                json += ",\"args\":{\"detail\":\"";
+                detail::escape(json, event.detail);
+                json += "\"}";
+            }
+
+            json += "},";
+        }
+
+        for (u32 thread = 0; thread < threads; thread += 1) {
+            std::format_to(
+                std::back_inserter(json),
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}},",
+                thread, thread == 0 ? std::string("main") : std::format("worker {}", thread)
+            );
+        }
+
+        if (json.back() == ',') json.pop_back();
+        json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+        out << json;
+    }
+}
+
+namespace str::stats {
+    /// Whether statistics are recorded. Like tracing it is set before any work starts, so a disabled
+    /// statistic costs a single branch.
+    inline bool enabled = false;
+
+    /// A named statistic, registered when it is constructed.
+    ///
+    /// Statistics are meant to be defined next to the code recording them, as inline variables or static
+    /// members, so that they all register during static initialization before anything is recorded.
+    class Statistic {
+        std::string_view name;
+        Statistic* next;
+
+        static inline Statistic* registry = nullptr;
+
+      protected:
+        explicit Statistic(std::string_view name) : name(name), next(std::exchange(registry, this)) {}
+
+      public:
+        Statistic(Statistic const&) = delete;
+        auto operator = (Statistic const&) -> Statistic& = delete;
+
+        virtual ~Statistic() = default;
+
+        auto get_name() const -> std::string_view { return name; }
+
+        /// Appends the value as JSON.
+        virtual void write(std::string& json) const = 0;
+
+        /// Answers every registered statistic ordered by name.
+        static auto all() -> std::vector<Statistic const*> {
+            std::vector<Statistic const*> statistics;
+            for (Statistic const* statistic = registry; statistic; statistic = statistic->next) {
+                statistics.push_back(statistic);
+            }
+
+            std::ranges::sort(statistics, {}, &Statistic::get_name);
+            return statistics;
+        }
+    };
+
+    namespace detail {
+        /// Statistics are recorded from every parsing thread, so their values are split into shards
+        /// threads are spread over, each on its own cache line, and summed when read.
+        inline constexpr usize SHARD_COUNT = 16;
+
+        inline auto shard() -> usize {
+            static std::atomic<usize> next = 0;
+            thread_local usize shard = next.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+            return shard;
+        }
+
+        template <usize N> struct alignas(64) Cells final {
+            std::array<std::atomic<u64>, N> values {};
+        };
+
+        template <usize N> auto sum(std::array<Cells<N>, SHARD_COUNT> const& shards, usize index) -> u64 {
+            u64 total = 0;
+            for (auto const& cells : shards) total += cells.values[index].load(std::memory_order_relaxed);
+            return total;
+        }
+    }
+
+    /// A count of events or of an amount, such as tokens lexed or bytes read.
+    class Counter final : public Statistic {
+        std::array<detail::Cells<1>, detail::SHARD_COUNT> shards;
+
+      public:
+        explicit Counter(std::string_view name) : Statistic(name) {}
+
+        void add(u64 amount = 1) {
+            if (enabled) shards[detail::shard()].values[0].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        auto get() const -> u64 { return detail::sum(shards, 0); }
+
+        void write(std::string& json) const override {
+            std::format_to(std::back_inserter(json), "{}", get());
+        }
+    };
+
+    /// A value read only when statistics are written, for state which is already tracked elsewhere.
+    class Gauge final : public Statistic {
+        auto (*read)() -> u64;
+
+      public:
+        Gauge(std::string_view name, auto (*read)() -> u64) : Statistic(name), read(read) {}
+
+        void write(std::string& json) const override {
+            std::format_to(std::back_inserter(json), "{}", read());
+        }
+    };
+
+    /// A distribution of values in power of two buckets, along with their count and sum.
+    class Histogram final : public Statistic {
+        /// Bucket `i` holds the values `i` bits wide, the last two cells are the count and the sum.
+        static constexpr usize BUCKETS = 65;
+
+        std::array<detail::Cells<BUCKETS + 2>, detail::SHARD_COUNT> shards;
+
+      public:
+        explicit Histogram(std::string_view name) : Statistic(name) {}
+
+        void record(u64 value) {
+            if (not enabled) return;
+
+            auto& values = shards[detail::shard()].values;
+            values[std::bit_width(value)].fetch_add(1, std::memory_order_relaxed);
+            values[BUCKETS].fetch_add(1, std::memory_order_relaxed);
+            values[BUCKETS + 1].fetch_add(value, std::memory_order_relaxed);
+        }
+
+        /// Writes the buckets as an object keyed by the smallest value each holds, leaving out empty ones.
+        void write(std::string& json) const override {
+            auto out = std::back_inserter(json);
+
+            std::format_to(out, "{{\"count\":{},\"sum\":{},\"buckets\":{{", detail::sum(shards, BUCKETS), detail::sum(shards, BUCKETS + 1));
+
+            bool first = true;
+            for (usize bucket = 0; bucket < BUCKETS; bucket += 1) {
+                u64 count = detail::sum(shards, bucket);
+                if (count == 0) continue;
+
+                u64 low = bucket == 0 ? 0 : u64(1) << (bucket - 1);
+                std::format_to(out, "{}\"{}\":{}", first ? "" : ",", low, count);
+                first = false;
+            }
+
+            json += "}}";
+        }
+    };
+
+    /// A count per alternative of a variant, such as syntax tree nodes by kind.
+    template <typename Variant> class KindCounter final : public Statistic {
+        static constexpr usize KINDS = std::variant_size_v<Variant>;
+
+        std::array<detail::Cells<KINDS>, detail::SHARD_COUNT> shards;
+
+      public:
+        explicit KindCounter(std::string_view name) : Statistic(name) {}
+
+        void add(Variant const& variant, u64 amount = 1) {
+            if (enabled) shards[detail::shard()].values[variant.index()].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        /// Writes an object keyed by the name of every alternative, including the ones never counted,
+        /// so that dumps of different builds line up.
+        void write(std::string& json) const override {
+            auto out = std::back_inserter(json);
+            json += '{';
+
+            [&] <usize... I> (std::index_sequence<I...>) {
+                ((std::format_to(
+                    out, "{}\"{}\":{}",
+                    I == 0 ? "" : ",",
+                    std::meta::identifier_of(std::meta::dealias(^^std::variant_alternative_t<I, Variant>)),
+                    detail::sum(shards, I)
+                )), ...);
+            }(std::make_index_sequence<KINDS>());
+
+            json += '}';
+        }
+    };
+
+    /// Writes every statistic as a single JSON object keyed by name, in name order so dumps diff cleanly.
+    inline void write_json(std::ostream& out) {
+        std::string json = "{\n";
+
+        auto statistics = Statistic::all();
+        for (usize index = 0; index < statistics.size(); index += 1) {
+            std::format_to(std::back_inserter(json), "  \"{}\": ", statistics[index]->get_name());
+            statistics[index]->write(json);
+            json += index + 1 < statistics.size() ? ",\n" : "\n";
+        }
+
+        json += "}\n";
+        out << json;
+    }
+}
+
+template <> struct std::hash<str::Symbol> {
+    auto operator()(str::Symbol symbol) const noexcept -> usize {
+        return std::hash<u32>()(symbol.get_id());
+    }
+};
+
+template <> struct std::formatter<str::Symbol, char> : std::formatter<std::string_view, char> {
+    auto format(str::Symbol symbol, std::format_context& ctx) const {
+        return std::formatter<std::string_view, char>::format(symbol.spelling(), ctx);
+    }
+};
+
+namespace str::stats {
+    inline Gauge interned_symbols { "interner.symbols", [] -> u64 { return interner().count(); } };
+}
+
+template <> struct std::formatter<str::Token::Data, char> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto it = ctx.begin();
+        if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Token");
+        return it;
+    }
+
+    constexpr auto format(str::Token::Data const& data, std::format_context& ctx) const {
+        using namespace str;
+        return std::visit(overloaded {
+            [&ctx] (Token::Error _)        { return std::format_to(ctx.out(), "Error");        },
+            [&ctx] (Token::NewLine _)      { return std::format_to(ctx.out(), "NewLine");      },
+            [&ctx] (Token::ParenLeft _)    { return std::format_to(ctx.out(), "ParenLeft");    },
+            [&ctx] (Token::ParenRight _)   { return std::format_to(ctx.out(), "ParenRight");   },
+            [&ctx] (Token::BraceLeft _)    { return std::format_to(ctx.out(), "BraceLeft");    },
+            [&ctx] (Token::BraceRight _)   { return std::format_to(ctx.out(), "BraceRight");   },
+            [&ctx] (Token::BracketLeft _)  { return std::format_to(ctx.out(), "BracketLeft");  },
+            [&ctx] (Token::BracketRight _) { return std::format_to(ctx.out(), "BracketRight"); },
+            [&ctx] (Token::Pipe _)         { return std::format_to(ctx.out(), "Pipe");         },
+            [&ctx] (Token::Comma _)        { return std::format_to(ctx.out(), "Comma");        },
+            [&ctx] (Token::Colon _)        { return std::format_to(ctx.out(), "Colon");        },
+            [&ctx] (Token::DoubleColon _)  { return std::format_to(ctx.out(), "DoubleColon");  },
+            [&ctx] (Token::SemiColon _)    { return std::format_to(ctx.out(), "SemiColon");    },
+            [&ctx] (Token::At _)           { return std::format_to(ctx.out(), "At");           },
+            [&ctx] (Token::Pound _)        { return std::format_to(ctx.out(), "Pound");        },
+            [&ctx] (Token::Tick _)         { return std::format_to(ctx.out(), "Tick");         },
+            [&ctx] (Token::Dot _)          { return std::format_to(ctx.out(), "Dot");          },
+            [&ctx] (Token::Arrow _)        { return std::format_to(ctx.out(), "Arrow");        },
+
+            [&ctx] (Token::Comment tok) {
+                return std::format_to(ctx.out(), "Comment(selector: {}, content: {})", tok.selector, tok.content);
+            },
+            [&ctx] (Token::Number tok) {
+                return std::format_to(ctx.out(), "Number(content: {})", tok.content);
+            },
+            [&ctx] (Token::String tok) {
+                return std::format_to(ctx.out(), "String(content: {})", tok.content);
+            },
+            [&ctx] (Token::MultilineString tok) {
+                return std::format_to(ctx.out(), "MultilineString(content: {})", tok.content);
+            },
+            [&ctx] (Token::Identifier tok) {
+                return std::format_to(ctx.out(), "Identifier(content: {})", tok.content);
+            },
+            [&ctx] (Token::Symbolic tok) {
+                return std::format_to(ctx.out(), "Symbolic(content: {})", tok.content);
+            }
+        }, data);
+    }
+};
+
+/// Bulk character scanning used by the lexer for the bodies of long tokens and whitespace runs.
+///
+/// Every scan has a vectorized path which classifies a whole chunk of bytes at once and falls back to
+/// the scalar loop for the chunk containing the first mismatch and for the tail of the text, so both
+/// paths always answer the exact same position.
+namespace str::scan {
+    /// Selects the vectorized scanning path, the scalar path is kept for comparison and verification.
+    inline bool vectorized = true;
+
+    /// The count of bytes classified at once, matching the narrowest vector registers of supported targets.
+    inline constexpr usize width = 16;
+
+    using Chunk = u8 __attribute__((vector_size(width)));
+
+    /// Loads a chunk of bytes without any alignment requirement.
+    inline auto load(char const* data) -> Chunk {
+        Chunk chunk;
+        std::memcpy(&chunk, data, width);
+        return chunk;
+    }
+
+    /// Character class flags, combined in a lookup table indexed by byte.
+    enum Class : u8 {
+        /// Valid in number literals.
+        Digit = 1 << 0,
+        /// Valid in pure identifiers.
+        Pure = 1 << 1,
+        /// Valid in symbolic identifiers.
+        Symbolic = 1 << 2
+    };
+
+    /// The class of every byte, it mirrors the character predicates of the lexer exactly.
+    inline constexpr auto classes = [] {
+        std::array<u8, 256> table = {};
+
+        for (usize byte = 0; byte < table.size(); byte += 1) {
+            char c = char(byte);
+
+            bool alphanumeric = (c >= '0' and c <= '9') or (c >= 'A' and c <= 'Z') or (c >= 'a' and c <= 'z');
+            bool valid = not (c >= 0 and c <= 31) and c != 127 and not std::string_view(" \"#'(),:;@[]{}`").contains(c);
+
+            if (alphanumeric)                            table[byte] |= Digit;
+            if (alphanumeric or c == '_')                table[byte] |= Pure;
+            if (valid and not alphanumeric and c != '_') table[byte] |= Symbolic;
+        }
+
+        return table;
+    }();
+
+    /// Answers true if the character belongs to any of the classes.
+    constexpr auto is(char c, u8 mask) -> bool {
+        return classes[u8(c)] & mask;
+    }
+
+    /// Answers the index of the first occurrence of either character at or after an index,
+    /// or the size of the text if there is none.
+    inline auto find(std::string_view text, usize index, char a, char b) -> usize {
+        if (vectorized) {
+            while (index + width <= text.size()) {
+                auto chunk = load(text.data() + index);
+                if (__builtin_reduce_or((chunk == u8(a)) | (chunk == u8(b)))) break;
+                index += width;
+            }
+        }
+
+        while (index < text.size() and text[index] != a and text[index] != b) index += 1;
+        return index;
+    }
+
+    /// Answers the index of the first occurrence of a character at or after an index,
+    /// or the size of the text if there is none.
+    inline auto find(std::string_view text, usize index, char c) -> usize {
+        return find(text, index, c, c);
+    }
+
+    /// Answers the index of the first character other than a space at or after an index,
+    /// or the size of the text if there is none.
+    inline auto skip_spaces(std::string_view text, usize index) -> usize {
+        if (vectorized) {
+            while (index + width <= text.size()) {
+                auto chunk = load(text.data() + index);
+                if (not __builtin_reduce_and(chunk == u8(' '))) break;
+                index += width;
+            }
+        }
+
+        while (index < text.size() and text[index] == ' ') index += 1;
+        return index;
+    }
+
+    /// Answers the index of the first character not valid in pure identifiers at or after an index,
+    /// or the size of the text if there is none.
+    inline auto skip_pure(std::string_view text, usize index) -> usize {
+        if (vectorized) {
+            while (index + width <= text.size()) {
+                auto chunk = load(text.data() + index);
+
+                // Unsigned wrapping turns every range check into a single comparison.
+                auto pure =
+                    (Chunk(chunk - u8('0')) < 10) | (Chunk(chunk - u8('A')) < 26) |
+                    (Chunk(chunk - u8('a')) < 26) | (chunk == u8('_'));
+
+                if (not __builtin_reduce_and(pure)) break;
+                index += width;
+            }
+        }
+
+        while (index < text.size() and is(text[index], Pure)) index += 1;
+        return index;
+    }
+}
+
+namespace str {
+    namespace stats {
+        inline Counter lexed_tokens { "lexer.tokens" };
+        inline Counter peeks { "lexer.peeks" };
+        inline Histogram tokens_per_unit { "lexer.tokens_per_unit" };
+    }
+
+    /// A validated stream of Strawberry tokens with very powerful pattern matching templates and other utilities.
+    /// All tokens it produces are bound by the lifetime of the provided text and source views it operates on.
+    ///
+    /// The source unit is lexed exactly once into a contiguous token buffer when the stream is created,
+    /// the parser then walks the buffer by index so that lookahead of any distance is just an array read.
+    class TokenStream final {
+        std::string_view text;
+        std::string_view source;
+        u16 id;
+        u32 index = 0;
+        u32 consumed_count = 0;
+        std::vector<Token> buffer;
+        /// A diagnostic thrown by the lexer, it is rethrown once the parser reaches the erroneous token
+        /// so that diagnostics surface in the same order as they would if the text was lexed on demand.
+        std::optional<Diagnostic> pending;
+        u32 cursor = 0;
+        std::optional<Token> last_token;
+        std::vector<u32> provenance_stack;
+        u64 lexed_count = 0;
+        u64 streaming_lexed_count = 0;
+        u64 peek_count = 0;
+
+      public:
+        /// Answers a view of the text of the source unit being tokenized.
+        auto get_text() const -> std::string_view {
+            return text;
+        }
+
+        /// Answers the source identity of the source unit being tokenized.
+        auto get_source() const -> std::string_view {
+            return source;
+        }
+
+        /// Answers the small integer identity of the source unit being tokenized.
+        auto get_id() const -> u16 {
+            return id;
+        }
+
+        /// Answers the tokens lexed from the text, up to the first lexer diagnostic if there was one.
+        auto get_tokens() const -> std::span<const Token> {
+            return buffer;
+        }
+
+        /// Answers the count of tokens produced by the lexer, which is exactly the size of the token buffer.
+        auto get_lexed_count() const -> u64 {
+            return lexed_count;
+        }
+
+        /// Answers the count of tokens a streaming token stream would have had to lex to answer the same
+        /// requests, where every peek re-lexes its entire lookahead. Kept around to measure the buffer against.
+        auto get_streaming_lexed_count() const -> u64 {
+            return streaming_lexed_count;
+        }
+
+        /// Adds the counts of this stream to the statistics, once it has been parsed.
+        void record_statistics() const {
+            stats::lexed_tokens.add(lexed_count);
+            stats::peeks.add(peek_count);
+            stats::tokens_per_unit.record(lexed_count);
+        }
+
+      private:
+        void unchecked_span_push() {
+            std::optional token = peek();
+            if (not token) throw Diagnostic::error(failure_provenance(), "unexpected end of stream");
+            provenance_stack.push_back(token->offset);
+        }
+
+        auto unchecked_span_pop() -> Provenance {
+            if (not last_token) std::logic_error("attempted to obtain provenance span without consuming tokens");
+
+            u32 begin = provenance_stack.back(); provenance_stack.pop_back();
+            u32 end = last_token->offset + last_token->length;
+
+            return Provenance::Span(id, begin, end);
+        }
+
+        friend auto tokenize(SourceUnit const& source_unit) -> TokenStream;
+
+        explicit TokenStream(SourceUnit const& source_unit)
+            : text(source_unit.text), source(source_unit.source), id(source_unit.id)
+        {
+            materialize();
+        }
+
+        TokenStream(std::string_view text, std::string_view source, u16 id, std::span<const Token> tokens)
+            : text(text), source(source), id(id), buffer(tokens.begin(), tokens.end()) {}
+
+      public:
+        /// Answers a stream over tokens lexed earlier from the given text, without lexing anything.
+        /// This is how deferred bodies are parsed long after the original stream is gone.
+        static auto replay(std::string_view text, std::string_view source, u16 id, std::span<const Token> tokens) -> TokenStream {
+            return TokenStream(text, source, id, tokens);
+        }
+
+      private:
+
+        /// Lexes the entire text into the token buffer. A lexer diagnostic ends the buffer early
+        /// and is deferred until the parser actually reaches that point of the stream.
+        void materialize() {
+            try {
+                while (auto token = lex()) {
+                    buffer.push_back(*token);
+                    lexed_count += 1;
+                }
+            } catch (Diagnostic& diagnostic) {
+                pending = std::move(diagnostic);
+            }
+        }
+
+      public:
+        /// A scope guard ensuring that
+        class ProvenanceScope final {
+            friend class TokenStream;
+
+            TokenStream* tokens;
+            i32 exceptions;
+
+            explicit ProvenanceScope(TokenStream* tokens) : tokens(tokens), exceptions(std::uncaught_exceptions()) {}
+
+          public:
+            ProvenanceScope(ProvenanceScope const&) = delete;
+            ProvenanceScope(ProvenanceScope&&) = delete;
+            ProvenanceScope& operator=(ProvenanceScope const&) = delete;
+            ProvenanceScope& operator=(ProvenanceScope&&) = delete;
+
+            ~ProvenanceScope() noexcept(false) {
+                if (tokens and exceptions == std::uncaught_exceptions())
+                    throw std::logic_error("unconsumed provenance stack scope");
+            }
+
+            /// Balances the span answering the resulting provenance at the current point in time.
             [[nodiscard]] auto take() -> Provenance {
                 auto result = tokens->unchecked_span_pop();
                 tokens = nullptr;
@@ -495,17 +1489,20 @@ namespace str {
         /// Consumes a specified count of characters.
         void consume(u32 count = 1) {
             index += count;
-            column += count;
             consumed_count += count;
         }
 
         /// Rewinds a specified count of characters.
         void rewind(u32 count = 1) {
             index -= count;
-            column -= count;
             consumed_count -= count;
         }
 
+        /// Answers true if the lexer has reached the end of the text.
+        auto exhausted() const -> bool {
+            return index >= text.size();
+        }
+
         /// Answers the current character. A bounds check is performed on access.
         auto at() const -> char {
             return text.at(index);
@@ -532,9 +1529,13 @@ namespace str {
         /// Takes character until the sentinel value is matched or the stream ends,
         /// then answers a string view corresponding to the captured character span.
         auto take_until(char sentinel) -> std::string_view {
-            usize count = 0;
-            for (usize i = index; i < text.size() and text[i] != sentinel; i += 1) count += 1;
-            return take(count);
+            return take(scan::find(text, index, sentinel) - index);
+        }
+
+        /// Takes character until either sentinel value is matched or the stream ends,
+        /// then answers a string view corresponding to the captured character span.
+        auto take_until(char sentinel, char other) -> std::string_view {
+            return take(scan::find(text, index, sentinel, other) - index);
         }
 
         /// Takes characters while the predicate answers true for the current character or the stream ends,
@@ -569,32 +1570,19 @@ namespace str {
             return value >= from and value <= to;
         }
 
-        /// Answers true if the current character is valid for identifiers.
-        auto valid_ident() const -> bool {
-            return
-                not in_range(0, 31) and not is(127) and
-                not is(' ') and not is('"') and not is('#') and not is('\'') and
-                not is('(') and not is(')') and not is(',') and not is(':') and
-                not is(';') and not is('@') and not is('[') and not is(']') and
-                not is('{') and not is('}') and not is('`');
-        }
-
         /// Answers true if the current character is valid for number literals.
         auto valid_digit() const -> bool {
-            return in_range('0', '9') or in_range('A', 'Z') or in_range('a', 'z');
+            return scan::is(at(), scan::Digit);
         }
 
         /// Answers true if the current character is valid for symbolic identifiers.
         auto valid_symbolic_ident() const -> bool {
-            return
-                valid_ident() and
-                not in_range('0', '9') and not in_range('A', 'Z') and not in_range('a', 'z') and
-                not is('_');
+            return scan::is(at(), scan::Symbolic);
         }
 
         /// Answers true if the current character is valid for pure identifiers.
         auto valid_pure_ident() const -> bool {
-            return in_range('0', '9') or in_range('A', 'Z') or in_range('a', 'z') or is('_');
+            return scan::is(at(), scan::Pure);
         }
 
         /// Discard processed characters without yielding a token.
@@ -607,7 +1595,7 @@ namespace str {
         ///
         /// This is the primary and only correct way to maintain state while yielding a new token from the stream
         /// safely, tokens shouldn't be created otherwise without reason.
-        template <typename T, typename... Arg> [[nodiscard]] auto yield(Arg... arg) -> Token {
+        template <typename T> [[nodiscard]] auto yield() -> Token {
             bool leading_whitespace = at(index - consumed_count - 1)
                 .transform([] (char c) { return c == ' ' or c == '\n'; })
                 .value_or(true);
@@ -616,30 +1604,41 @@ namespace str {
                 .transform([] (char c) { return c == ' ' or c == '\n' or c == ',' or c == '>' or c == ')' or c == ']'; })
                 .value_or(true);
 
+            u32 symbol = 0;
+            bool dotted = false;
+            u8 precedence = GENERIC_PRECEDENCE;
+
+            if constexpr (std::same_as<T, Token::Identifier> or std::same_as<T, Token::Symbolic>) {
+                auto spelling = text.substr(index - consumed_count, consumed_count);
+
+                // Keywords and operators are resolved by the perfect hash without touching the interner.
+                if (u32 builtin = builtin::find(spelling)) {
+                    symbol = builtin;
+                    precedence = builtin::precedences[builtin];
+                } else {
+                    symbol = interner().intern(spelling);
+                }
+
+                dotted = std::same_as<T, Token::Symbolic> and spelling.contains('.');
+            }
+
             auto token = Token(
-                source,
-                index - 1,
+                Token::kind_of<T>(),
+                id,
+                index - consumed_count,
                 consumed_count,
-                line,
-                column - 1,
-                indentation,
+                symbol,
                 leading_whitespace,
                 trailing_whitespace,
-                Token::Data(T(std::forward<Arg>(arg)...))
+                dotted,
+                precedence
             );
 
             consumed_count = 0;
-            last_token = token;
 
             return token;
         }
 
-        /// Counts a line in the internal provenance tracking state.
-        void end_line() {
-            line += 1;
-            column = 1;
-        }
-
       public:
         /// Provenance for diagnostics in cases where the parser fails to match anything,
         /// pointing at the next token or last token if the stream ended.
@@ -656,7 +1655,7 @@ namespace str {
             if (last_token) {
                 return *last_token;
             } else {
-                return Provenance(source);
+                return Provenance(id);
             }
         }
 
@@ -665,13 +1664,109 @@ namespace str {
             if (last_token) {
                 return *last_token;
             } else {
-                return Provenance(source);
+                return Provenance(id);
             }
         }
 
         /// Generic provenance for the source unit itself, with unspecified location.
         auto generic_provenance() const -> Provenance {
-            return Provenance(source);
+            return Provenance(id);
+        }
+
+        /// Answers the text a token was lexed from.
+        auto text_of(Token token) const -> std::string_view {
+            return text.substr(token.offset, token.length);
+        }
+
+        /// Recovers the payload of a token from the text it was lexed from.
+        auto data(Token token) const -> Token::Data {
+            auto raw = text_of(token);
+
+            switch (token.kind) {
+                case Token::Kind::Error:        return Token::Error();
+                case Token::Kind::NewLine:      return Token::NewLine();
+                case Token::Kind::ParenLeft:    return Token::ParenLeft();
+                case Token::Kind::ParenRight:   return Token::ParenRight();
+                case Token::Kind::BraceLeft:    return Token::BraceLeft();
+                case Token::Kind::BraceRight:   return Token::BraceRight();
+                case Token::Kind::BracketLeft:  return Token::BracketLeft();
+                case Token::Kind::BracketRight: return Token::BracketRight();
+                case Token::Kind::Pipe:         return Token::Pipe();
+                case Token::Kind::Comma:        return Token::Comma();
+                case Token::Kind::Colon:        return Token::Colon();
+                case Token::Kind::DoubleColon:  return Token::DoubleColon();
+                case Token::Kind::SemiColon:    return Token::SemiColon();
+                case Token::Kind::At:           return Token::At();
+                case Token::Kind::Pound:        return Token::Pound();
+                case Token::Kind::Tick:         return Token::Tick();
+                case Token::Kind::Dot:          return Token::Dot();
+                case Token::Kind::Arrow:        return Token::Arrow();
+
+                case Token::Kind::Comment: {
+                    // The selector follows the slashes up to a space, which separates it from the content.
+                    auto body = raw.substr(2);
+                    auto separator = body.find(' ');
+
+                    if (separator == std::string_view::npos) {
+                        return Token::Comment(body, {});
+                    } else {
+                        return Token::Comment(body.substr(0, separator), body.substr(separator + 1));
+                    }
+                }
+                case Token::Kind::Number: {
+                    return Token::Number(raw);
+                }
+                case Token::Kind::String: {
+                    // Either quoted or escaped by a balanced run of backticks.
+                    usize escape_count = 1;
+                    if (raw.front() == '`') escape_count = raw.find_first_not_of('`');
+
+                    return Token::String(raw.substr(escape_count, raw.size() - escape_count * 2));
+                }
+                case Token::Kind::MultilineString: {
+                    return Token::MultilineString(raw.substr(2));
+                }
+                case Token::Kind::Identifier: {
+                    return Token::Identifier(raw, Symbol::from_id(token.symbol));
+                }
+                case Token::Kind::Symbolic: {
+                    return Token::Symbolic(raw, Symbol::from_id(token.symbol));
+                }
+            }
+
+            std::unreachable();
+        }
+
+        /// Recovers the payload of a token of a known kind.
+        template <typename T> auto get(Token token) const -> T {
+            return std::get<T>(data(token));
+        }
+
+        /// Recovers the payload of a token if it is of the specified kind, otherwise `std::nullopt`.
+        template <typename T> auto get_as(Token token) const -> std::optional<T> {
+            if (token.is<T>()) {
+                return get<T>(token);
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        /// For a symbolic or pure identifier it answers the interned symbol, otherwise `std::nullopt`
+        auto identifier_symbol(Token token) const -> std::optional<Symbol> {
+            if (token.is<Token::Identifier>() or token.is<Token::Symbolic>()) {
+                return Symbol::from_id(token.symbol);
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        /// For a symbolic or pure identifier it answers the content, otherwise `std::nullopt`
+        auto identifier_content(Token token) const -> std::optional<std::string_view> {
+            if (token.is<Token::Identifier>() or token.is<Token::Symbolic>()) {
+                return text_of(token);
+            } else {
+                return std::nullopt;
+            }
         }
 
         /// Answers generic provenance for the purpose of throwing in unimplemented branches of the parser.
@@ -681,10 +1776,33 @@ namespace str {
 
         /// Answers true if there are no more tokens left in the stream.
         auto finished() const -> bool {
-            return index >= text.size();
+            return cursor >= buffer.size() and not pending;
+        }
+
+        /// Consumes a brace balanced block starting at the next token without parsing it, answering its tokens.
+        ///
+        /// Answers nothing and consumes nothing if the block does not close before the end of the buffer,
+        /// so the caller can parse it eagerly and fail exactly where it otherwise would have.
+        auto skip_balanced() -> std::optional<std::span<const Token>> {
+            if (cursor >= buffer.size() or not buffer[cursor].is<Token::BraceLeft>()) return std::nullopt;
+
+            u32 depth = 0;
+            for (u32 end = cursor; end < buffer.size(); end += 1) {
+                if (buffer[end].is<Token::BraceLeft>()) {
+                    depth += 1;
+                } else if (buffer[end].is<Token::BraceRight>() and --depth == 0) {
+                    auto block = std::span<const Token>(buffer).subspan(cursor, end + 1 - cursor);
+                    streaming_lexed_count += block.size();
+                    last_token = buffer[end];
+                    cursor = end + 1;
+                    return block;
+                }
+            }
+
+            return std::nullopt;
         }
 
-        /// This is the primary interface of the token stream. While there are still characters left in the stream
+        /// This is the primary interface of the token stream. While there are still tokens left in the stream
         /// it will keep returning them, afterwards it just returns `std::nullopt`.
         ///
         /// The parser shouldn't call this directly, instead there are many helper mathods
@@ -692,22 +1810,35 @@ namespace str {
         /// A syntax highlighter could however use this method to iterate through the tokens for a line of code,
         /// because the Strawberry grammar does not have any multiline tokens.
         ///
+        /// If the lexer failed at this point of the stream its diagnostic is thrown instead.
+        [[nodiscard]] auto next() -> std::optional<Token> {
+            streaming_lexed_count += 1;
+
+            if (cursor < buffer.size()) {
+                last_token = buffer[cursor];
+                cursor += 1;
+                return last_token;
+            }
+
+            if (pending) throw *pending;
+            return std::nullopt;
+        }
+
+      private:
+        /// Lexes the next token from the text. While there are still characters left it will keep
+        /// returning tokens, afterwards it just returns `std::nullopt`.
+        ///
         /// The method also automatically discards non semantic comments and throws diagnostics
         /// for many definite errors, including use of tabs or unterminated tokens.
-        [[nodiscard]] auto next() -> std::optional<Token> { start:
+        [[nodiscard]] auto lex() -> std::optional<Token> { start:
             // Tail recursion is not guaranteed in C++ so we use gotos to do it manually.
-            if (finished()) return std::nullopt;
+            if (exhausted()) return std::nullopt;
 
             if (is(' ')) {
-                while (not finished() and is(' ')) consume();
+                consume(scan::skip_spaces(text, index) - index);
                 no_yield(); goto start;
             } else if (is('\n')) {
-                consume(); end_line();
-
-                indentation = 0; usize i = index;
-                while (i < text.size() and at(i) == ' ') { indentation += 1; i += 1; }
-
-                return yield<Token::NewLine>();
+                consume(); return yield<Token::NewLine>();
             } else if (is('(')) {
                 consume(); return yield<Token::ParenLeft>();
             } else if (is(')')) {
@@ -743,84 +1874,80 @@ namespace str {
             } else if (are("//")) {
                 consume(2);
 
-                auto selector = take_until([] (char c) { return c == ' ' or c == '\n'; });
+                auto selector = take_until(' ', '\n');
 
-                if (not finished() and is(' ')) consume();
+                if (not exhausted() and is(' ')) consume();
 
-                auto content = take_until('\n');
+                take_until('\n');
 
                 // Discard non semantic comments from the stream.
                 if (not selector.empty()) {
-                    return yield<Token::Comment>(selector, content);
+                    return yield<Token::Comment>();
                 } else {
                     no_yield(); goto start;
                 }
             } else if (are("\\\\")) {
                 consume(2);
 
-                auto content = take_until('\n');
+                take_until('\n');
 
-                return yield<Token::MultilineString>(content);
+                return yield<Token::MultilineString>();
             } else if (is('"')) {
                 consume();
 
-                auto content = take_until([] (char c) { return c == '"' or c == '\n'; });
+                take_until('"', '\n');
 
-                if (not finished() and is('"')) {
+                if (not exhausted() and is('"')) {
                     consume();
                 } else {
                     throw Diagnostic::error(yield<Token::Error>(), "unterminated string");
                 }
 
-                return yield<Token::String>(content);
+                return yield<Token::String>();
             } else if (is('`')) {
                 usize escape_count = 0;
 
-                while (not finished() and is('`')) {
+                while (not exhausted() and is('`')) {
                     escape_count += 1;
                     consume();
                 }
 
                 std::string sentinel(escape_count, '`');
 
-                usize count = 0;
-                while (not finished() and not are(sentinel)) {
-                    count += 1;
+                // Only a backtick can start the closing sentinel so the body in between is skipped in bulk.
+                while (true) {
+                    take_until('`');
+                    if (exhausted() or are(sentinel)) break;
                     consume();
                 }
 
-                if (finished()) {
+                if (exhausted()) {
                     throw Diagnostic::error(yield<Token::Error>(), "unterminated string");
                 }
 
-                rewind(count);
-                auto content = take(count);
-
                 consume(escape_count);
 
-                return yield<Token::String>(content);
+                return yield<Token::String>();
             } else if (in_range('0', '9')) {
-                usize count = 0;
                 bool has_decimal = false;
 
               num_loop:
                 consume();
-                count += 1;
 
-                if (finished()) {
+                if (exhausted()) {
                     // pass
                 } else if (valid_digit()) {
                     goto num_loop;
                 } else if (is('_')) {
                     consume();
-                    if (finished() or not valid_digit()) throw Diagnostic::error(yield<Token::Error>(), "invalid underscore");
+                    if (exhausted() or not valid_digit()) throw Diagnostic::error(yield<Token::Error>(), "invalid underscore");
                     rewind();
 
                     goto num_loop;
                 } else if (is('.')) {
                     consume();
 
-                    if (finished()) throw Diagnostic::error(yield<Token::Error>(), "unterminated number");
+                    if (exhausted()) throw Diagnostic::error(yield<Token::Error>(), "unterminated number");
 
                     // If the number does not continue then the dot is an operator or member access.
                     //
@@ -836,59 +1963,33 @@ namespace str {
                     }
                 }
 
-                rewind(count);
-                auto content = take(count);
-
-                return yield<Token::Number>(content);
+                return yield<Token::Number>();
             } else if (valid_symbolic_ident()) {
-                usize count = 0;
-
                 do {
-                    count += 1;
                     consume();
-                } while (not finished() and valid_symbolic_ident() and not is('>'));
+                } while (not exhausted() and valid_symbolic_ident() and not is('>'));
 
-                rewind(count);
-                auto content = take(count);
-
-                return yield<Token::Symbolic>(content);
+                return yield<Token::Symbolic>();
             } else if (valid_pure_ident()) {
-                usize count = 0;
-
-                do {
-                    count += 1;
-                    consume();
-                } while (not finished() and valid_pure_ident());
-
-                rewind(count);
-                auto content = take(count);
+                consume(scan::skip_pure(text, index) - index);
 
-                return yield<Token::Identifier>(content);
+                return yield<Token::Identifier>();
             } else {
                 throw Diagnostic::error(yield<Token::Error>(), std::format("unexpected character: {}", at()));
             }
         }
 
+      public:
         /// Peek for a future token non destructively.
         auto peek(u32 offset = 1) -> std::optional<Token> {
-            auto index = this->index;
-            auto line = this->line;
-            auto column = this->column;
-            auto consumed_count = this->consumed_count;
-            auto last_token = this->last_token;
-
-            ScopeExit _ = [&] {
-                this->index = index;
-                this->line = line;
-                this->column = column;
-                this->consumed_count = consumed_count;
-                this->last_token = last_token;
-            };
+            streaming_lexed_count += offset;
+            peek_count += 1;
 
-            std::optional<Token> result;
-            for (u32 i = 0; i < offset; i += 1) result = next();
+            usize position = usize(cursor) + offset - 1;
+            if (position < buffer.size()) return buffer[position];
 
-            return result;
+            if (pending) throw *pending;
+            return std::nullopt;
         }
 
         /// Drop a count of tokens.
@@ -909,7 +2010,7 @@ namespace str {
         template <typename T> auto match() -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data)) {
+            if (token and token->is<T>()) {
                 last_token = next();
                 return last_token;
             } else {
@@ -921,7 +2022,7 @@ namespace str {
         template <typename T> auto match(std::string_view content) -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data) and token->identifier_content() == content) {
+            if (token and token->is<T>() and identifier_content(*token) == content) {
                 last_token = next();
                 return last_token;
             } else {
@@ -938,8 +2039,8 @@ namespace str {
 
             if (
                 token and
-                std::holds_alternative<T>(token->data) and
-                std::invoke(predicate, std::as_const(std::get<T>(token->data)))
+                token->is<T>() and
+                std::invoke(predicate, std::as_const(get<T>(*token)))
             ) {
                 last_token = next();
                 return last_token;
@@ -951,25 +2052,25 @@ namespace str {
         /// Match a token of specified type.
         /// Unwraps the result to the specified token type.
         template <typename T> auto match_as() -> std::optional<T> {
-            return match<T>().transform(&Token::get<T>);
+            return match<T>().transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Match an identifier token of specified type with an exact content pattern.
         /// Unwraps the result to the specified token type.
         template <typename T> auto match_as(std::string_view content) -> std::optional<T> {
-            return match<T>(content).transform(&Token::get<T>);
+            return match<T>(content).transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Match a token with an additional predicate.
         /// Unwraps the result to the specified token type.
         template <typename T, typename F> auto match_as(F&& predicate) -> std::optional<T> {
-            return match<T>(std::forward<F>(predicate)).transform(&Token::get<T>);
+            return match<T>(std::forward<F>(predicate)).transform([this] (Token token) { return get<T>(token); });
         }
 
         template <typename T> auto allow() -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data)) {
+            if (token and token->is<T>()) {
                 return next();
             } else {
                 return std::nullopt;
@@ -981,7 +2082,7 @@ namespace str {
         template <typename T> auto allow(std::string_view content) -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data) and token->identifier_content() == content) {
+            if (token and token->is<T>() and identifier_content(*token) == content) {
                 return next();
             } else {
                 return std::nullopt;
@@ -998,8 +2099,8 @@ namespace str {
 
             if (
                 token and
-                std::holds_alternative<T>(token->data) and
-                std::invoke(predicate, std::as_const(std::get<T>(token->data)))
+                token->is<T>() and
+                std::invoke(predicate, std::as_const(get<T>(*token)))
             ) {
                 return next();
             } else {
@@ -1010,19 +2111,19 @@ namespace str {
         /// Like matching but does not contribute to the tail of a provenance span.
         /// Used mainly to prevent trailing newlines from being tracked by diagnostics.
         template <typename T> auto allow_as(std::string_view content) -> std::optional<T> {
-            return allow<T>(content).transform(&Token::get<T>);
+            return allow<T>(content).transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like matching but does not contribute to the tail of a provenance span.
         /// Used mainly to prevent trailing newlines from being tracked by diagnostics.
         template <typename T> auto allow_as() -> std::optional<T> {
-            return allow<T>().transform(&Token::get<T>);
+            return allow<T>().transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like matching but does not contribute to the tail of a provenance span.
         /// Used mainly to prevent trailing newlines from being tracked by diagnostics.
         template <typename T, typename F> auto allow_as(F&& predicate) -> std::optional<T> {
-            return allow<T>(std::forward<F>(predicate)).transform(&Token::get<T>);
+            return allow<T>(std::forward<F>(predicate)).transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like matching but unwraps the token and throws a diagnostic otherwise.
@@ -1035,7 +2136,7 @@ namespace str {
                 std::optional<Token> failure = peek();
                 if (failure) {
                     throw Diagnostic::error(*failure,
-                        std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                        std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                     );
                 } else {
                     throw Diagnostic::error(failure_provenance(), "unexpected end of stream");
@@ -1052,16 +2153,16 @@ namespace str {
             } else {
                 std::optional<Token> failure = peek();
                 if (failure) {
-                    if (std::holds_alternative<T>(failure->data)) {
+                    if (failure->is<T>()) {
                         throw Diagnostic::error(*failure,
                             std::format(
                                 "expected content: {}, found: {}",
-                                content, failure->identifier_content().value_or("std::nullopt")
+                                content, identifier_content(*failure).value_or("std::nullopt")
                             )
                         );
                     } else {
                         throw Diagnostic::error(*failure,
-                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                         );
                     }
                 } else {
@@ -1079,11 +2180,11 @@ namespace str {
             } else {
                 std::optional<Token> failure = peek();
                 if (failure) {
-                    if (std::holds_alternative<T>(failure->data)) {
+                    if (failure->is<T>()) {
                         throw Diagnostic::error(*failure, "expected predicate failed");
                     } else {
                         throw Diagnostic::error(*failure,
-                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                         );
                     }
                 } else {
@@ -1111,7 +2212,7 @@ namespace str {
         template <typename T> auto peek_match() -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data)) {
+            if (token and token->is<T>()) {
                 return token;
             } else {
                 return std::nullopt;
@@ -1122,7 +2223,7 @@ namespace str {
         template <typename T> auto peek_match(std::string_view content) -> std::optional<Token> {
             std::optional token = peek();
 
-            if (token and std::holds_alternative<T>(token->data) and token->identifier_content() == content) {
+            if (token and token->is<T>() and identifier_content(*token) == content) {
                 return token;
             } else {
                 return std::nullopt;
@@ -1138,8 +2239,8 @@ namespace str {
 
             if (
                 token and
-                std::holds_alternative<T>(token->data) and
-                std::invoke(predicate, std::as_const(std::get<T>(token->data)))
+                token->is<T>() and
+                std::invoke(predicate, std::as_const(get<T>(*token)))
             ) {
                 return token;
             } else {
@@ -1149,17 +2250,17 @@ namespace str {
 
         /// Like matching but does not consume the token.
         template <typename T> auto peek_match_as() -> std::optional<T> {
-            return peek_match<T>().transform(&Token::get<T>);
+            return peek_match<T>().transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like matching but does not consume the token.
         template <typename T> auto peek_match_as(std::string_view content) -> std::optional<T> {
-            return peek_match<T>(content).transform(&Token::get<T>);
+            return peek_match<T>(content).transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like matching but does not consume the token.
         template <typename T, typename F> auto peek_match_as(F&& predicate) -> std::optional<T> {
-            return peek_match<T>(std::forward<F>(predicate)).transform(&Token::get<T>);
+            return peek_match<T>(std::forward<F>(predicate)).transform([this] (Token token) { return get<T>(token); });
         }
 
         /// Like expecting but does not consume the token.
@@ -1172,7 +2273,7 @@ namespace str {
                 std::optional<Token> failure = peek();
                 if (failure) {
                     throw Diagnostic::error(*failure,
-                        std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                        std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                     );
                 } else {
                     throw Diagnostic::error(failure_provenance(), "unexpected end of stream");
@@ -1189,16 +2290,16 @@ namespace str {
             } else {
                 std::optional<Token> failure = peek();
                 if (failure) {
-                    if (std::holds_alternative<T>(failure->data)) {
+                    if (failure->is<T>()) {
                         throw Diagnostic::error(*failure,
                             std::format(
                                 "expected content: {}, found: {}",
-                                content, failure->identifier_content().value_or("std::nullopt")
+                                content, identifier_content(*failure).value_or("std::nullopt")
                             )
                         );
                     } else {
                         throw Diagnostic::error(*failure,
-                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                         );
                     }
                 } else {
@@ -1216,11 +2317,11 @@ namespace str {
             } else {
                 std::optional<Token> failure = peek();
                 if (failure) {
-                    if (std::holds_alternative<T>(failure->data)) {
+                    if (failure->is<T>()) {
                         throw Diagnostic::error(*failure, "expected predicate failed");
                     } else {
                         throw Diagnostic::error(*failure,
-                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), *failure)
+                            std::format("expected: {}, found: {}", std::meta::identifier_of(^^T), data(*failure))
                         );
                     }
                 } else {
@@ -1235,50 +2336,22 @@ namespace str {
         }
 
         /// Like expecting but does not consume the token.
-        template <typename T> auto peek_expect_as(std::string_view content) -> T {
-            return peek_expect<T>(content).template get<T>();
-        }
-
-        /// Like expecting but does not consume the token.
-        template <typename T, typename F> auto peek_expect_as(F&& predicate) -> T {
-            return peek_expect<T>(std::forward<F>(predicate)).template get<T>();
-        }
-    };
-
-    constexpr auto tokenize(std::string_view text, std::string_view source) -> TokenStream {
-        return TokenStream(text, source);
-    }
-}
-
-namespace str {
-    constexpr usize GENERIC_PRECEDENCE = 7;
-    constexpr usize STRICT_PRECEDENCE = 1000;
-
-    constexpr auto precedence(std::string_view pattern) -> usize {
-        if (pattern == "=")   return 0; // Assignment. Not needed here? It is a right associative postfix expression.
-
-        if (pattern == "or")  return 1; // Logical or.
-        if (pattern == "and") return 2; // Logical and.
-
-        if (pattern == "==")  return 3; // Equal to.
-        if (pattern == "!=")  return 3; // Not equal to.
-
-        if (pattern == "<")   return 4; // Less than.
-        if (pattern == "<=")  return 4; // Less than or equal to.
-        if (pattern == ">")   return 4; // Greater than.
-        if (pattern == ">=")  return 4; // Greater than or equal to.
-
-        if (pattern == "+")   return 5; // Addition operator.
-        if (pattern == "-")   return 5; // Subtraction operator.
+        template <typename T> auto peek_expect_as(std::string_view content) -> T {
+            return peek_expect<T>(content).template get<T>();
+        }
 
-        if (pattern == "*")   return 6; // Multiplication operator.
-        if (pattern == "/")   return 6; // True division operator.
-        if (pattern == "\\")  return 6; // Pseudo division operator.
-        if (pattern == "%")   return 6; // Remainder operator.
+        /// Like expecting but does not consume the token.
+        template <typename T, typename F> auto peek_expect_as(F&& predicate) -> T {
+            return peek_expect<T>(std::forward<F>(predicate)).template get<T>();
+        }
+    };
 
-        return 7;
+    inline auto tokenize(SourceUnit const& source_unit) -> TokenStream {
+        return TokenStream(source_unit);
     }
+}
 
+namespace str {
     /// Determines the role of an operator in an expression.
     enum class OperatorRole {
         Infix,
@@ -1287,8 +2360,13 @@ namespace str {
     };
 
     /// Answers the role of an operator based on associated whitespace.
+    ///
+    /// Everything it depends on is recorded on the token by the lexer, so it never looks at the text.
     inline auto operator_role(Token token) -> OperatorRole {
-        return std::visit(overloaded {
+        bool lead = token.leading_whitespace;
+        bool trail = token.trailing_whitespace;
+
+        switch (token.kind) {
             // Symbolic operators are determined to be infix, prefix or postfix based on their whitespace.
             // If they are adjacent to the token on the right they are a prefix operator,
             // if they are adjacent to the token on the left they are a postfix operator,
@@ -1297,107 +2375,273 @@ namespace str {
             // The language intentionally specifies away the ability to have no whitespace on most operators,
             // except for operators that contain dots, such as range or concatenation operators which are
             // ideally written without whitespace on either side.
-            [token] (Token::Symbolic symbolic) -> OperatorRole {
-                bool lead = token.leading_whitespace;
-                bool trail = token.trailing_whitespace;
-
-                if (lead and trail)                 return OperatorRole::Infix;
-                if (lead and not trail)             return OperatorRole::Prefix;
-                if (trail and not lead)             return OperatorRole::Postfix;
-                if (symbolic.content.contains('.')) return OperatorRole::Infix;
+            case Token::Kind::Symbolic: {
+                if (lead and trail)     return OperatorRole::Infix;
+                if (lead and not trail) return OperatorRole::Prefix;
+                if (trail and not lead) return OperatorRole::Postfix;
+                if (token.dotted)       return OperatorRole::Infix;
 
                 throw Diagnostic::error(token, "infix operators without whitespace are only allowed for dot operators");
-            },
+            }
             // We don't actually try resolve non infix pure identifier operators here,
             // the other roles are a fallback for prefix and postfix parsing instead.
-            [token] (Token::Identifier identifier) -> OperatorRole {
-                bool lead = token.leading_whitespace;
-                bool trail = token.trailing_whitespace;
-
+            case Token::Kind::Identifier: {
                 if (lead and trail) return OperatorRole::Infix;
 
                 throw Diagnostic::error(token, "infix operators without whitespace are only allowed for dot operators");
-            },
+            }
             // Arbitrary tokens can't be used as operators, this should never happen.
-            [] (auto other) -> OperatorRole {
+            default: {
                 throw std::logic_error("attempt to query operator role of non identifier token");
             }
-        }, token.data);
+        }
+    }
+
+    /// A bump allocator that hands out memory from large chunks and releases all of it at once.
+    ///
+    /// Syntax trees are built once and torn down as a whole, so there is no point in tracking
+    /// their nodes individually. Nothing allocated from an arena is ever destroyed by it.
+    class Arena final {
+        struct Chunk final {
+            Chunk* previous;
+        };
+
+        static constexpr usize chunk_size = 64 * 1024;
+
+        Chunk* chunks = nullptr;
+        char* cursor = nullptr;
+        char* limit = nullptr;
+
+        usize allocations = 0;
+        usize chunk_count = 0;
+        usize bytes = 0;
+
+        std::mutex mutex;
+
+        void grow(usize size, usize alignment) {
+            usize capacity = std::max(chunk_size, sizeof(Chunk) + size + alignment);
+            auto chunk = static_cast<Chunk*>(::operator new(capacity));
+
+            chunk->previous = chunks;
+            chunks = chunk;
+            cursor = reinterpret_cast<char*>(chunk + 1);
+            limit = reinterpret_cast<char*>(chunk) + capacity;
+            chunk_count += 1;
+        }
+
+      public:
+        Arena() = default;
+        Arena(Arena const&) = delete;
+        auto operator = (Arena const&) -> Arena& = delete;
+
+        ~Arena() {
+            while (chunks) {
+                Chunk* previous = chunks->previous;
+                ::operator delete(chunks);
+                chunks = previous;
+            }
+        }
+
+        auto allocate(usize size, usize alignment) -> void* {
+            auto align = [&] {
+                auto address = reinterpret_cast<usize>(cursor);
+                return cursor + ((alignment - address % alignment) % alignment);
+            };
+
+            if (cursor == nullptr or static_cast<usize>(limit - cursor) < size + alignment) grow(size, alignment);
+
+            char* pointer = align();
+            cursor = pointer + size;
+
+            allocations += 1;
+            bytes += size;
+
+            return pointer;
+        }
+
+        /// The number of allocations served, each of which would otherwise have been a separate trip to the heap.
+        auto get_allocations() const -> usize { return allocations; }
+        /// The number of chunks actually requested from the heap.
+        auto get_chunks() const -> usize { return chunk_count; }
+        /// The number of bytes handed out, excluding alignment padding.
+        auto get_bytes() const -> usize { return bytes; }
+
+        /// Arenas are not thread safe. Anything allocating into a tree after it was built,
+        /// possibly from several threads at once, has to hold this.
+        auto get_mutex() -> std::mutex& { return mutex; }
+    };
+
+    /// The arena the current thread allocates syntax tree storage from, if any.
+    inline thread_local Arena* current_arena = nullptr;
+
+    /// Directs syntax tree allocations of the current thread to an arena for the lifetime of the scope.
+    class ArenaScope final {
+        Arena* previous;
+
+      public:
+        explicit ArenaScope(Arena& arena) : previous(current_arena) { current_arena = &arena; }
+        ~ArenaScope() { current_arena = previous; }
+
+        ArenaScope(ArenaScope const&) = delete;
+        auto operator = (ArenaScope const&) -> ArenaScope& = delete;
+    };
+
+    /// An allocator for syntax tree storage.
+    ///
+    /// It binds to the arena of the current thread when it is created, and falls back to the heap
+    /// when there is none, so trees built outside of parsing manage their memory as usual.
+    /// Moving a container moves its arena along, copying one binds the copy anew.
+    /// Not final, as standard containers may derive from their allocator.
+    template <typename T> class ArenaAllocator {
+      public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::false_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+        using is_always_equal = std::false_type;
+
+        Arena* arena = current_arena;
+
+        ArenaAllocator() noexcept = default;
+        template <typename U> ArenaAllocator(ArenaAllocator<U> const& other) noexcept : arena(other.arena) {}
+
+        auto allocate(usize count) -> T* {
+            if (arena) return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T)));
+            return std::allocator<T>().allocate(count);
+        }
+
+        void deallocate(T* pointer, usize count) noexcept {
+            if (not arena) std::allocator<T>().deallocate(pointer, count);
+        }
+
+        auto select_on_container_copy_construction() const -> ArenaAllocator {
+            return ArenaAllocator();
+        }
+
+        template <typename U> auto operator == (ArenaAllocator<U> const& other) const -> bool {
+            return arena == other.arena;
+        }
+    };
+
+    template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+    using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+    /// Destroys a boxed node, leaving its memory to the arena if it came from one.
+    template <typename T> struct ArenaDelete final {
+        bool in_arena = false;
+
+        void operator()(T* pointer) const {
+            if (in_arena) {
+                pointer->~T();
+            } else {
+                delete pointer;
+            }
+        }
+    };
+
+    /// An owning pointer to a syntax tree node.
+    template <typename T> using Box = std::unique_ptr<T, ArenaDelete<T>>;
+
+    /// Allocates a node from the arena of the current thread, or from the heap when there is none.
+    template <typename T, typename... Arg> auto make_box(Arg&&... arg) -> Box<T> {
+        if (Arena* arena = current_arena) {
+            void* memory = arena->allocate(sizeof(T), alignof(T));
+            return Box<T>(new (memory) T(std::forward<Arg>(arg)...), ArenaDelete<T> { true });
+        }
+
+        return Box<T>(new T(std::forward<Arg>(arg)...), ArenaDelete<T> { false });
     }
 
     /// A checked qualified path.
+    ///
+    /// Components are interned, so comparing paths compares integers rather than text.
+    /// They are kept on the heap even while parsing, since paths outlive trees as module keys and imports.
     class Path final {
-        std::string data;
+        std::vector<Symbol> components;
 
-        void validate() {
-            if (data.empty()) throw std::logic_error("empty path");
-            if (data.front() == '.') throw std::logic_error("leading dot in path");
-            if (data.back() == '.') throw std::logic_error("trailing dot in path");
+        void validate() const {
+            if (components.empty()) throw std::logic_error("empty path");
 
-            for (usize i = 0; i < data.size(); i += 1) {
-                if (data[i] == '.' and data[i - 1] == '.') throw std::logic_error("empty subpath in path");
+            for (auto component : components) {
+                if (component == Symbol()) throw std::logic_error("empty subpath in path");
             }
         }
 
       public:
-        Path(std::string value) : data(value) { validate(); }
-        Path(std::string_view value) : data(value) { validate(); }
+        Path(std::string_view value) {
+            if (value.starts_with('.')) throw std::logic_error("leading dot in path");
+            if (value.ends_with('.')) throw std::logic_error("trailing dot in path");
+
+            for (auto component : value | std::views::split('.')) {
+                components.emplace_back(std::string_view(component));
+            }
+
+            validate();
+        }
+
+        Path(std::string const& value) : Path(std::string_view(value)) {}
+        Path(Symbol component) : components { component } { validate(); }
+
+        operator std::string() const {
+            std::string data;
+
+            for (auto component : components) {
+                if (not data.empty()) data += ".";
+                data += component.spelling();
+            }
 
-        operator std::string() const { return data; }
+            return data;
+        }
 
         auto operator == (Path const& other) const -> bool = default;
         auto operator != (Path const& other) const -> bool = default;
 
         auto operator + (Path const& other) const -> Path {
-            return data + "." + other.data;
+            Path result = *this;
+            result += other;
+            return result;
         }
 
         void operator += (Path const& other) {
-            data += ".";
-            data += other.data;
+            components.append_range(other.components);
         }
 
-        auto split() { return data | std::views::split('.'); }
+        auto split() const -> std::span<const Symbol> { return components; }
 
         static auto join(auto&& range) -> Path {
             std::string data;
 
-            usize i = 0; // Still no enumerate...
             for (auto& component : range) {
-                if (not (i == 0 or i == range.size() - 1)) data += ".";
+                if (not data.empty()) data += ".";
                 data += std::move(component);
-                i += 1;
             }
 
             return data;
         }
 
         auto prefix() const -> std::optional<Path> {
-            auto result = data.find_last_of('.');
-
-            if (result == std::string::npos) {
+            if (components.size() == 1) {
                 return std::nullopt;
             } else {
-                return data.substr(0, result);
+                Path result = *this;
+                result.components.pop_back();
+                return result;
             }
         }
 
         auto nested_in(Path const& other) const -> bool {
-            using Ref = std::reference_wrapper<const Path>;
-            using PathRef = std::optional<Ref>;
-
-            static constexpr auto nested_in_recurse = [] (this auto recurse, PathRef self, PathRef other) -> bool {
-                if (not self) return false;
-                if (self == other) return true;
-                return recurse(
-                    self->get()
-                        .prefix()
-                        .transform([] (auto p) { return Ref(p); }),
-                    other
-                );
-            };
+            return
+                other.components.size() <= components.size() and
+                std::ranges::equal(other.components, components | std::views::take(other.components.size()));
+        }
+    };
 
-            return nested_in_recurse(*this, other);
+    /// Paths hash as their components, consistent with their equality.
+    struct PathHash final {
+        auto operator()(Path const& path) const noexcept -> usize {
+            usize hash = 0;
+            for (auto component : path.split()) hash = hash * 31 + component.get_id();
+            return hash;
         }
     };
 
@@ -1405,14 +2649,14 @@ namespace str {
     /// Everything outside the rigid declaration grammar is an expression in this language.
     class Expr final {
       public:
-        using ExprBox = std::unique_ptr<Expr>;
+        using ExprBox = Box<Expr>;
 
         static ExprBox box(Expr& expr) {
-            return std::make_unique<Expr>(std::move(expr));
+            return make_box<Expr>(std::move(expr));
         }
 
         static ExprBox box(Expr&& expr) {
-            return std::make_unique<Expr>(std::move(expr));
+            return make_box<Expr>(std::move(expr));
         }
 
         static ExprBox box(ExprBox& expr) {
@@ -1423,6 +2667,10 @@ namespace str {
             return std::move(expr);
         }
 
+        static std::optional<ExprBox> box(std::optional<ExprBox>& expr) {
+            return std::move(expr);
+        }
+
         struct Infix final {
             std::string_view name;
             ExprBox lhs;
@@ -1482,8 +2730,8 @@ namespace str {
         };
 
         struct String final {
-            std::string content;
-            explicit String(std::string content) : content(content) {}
+            ArenaString content;
+            explicit String(ArenaString content) : content(std::move(content)) {}
         };
 
         struct Boolean final {
@@ -1506,9 +2754,9 @@ namespace str {
         struct Intrinsic final {
             std::optional<std::string_view> backend;
             std::string_view name;
-            std::vector<ExprBox> expressions;
+            ArenaVector<ExprBox> expressions;
 
-            Intrinsic(std::optional<std::string_view> backend, std::string_view name, std::vector<ExprBox> expressions)
+            Intrinsic(std::optional<std::string_view> backend, std::string_view name, ArenaVector<ExprBox> expressions)
                 : backend(backend), name(name), expressions(std::move(expressions)) {}
         };
 
@@ -1518,11 +2766,11 @@ namespace str {
                 ExprBox expr;
             };
 
-            std::vector<Element> elements;
+            ArenaVector<Element> elements;
 
             Tuple() {}
 
-            explicit Tuple(std::vector<Element> elements) : elements(std::move(elements)) {}
+            explicit Tuple(ArenaVector<Element> elements) : elements(std::move(elements)) {}
         };
 
         struct Callable final {
@@ -1568,17 +2816,17 @@ namespace str {
                 ExprBox type_expr;
             };
 
-            std::vector<Argument> args;
-            std::optional<std::vector<Capture>> captures;
+            ArenaVector<Argument> args;
+            std::optional<ArenaVector<Capture>> captures;
             bool async;
-            std::optional<std::vector<ExprBox>> throws;
+            std::optional<ArenaVector<ExprBox>> throws;
             ExprBox return_type;
 
             Callable(
-                std::vector<Argument> args,
-                std::optional<std::vector<Capture>> captures,
+                ArenaVector<Argument> args,
+                std::optional<ArenaVector<Capture>> captures,
                 bool async,
-                std::optional<std::vector<ExprBox>> throws,
+                std::optional<ArenaVector<ExprBox>> throws,
                 auto return_type
             ) : args(std::move(args))
               , captures(std::move(captures))
@@ -1632,10 +2880,10 @@ namespace str {
                 Annotation(auto annotation, bool unsafe) : annotation(box(annotation)), unsafe(unsafe) {}
             };
 
-            std::vector<Annotation> annotations;
+            ArenaVector<Annotation> annotations;
             ExprBox expr;
 
-            Annotations(std::vector<Annotation> annotations, auto expr)
+            Annotations(ArenaVector<Annotation> annotations, auto expr)
                 : annotations(std::move(annotations)), expr(box(expr)) {}
         };
 
@@ -1710,9 +2958,9 @@ namespace str {
             };
 
             ExprBox callee;
-            std::vector<Argument> arguments;
+            ArenaVector<Argument> arguments;
 
-            Call(auto callee, std::vector<Argument> arguments)
+            Call(auto callee, ArenaVector<Argument> arguments)
                 : callee(box(callee)), arguments(std::move(arguments)) {}
         };
 
@@ -1726,9 +2974,9 @@ namespace str {
             };
 
             ExprBox callee;
-            std::vector<Argument> arguments;
+            ArenaVector<Argument> arguments;
 
-            Subscript(auto callee, std::vector<Argument> arguments)
+            Subscript(auto callee, ArenaVector<Argument> arguments)
                 : callee(box(callee)), arguments(std::move(arguments)) {}
         };
 
@@ -1736,8 +2984,8 @@ namespace str {
         ///
         /// Contains any number of expressions separated by newlines or semicolons.
         struct Block final {
-            std::vector<ExprBox> expressions;
-            explicit Block(std::vector<ExprBox> expressions) : expressions(std::move(expressions)) {}
+            ArenaVector<ExprBox> expressions;
+            explicit Block(ArenaVector<ExprBox> expressions) : expressions(std::move(expressions)) {}
         };
 
         /// An explicit specialization invocation `<>`.
@@ -1748,22 +2996,22 @@ namespace str {
             };
 
             ExprBox callee;
-            std::vector<Parameter> parameters;
+            ArenaVector<Parameter> parameters;
 
-            Generics(auto callee, std::vector<Parameter> parameters)
+            Generics(auto callee, ArenaVector<Parameter> parameters)
                 : callee(box(callee)), parameters(std::move(parameters)) {}
         };
 
         /// A literal list expression `[1, 2, 3]`.
         struct List final {
-            std::vector<ExprBox> expressions;
-            explicit List(std::vector<ExprBox> expressions) : expressions(std::move(expressions)) {}
+            ArenaVector<ExprBox> expressions;
+            explicit List(ArenaVector<ExprBox> expressions) : expressions(std::move(expressions)) {}
         };
 
         /// A pure identifier expression.
         struct Identifier final {
-            std::string_view name;
-            explicit Identifier(std::string_view name) : name(name) {}
+            Symbol name;
+            explicit Identifier(Symbol name) : name(name) {}
         };
 
         /// An unsafe expression.
@@ -1808,27 +3056,27 @@ namespace str {
         /// A member projection expression `.`.
         /// `<expr>.name`
         struct Member final {
-            std::string_view name;
+            Symbol name;
             ExprBox expr;
 
-            Member(std::string_view name, auto expr) : name(name), expr(box(expr)) {}
+            Member(Symbol name, auto expr) : name(name), expr(box(expr)) {}
         };
 
         /// A member container projection expression `->`.
         /// `<expr>.name`
         struct MemberDeref final {
-            std::string_view name;
+            Symbol name;
             ExprBox expr;
 
-            MemberDeref(std::string_view name, auto expr) : name(name), expr(box(expr)) {}
+            MemberDeref(Symbol name, auto expr) : name(name), expr(box(expr)) {}
         };
 
         /// A reflective meta member projection expression `::`.
         struct MetaMember final {
-            std::string_view name;
+            Symbol name;
             ExprBox expr;
 
-            MetaMember(std::string_view name, auto expr) : name(name), expr(box(expr)) {}
+            MetaMember(Symbol name, auto expr) : name(name), expr(box(expr)) {}
         };
 
         /// A ternary conditional expression.
@@ -1891,8 +3139,8 @@ namespace str {
         };
 
         struct MemberInfer final {
-            std::string_view name;
-            explicit MemberInfer(std::string_view name) : name(name) {}
+            Symbol name;
+            explicit MemberInfer(Symbol name) : name(name) {}
         };
 
         struct Label final {
@@ -1914,7 +3162,7 @@ namespace str {
             std::optional<std::string_view> label;
 
             Continue() {}
-            explicit Continue(std::string_view label) : label(label) {}
+            explicit Continue(std::optional<std::string_view> label) : label(label) {}
         };
 
         struct Loop final {
@@ -1929,9 +3177,9 @@ namespace str {
             };
 
             ExprBox lhs;
-            std::vector<Arm> arms;
+            ArenaVector<Arm> arms;
 
-            Match(auto lhs, std::vector<Arm> arms) : lhs(box(lhs)), arms(std::move(arms)) {}
+            Match(auto lhs, ArenaVector<Arm> arms) : lhs(box(lhs)), arms(std::move(arms)) {}
         };
 
         struct Catch final {
@@ -1943,9 +3191,9 @@ namespace str {
             };
 
             ExprBox lhs;
-            std::vector<Arm> arms;
+            ArenaVector<Arm> arms;
 
-            Catch(auto lhs, std::vector<Arm> arms) : lhs(box(lhs)), arms(std::move(arms)) {}
+            Catch(auto lhs, ArenaVector<Arm> arms) : lhs(box(lhs)), arms(std::move(arms)) {}
         };
 
         struct Closure final {
@@ -1977,17 +3225,17 @@ namespace str {
                     : mut(mut), ref(ref), name(name) {}
             };
 
-            std::vector<Argument> arguments;
-            std::optional<std::vector<Capture>> captures;
-            std::optional<std::vector<ExprBox>> throws;
+            ArenaVector<Argument> arguments;
+            std::optional<ArenaVector<Capture>> captures;
+            std::optional<ArenaVector<ExprBox>> throws;
             std::optional<ExprBox> return_type;
             bool async = false;
             ExprBox body;
 
             Closure(
-                std::vector<Argument> arguments,
-                std::optional<std::vector<Capture>> captures,
-                std::optional<std::vector<ExprBox>> throws,
+                ArenaVector<Argument> arguments,
+                std::optional<ArenaVector<Capture>> captures,
+                std::optional<ArenaVector<ExprBox>> throws,
                 std::optional<ExprBox> return_type,
                 bool async,
                 auto body
@@ -2018,15 +3266,16 @@ namespace str {
             };
 
             struct Tuple final {
-                std::vector<Destructuring> elements;
+                ArenaVector<Destructuring> elements;
             };
 
             using Data = std::variant<Binding, Tuple>;
 
-            std::unique_ptr<Data> data;
+            Box<Data> data;
 
-            explicit Destructuring(Binding binding) : data(std::make_unique<Data>(std::move(binding))) {}
-            explicit Destructuring(Tuple tuple) : data(std::make_unique<Data>(std::move(tuple))) {}
+            explicit Destructuring(Binding binding) : data(make_box<Data>(std::move(binding))) {}
+            explicit Destructuring(Tuple tuple) : data(make_box<Data>(std::move(tuple))) {}
+            explicit Destructuring(Box<Data> data) : data(std::move(data)) {}
 
             template <typename T> auto get() -> T& {
                 return std::get<T>(data);
@@ -2124,11 +3373,11 @@ namespace str {
         struct Pattern final {
             struct Enum final {
                 std::string_view name;
-                std::vector<ExprBox> elements;
+                ArenaVector<ExprBox> elements;
             };
 
             struct Tuple final {
-                std::vector<ExprBox> elements;
+                ArenaVector<ExprBox> elements;
             };
 
             struct Value final {
@@ -2260,10 +3509,68 @@ namespace str {
 
     class Decl final {
       public:
+        /// The block body of a function or initializer, either parsed along with its declaration
+        /// or deferred until it is first asked for.
+        ///
+        /// A deferred body keeps the brace balanced tokens it spans and parses them into the arena of its tree
+        /// on first use, throwing the same diagnostics an eager parse would have, only later.
+        /// The source unit it was lexed from must outlive it.
+        class Body final {
+          public:
+            struct Deferred final {
+                std::string_view text;
+                std::string_view source;
+                u16 id;
+                ArenaVector<Token> tokens;
+                Arena* arena;
+                std::atomic<Expr*> expr = nullptr;
+
+                Deferred(std::string_view text, std::string_view source, u16 id, std::span<const Token> tokens, Arena* arena)
+                    : text(text), source(source), id(id), tokens(tokens.begin(), tokens.end()), arena(arena) {}
+            };
+
+          private:
+            std::variant<Expr, Box<Deferred>> data;
+
+          public:
+            Body(Expr expr) : data(std::move(expr)) {}
+            explicit Body(Box<Deferred> deferred) : data(std::move(deferred)) {}
+
+            /// Answers true if the body has been parsed already.
+            auto parsed() const -> bool {
+                if (auto deferred = std::get_if<Box<Deferred>>(&data)) {
+                    return (*deferred)->expr.load(std::memory_order_acquire) != nullptr;
+                } else {
+                    return true;
+                }
+            }
+
+            /// Answers the deferred tokens of the body, or nothing if it was parsed along with its declaration.
+            auto get_deferred() const -> Deferred const* {
+                if (auto deferred = std::get_if<Box<Deferred>>(&data)) {
+                    return deferred->get();
+                } else {
+                    return nullptr;
+                }
+            }
+
+            /// Answers the provenance of the body without parsing it.
+                if (auto deferred = std::get_if<Box<Deferred>>(&data)) {
+                    return Provenance((*deferred)->tokens.front(), (*deferred)->tokens.back());
+                } else {
+                    return std::get<Expr>(data).provenance;
+                }
+            }
+
+            /// Answers the body, parsing it first if it was deferred.
+            /// Safe to call from several threads, and throws the diagnostics of the body every time it fails.
+            auto get() const -> Expr const&;
+        };
+
         struct GenericParameter final {
             enum class Kind { Value, Type, Category, Lifetime } kind;
             std::optional<std::string_view> label;
-            std::string_view name;
+            Symbol name;
             std::optional<Expr> type_expr;
             std::optional<Expr> default_expr;
         };
@@ -2291,7 +3598,7 @@ namespace str {
             /// The argument label.
             std::optional<std::string_view> label;
             /// The binding name, and the label if one was not provided.
-            std::string_view name;
+            Symbol name;
             /// When passing a closure with no arguments an implicit convention means that
             /// passing a value of the closure's return type will automatically wrap it in one.
             /// This is used to implement lazy semantics, primarily short circuit semantics for boolean operators.
@@ -2312,7 +3619,7 @@ namespace str {
         struct Fun final {
             struct Operator final {
                 enum class Kind { Prefix, Infix, Postfix } kind;
-                std::optional<std::string_view> name;
+                std::optional<Symbol> name;
             };
 
             enum class Accessor { None, Get, Set, Mut };
@@ -2347,16 +3654,16 @@ namespace str {
             /// Determines if this is a function or accessor.
             Accessor accessor;
             /// The name of the function.
-            std::optional<std::string_view> name;
+            std::optional<Symbol> name;
             /// Explicit generic parameter list.
-            std::vector<GenericParameter> generics;
+            ArenaVector<GenericParameter> generics;
             /// The convention used for passing `self` (or none at all).
             /// This determines if it's an instance method for most types in the language.
             SelfArgument self;
             /// The arguments specified by this signature.
-            std::vector<Argument> args;
+            ArenaVector<Argument> args;
             /// A list of thrown exceptions.
-            std::vector<Expr> throws;
+            ArenaVector<Expr> throws;
             /// In highly generic code `rethrows` can be used instead of a `throws` list, which makes the function
             /// completely transparent to exceptions, forwarding all of them. This doesn't conflict with an explicit
             /// exception list, so in cases where distinct exceptions are still thrown they should be expressed
@@ -2370,7 +3677,7 @@ namespace str {
             /// For most declarations not having a body is normal, but for functions this is only allowed
             /// in categories. Otherwise, the backend will be asked to resolve the implementation, usually
             /// by looking for an annotation like `Extern`.
-            std::optional<Expr> body;
+            std::optional<Body> body;
         };
 
         /// Type initializer.
@@ -2388,19 +3695,19 @@ namespace str {
         /// ```
         struct Init final {
             /// Generics behave the same way as for functions.
-            std::vector<GenericParameter> generics;
+            ArenaVector<GenericParameter> generics;
             /// Arguments behave the same way as for functions, but there is no explicit self argument.
             /// That is because Strawberry does not have a dedicated `out` argument passing convention.
-            std::vector<Argument> args;
+            ArenaVector<Argument> args;
             /// Initializers can have a lifetime list that ties the initialized type.
-            std::vector<std::string_view> lifetimes;
+            ArenaVector<std::string_view> lifetimes;
             /// Throws behave the same way as for functions.
-            std::vector<Expr> throws;
+            ArenaVector<Expr> throws;
             /// Rethrows behave the same way as for functions.
             bool rethrows;
             std::optional<Expr> where;
             /// The block expression body of the initializer.
-            std::optional<Expr> body;
+            std::optional<Body> body;
         };
 
         /// The static initializer has a dedicated declaration node. It is documented together with the normal `init`.
@@ -2409,7 +3716,7 @@ namespace str {
         /// is not going to be a feature.
         struct StaticInit final {
             /// The block expression body of the static initializer.
-            Expr body;
+            Body body;
         };
 
         /// Type deinitializer.
@@ -2431,18 +3738,18 @@ namespace str {
         /// they grammatically resemble them a lot more.
         struct Deinit final {
             /// The block expression body of the default deinitializer.
-            Expr body;
+            Body body;
         };
 
         /// Structure declaration.
         ///
         /// Structs are nominal aggregate types, and the most common type declaration.
         struct Struct final {
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         /// Enumeration declaration.
@@ -2457,28 +3764,28 @@ namespace str {
         struct Enum final {
             struct Case final {
                 /// The case name. Enum case names must start with upper case.
-                std::string_view name;
+                Symbol name;
                 /// Always `Expr::Tuple`.
                 std::optional<Expr> tuple_expr;
                 /// The raw tag value expression.
                 std::optional<Expr> tag_expr;
             };
 
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
-            std::vector<Case> cases;
+            ArenaVector<Decl> decls;
+            ArenaVector<Case> cases;
         };
 
         /// Category declaration.
         struct Category final {
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         /// Extension declaration.
@@ -2498,9 +3805,9 @@ namespace str {
         /// constrained to the category.
         struct Extend final {
             Path target_path;
-            std::vector<Expr> superlist;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         /// Type alias declaration.
@@ -2517,7 +3824,7 @@ namespace str {
         /// ```
         struct TypeAlias final {
             /// The alias name.
-            std::string_view name;
+            Symbol name;
             /// The alias expression.
             Expr expr;
         };
@@ -2529,7 +3836,7 @@ namespace str {
         /// This is a very prototypical feature and may end up being changed or removed.
         struct CategoryAlias final {
             /// The alias name.
-            std::string_view name;
+            Symbol name;
             /// The alias expression.
             Expr expr;
         };
@@ -2558,7 +3865,7 @@ namespace str {
             enum class Kind { Prefix, Postfix };
 
             /// The symbolic identifier of the operator.
-            std::string_view name;
+            Symbol name;
             /// The operator kind.
             Kind kind;
             /// The type mapping expression.
@@ -2599,11 +3906,11 @@ namespace str {
         /// let x: BackingErasureType = BackingErasureType(Instance(x: 0, y: 0), in: allocator) // Effective desugaring.
         /// ```
         struct Class final {
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         struct Member final {
@@ -2615,7 +3922,7 @@ namespace str {
             /// The lifetime binding name.
             std::optional<std::string_view> lifetime;
             /// The name of the member declaration.
-            std::string_view name;
+            Symbol name;
             /// The type expression, required for instance members.
             std::optional<Expr> type_expr;
             /// The default expression, not allowed for instance members at the moment.
@@ -2630,21 +3937,21 @@ namespace str {
         /// The members of objects do not need to use the `self` argument as their methods inherently satisfy all
         /// possible variants at the same time.
         struct Object final {
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         /// Annotations resemble structs but they are implicitly const only and are attached to declarations or
         /// expressions for use with reflection or as hints to tooling or the compiler.
         struct Annotation final {
-            std::string_view name;
-            std::vector<GenericParameter> generics;
-            std::vector<Expr> superlist;
+            Symbol name;
+            ArenaVector<GenericParameter> generics;
+            ArenaVector<Expr> superlist;
             std::optional<Expr> where;
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
         };
 
         /// An import declaration must be used at the top of the source units after the module header and
@@ -2705,8 +4012,8 @@ namespace str {
 
         Decl(Provenance provenance, Data data) : data(std::move(data)), provenance(provenance) {}
 
-        std::optional<std::string> documentation;
-        std::vector<AnnotationAttachment> annotations;
+        std::optional<ArenaString> documentation;
+        ArenaVector<AnnotationAttachment> annotations;
 
         Visibility mod_visibility;
         bool mod_unsafe = false;
@@ -2720,39 +4027,569 @@ namespace str {
         bool mod_final = false;
         bool mod_base = false;
 
-        template <typename T> auto get() -> T& {
-            return std::get<T>(data);
+        template <typename T> auto get() -> T& {
+            return std::get<T>(data);
+        }
+
+        template <typename T> auto get_as() -> T* {
+            if (std::holds_alternative<T>(data)) {
+                return &std::get<T>(data);
+            } else {
+                return nullptr;
+            }
+        }
+
+        template <typename T> auto get() const -> T const& {
+            return std::get<T>(data);
+        }
+
+        template <typename T> auto get_as() const -> T const* {
+            if (std::holds_alternative<T>(data)) {
+                return &std::get<T>(data);
+            } else {
+                return nullptr;
+            }
+        }
+
+        /// Answers the generic parameters, which are empty for declarations which can't have any.
+        auto get_generics() const -> std::span<const GenericParameter> {
+            return std::visit([] (auto const& data) -> std::span<const GenericParameter> {
+                if constexpr (requires { data.generics; }) {
+                    return data.generics;
+                } else {
+                    return {};
+                }
+            }, data);
+        }
+    };
+
+    namespace stats {
+        inline KindCounter<Expr::Data> exprs { "ast.exprs" };
+        inline KindCounter<Decl::Data> decls { "ast.decls" };
+        inline Counter provenance_bytes { "ast.provenance_bytes" };
+
+        /// Counts the nodes of a finished tree by kind, and the bytes of provenance they carry.
+        /// Bodies which are still deferred are left out, counting them must not parse them.
+        template <typename T> void count_nodes(T const& value) {
+            if constexpr (std::same_as<T, Expr>) {
+                exprs.add(value.data);
+                count_nodes(value.provenance);
+                count_nodes(value.data);
+            } else if constexpr (std::same_as<T, Decl>) {
+                decls.add(value.data);
+                constexpr auto members = coding::detail::reflected_members<Decl>();
+                template for (constexpr auto member : members) count_nodes(value.[:member:]);
+            } else if constexpr (std::same_as<T, Decl::Body>) {
+                if (value.parsed()) count_nodes(value.get());
+            } else if constexpr (std::same_as<T, Provenance>) {
+                provenance_bytes.add(sizeof(Provenance));
+            } else if constexpr (std::same_as<T, Path> or std::is_convertible_v<T const&, std::string_view>) {
+                // Names and paths hold no nodes.
+            } else if constexpr (requires { typename T::element_type; value.get(); }) {
+                if (value) count_nodes(*value);
+            } else if constexpr (coding::detail::is_optional_v<T>) {
+                if (value) count_nodes(*value);
+            } else if constexpr (coding::detail::is_variant_v<T>) {
+                std::visit([] (auto const& alternative) { count_nodes(alternative); }, value);
+            } else if constexpr (std::ranges::range<T>) {
+                for (auto const& element : value) count_nodes(element);
+            } else if constexpr (std::is_class_v<T>) {
+                constexpr auto members = coding::detail::reflected_members<T>();
+                template for (constexpr auto member : members) count_nodes(value.[:member:]);
+            }
+        }
+    }
+
+    /// The syntax tree of a source unit.
+    ///
+    /// Every node of the tree lives in the arena owned by the tree, including the declaration list itself,
+    /// which is never destroyed, so tearing a tree down amounts to releasing the chunks of its arena.
+    /// Nodes must therefore not be moved out of a tree that is about to be destroyed.
+    class Ast final {
+        /// Declared first, so that it outlives everything allocated from it.
+        std::unique_ptr<Arena> arena;
+        ArenaVector<Decl>* decls;
+
+      public:
+        Path module;
+        std::string_view source;
+
+        /// Adopts an arena along with the declarations allocated from it.
+        Ast(std::unique_ptr<Arena> arena, ArenaVector<Decl> decls, Path module, std::string_view source)
+            : arena(std::move(arena)), module(std::move(module)), source(source)
+        {
+            ArenaScope scope(*this->arena);
+            this->decls = make_box<ArenaVector<Decl>>(std::move(decls)).release();
+        }
+
+        auto get_decls() -> std::span<Decl> { return *decls; }
+        auto get_decls() const -> std::span<const Decl> { return *decls; }
+        auto get_arena() const -> Arena const& { return *arena; }
+    };
+
+    /// A flattened expression tree, laid out for traversal rather than construction.
+    ///
+    /// Nodes are stored in post-order, so every child precedes its parent and the root is the last node.
+    /// Per node data lives in parallel columns indexed by the node, and the children of a node are a
+    /// contiguous range of slots in a side array. Each slot records the role the child plays in its parent
+    /// along with its label and flags, which is how sub-records like call arguments or match arms are flattened.
+    /// Absent optional children still occupy their slot with a `none` node, and so do destructuring groups.
+    class FlatExpr final {
+      public:
+        using Index = u32;
+        /// The index of the alternative of the node in `Expr::Data`.
+        using Tag = u8;
+
+        static_assert(std::variant_size_v<Expr::Data> <= std::numeric_limits<Tag>::max());
+
+        /// Marks an absent optional child.
+        static constexpr Index none = std::numeric_limits<Index>::max();
+
+        template <typename T> static constexpr Tag tag_of = [] <usize... I> (std::index_sequence<I...>) {
+            Tag tag = 0;
+            ((std::same_as<T, std::variant_alternative_t<I, Expr::Data>> ? (tag = Tag(I), true) : false) or ...);
+            return tag;
+        }(std::make_index_sequence<std::variant_size_v<Expr::Data>>());
+
+        /// The part a child plays in its parent.
+        enum class Role : u8 {
+            Operand,
+            Element,
+            Argument,
+            Capture,
+            Throws,
+            Return,
+            Type,
+            Annotation,
+            Pattern,
+            Where,
+            Body,
+            Else,
+            Rhs,
+            Binding,
+            ElseBinding,
+            Backend
+        };
+
+        /// Node flags, which apply depends on the tag.
+        enum NodeFlag : u8 {
+            /// The value of a boolean literal.
+            True = 1 << 0,
+            /// An async callable type or closure.
+            Async = 1 << 1,
+            /// The callable type or closure has a capture list, possibly an empty one.
+            Captures = 1 << 2,
+            /// The callable type or closure has a throws clause, possibly an empty one.
+            Throws = 1 << 3,
+            /// A mutable binding.
+            NodeMut = 1 << 4,
+            /// A reference binding.
+            NodeRef = 1 << 5
+        };
+
+        /// Slot flags, which apply depends on the role.
+        enum SlotFlag : u8 {
+            Mut = 1 << 0,
+            Ref = 1 << 1,
+            Unsafe = 1 << 2,
+            BorrowedProjection = 1 << 3,
+            MutableProjection = 1 << 4,
+            /// A destructuring tuple, its elements are the slots that follow it, see `groups`.
+            Group = 1 << 5
+        };
+
+      private:
+        struct Slot final {
+            Index node;
+            Role role;
+            Symbol label;
+            u8 flags;
+            u32 group = 0;
+        };
+
+        std::vector<Tag> tags;
+        /// The alternative of the inner variant of a node, the conjunction of a fold or the kind of pattern.
+        std::vector<u8> kinds;
+        std::vector<u8> flags;
+        /// The symbol id of the name of a node, or the index of its literal.
+        std::vector<u32> payloads;
+        std::vector<Provenance> provenances;
+        /// Slot ranges are monotonic in post-order, so node `i` owns the slots `[offsets[i], offsets[i + 1])`.
+        std::vector<u32> offsets = { 0 };
+
+        std::vector<Index> slot_nodes;
+        std::vector<Role> slot_roles;
+        std::vector<Symbol> slot_labels;
+        std::vector<u8> slot_modifiers;
+        /// The number of slots following a `Group` slot which are its elements, zero for any other slot.
+        std::vector<u32> slot_groups;
+
+        /// The slots of the nodes being emitted. Children are emitted while their parent collects its slots,
+        /// so every node pushes its slots above those of its ancestors and pops them once they are stored.
+        std::vector<Slot> pending;
+
+        std::vector<std::string> literals;
+
+        static auto label(std::optional<std::string_view> label) -> Symbol {
+            return label ? Symbol(*label) : Symbol();
+        }
+
+        static auto convention(Expr::Callable::Argument::Convention convention) -> u8 {
+            switch (convention) {
+                case Expr::Callable::Argument::Convention::Consume: return 0;
+                case Expr::Callable::Argument::Convention::BorrowedProjection: return BorrowedProjection;
+                case Expr::Callable::Argument::Convention::MutableProjection: return MutableProjection;
+            }
+
+            std::unreachable();
+        }
+
+        static auto convention(Expr::Callable::Capture::Convention convention) -> u8 {
+            switch (convention) {
+                case Expr::Callable::Capture::Convention::Consume: return 0;
+                case Expr::Callable::Capture::Convention::BorrowedProjection: return BorrowedProjection;
+                case Expr::Callable::Capture::Convention::MutableProjection: return MutableProjection;
+            }
+
+            std::unreachable();
+        }
+
+        static auto binding(bool mut, bool ref) -> u8 {
+            return (mut ? Mut : 0) | (ref ? Ref : 0);
+        }
+
+        void destructure(Expr::Destructuring const& destructuring, Role role) {
+            std::visit(overloaded {
+                [&] (Expr::Destructuring::Binding const& binding) {
+                    Index node = binding.type_expr ? emit(**binding.type_expr) : none;
+                    pending.push_back({ node, role, Symbol(binding.name), FlatExpr::binding(binding.mut, binding.ref) });
+                },
+                [&] (Expr::Destructuring::Tuple const& tuple) {
+                    usize group = pending.size();
+                    pending.push_back({ none, role, Symbol(), Group });
+                    for (auto const& element : tuple.elements) destructure(element, role);
+                    pending[group].group = u32(pending.size() - group - 1);
+                }
+            }, *destructuring.data);
+        }
+
+        auto emit(Expr const& expr) -> Index {
+            usize base = pending.size();
+            u8 kind = 0;
+            u8 flag = 0;
+            u32 payload = 0;
+
+            auto child = [&] (Expr const& node, Role role = Role::Operand, Symbol label = Symbol(), u8 flags = 0) {
+                Index index = emit(node);
+                pending.push_back({ index, role, label, flags });
+            };
+
+            auto optional = [&] (std::optional<Expr::ExprBox> const& node, Role role = Role::Operand, Symbol label = Symbol(), u8 flags = 0) {
+                Index index = node ? emit(**node) : none;
+                pending.push_back({ index, role, label, flags });
+            };
+
+            auto name = [&] (Symbol name) { payload = name.get_id(); };
+
+            auto literal = [&] (std::string_view literal) {
+                payload = u32(literals.size());
+                literals.emplace_back(literal);
+            };
+
+            std::visit(overloaded {
+                [&] (Expr::Fold const& fold) {
+                    kind = u8(fold.conjunction.index());
+                    if (auto infix = std::get_if<Expr::Fold::InfixConjunction>(&fold.conjunction)) name(infix->name);
+                    child(*fold.expr);
+                },
+                [&] (Expr::Infix const& infix) {
+                    name(infix.name);
+                    child(*infix.lhs);
+                    child(*infix.rhs);
+                },
+                [&] (Expr::Prefix const& prefix) {
+                    name(prefix.name);
+                    child(*prefix.rhs);
+                },
+                [&] (Expr::Postfix const& postfix) {
+                    name(postfix.name);
+                    child(*postfix.lhs);
+                },
+                [&] (Expr::Deref const& deref) { child(*deref.rhs); },
+                [&] (Expr::Wildcard const&) {},
+                [&] (Expr::Number const& number) { literal(number.literal); },
+                [&] (Expr::String const& string) { literal(string.content); },
+                [&] (Expr::Boolean const& boolean) { if (boolean.value) flag |= True; },
+                [&] (Expr::MutableForward const& forward) { child(*forward.expr); },
+                [&] (Expr::UniversalForward const& forward) { child(*forward.expr); },
+                [&] (Expr::Intrinsic const& intrinsic) {
+                    name(intrinsic.name);
+                    if (intrinsic.backend) pending.push_back({ none, Role::Backend, Symbol(*intrinsic.backend), 0 });
+                    for (auto const& expression : intrinsic.expressions) child(*expression, Role::Element);
+                },
+                [&] (Expr::Tuple const& tuple) {
+                    for (auto const& element : tuple.elements) child(*element.expr, Role::Element, label(element.label));
+                },
+                [&] (Expr::Callable const& callable) {
+                    if (callable.async) flag |= Async;
+
+                    for (auto const& argument : callable.args) {
+                        child(*argument.type_expr, Role::Argument, label(argument.label), convention(argument.convention));
+                    }
+
+                    if (callable.captures) {
+                        flag |= Captures;
+                        for (auto const& capture : *callable.captures) {
+                            child(*capture.type_expr, Role::Capture, Symbol(), convention(capture.convention));
+                        }
+                    }
+
+                    if (callable.throws) {
+                        flag |= Throws;
+                        for (auto const& throws : *callable.throws) child(*throws, Role::Throws);
+                    }
+
+                    child(*callable.return_type, Role::Return);
+                },
+                [&] (Expr::Subtype const& subtype) {
+                    child(*subtype.lhs);
+                    child(*subtype.rhs);
+                },
+                [&] (Expr::Annotations const& annotations) {
+                    for (auto const& annotation : annotations.annotations) {
+                        child(*annotation.annotation, Role::Annotation, Symbol(), annotation.unsafe ? Unsafe : 0);
+                    }
+
+                    child(*annotations.expr);
+                },
+                [&] (Expr::Call const& call) {
+                    child(*call.callee);
+                    for (auto const& argument : call.arguments) child(*argument.expr, Role::Argument, label(argument.label));
+                },
+                [&] (Expr::Subscript const& subscript) {
+                    child(*subscript.callee);
+                    for (auto const& argument : subscript.arguments) child(*argument.expr, Role::Argument, label(argument.label));
+                },
+                [&] (Expr::Block const& block) {
+                    for (auto const& expression : block.expressions) child(*expression, Role::Element);
+                },
+                [&] (Expr::Generics const& generics) {
+                    child(*generics.callee);
+                    for (auto const& parameter : generics.parameters) child(*parameter.expr, Role::Argument, label(parameter.label));
+                },
+                [&] (Expr::List const& list) {
+                    for (auto const& expression : list.expressions) child(*expression, Role::Element);
+                },
+                [&] (Expr::Identifier const& identifier) { name(identifier.name); },
+                [&] (Expr::Unsafe const& unsafe) { child(*unsafe.expr); },
+                [&] (Expr::Recurse const& recurse) { child(*recurse.expr); },
+                [&] (Expr::Return const& return_expr) { optional(return_expr.expr); },
+                [&] (Expr::Yield const& yield) { child(*yield.expr); },
+                [&] (Expr::Throw const& throw_expr) { child(*throw_expr.expr); },
+                [&] (Expr::Await const& await) { child(*await.expr); },
+                [&] (Expr::Member const& member) {
+                    name(member.name);
+                    child(*member.expr);
+                },
+                [&] (Expr::MemberDeref const& member) {
+                    name(member.name);
+                    child(*member.expr);
+                },
+                [&] (Expr::MetaMember const& member) {
+                    name(member.name);
+                    child(*member.expr);
+                },
+                [&] (Expr::If const& if_expr) {
+                    child(*if_expr.pattern, Role::Pattern);
+                    child(*if_expr.body, Role::Body);
+                    optional(if_expr.else_body, Role::Else);
+                },
+                [&] (Expr::Guard const& guard) {
+                    child(*guard.pattern, Role::Pattern);
+                    child(*guard.else_body, Role::Else);
+                },
+                [&] (Expr::When const& when) { child(*when.pattern, Role::Pattern); },
+                [&] (Expr::While const& while_expr) {
+                    child(*while_expr.pattern, Role::Pattern);
+                    child(*while_expr.body, Role::Body);
+                },
+                [&] (Expr::MemberInfer const& member) { name(member.name); },
+                [&] (Expr::Label const& label) {
+                    name(Symbol(label.name));
+                    child(*label.expr);
+                },
+                [&] (Expr::Break const& break_expr) {
+                    name(label(break_expr.label));
+                    optional(break_expr.expr);
+                },
+                [&] (Expr::Continue const& continue_expr) { name(label(continue_expr.label)); },
+                [&] (Expr::Loop const& loop) { child(*loop.body, Role::Body); },
+                [&] (Expr::Match const& match) {
+                    child(*match.lhs);
+
+                    for (auto const& arm : match.arms) {
+                        child(*arm.pattern, Role::Pattern);
+                        child(*arm.body, Role::Body);
+                    }
+                },
+                [&] (Expr::Catch const& catch_expr) {
+                    child(*catch_expr.lhs);
+
+                    for (auto const& arm : catch_expr.arms) {
+                        child(*arm.pattern, Role::Pattern, Symbol(arm.name));
+                        optional(arm.where_clause, Role::Where);
+                        child(*arm.body, Role::Body);
+                    }
+                },
+                [&] (Expr::Closure const& closure) {
+                    if (closure.async) flag |= Async;
+
+                    for (auto const& argument : closure.arguments) {
+                        optional(argument.type_expr, Role::Argument, Symbol(argument.name), binding(argument.mut, argument.ref));
+                    }
+
+                    if (closure.captures) {
+                        flag |= Captures;
+                        for (auto const& capture : *closure.captures) {
+                            optional(capture.init_expr, Role::Capture, Symbol(capture.name), binding(capture.mut, capture.ref));
+                        }
+                    }
+
+                    if (closure.throws) {
+                        flag |= Throws;
+                        for (auto const& throws : *closure.throws) child(*throws, Role::Throws);
+                    }
+
+                    optional(closure.return_type, Role::Return);
+                    child(*closure.body, Role::Body);
+                },
+                [&] (Expr::TrailingClosure const& trailing) {
+                    child(*trailing.lhs);
+                    child(*trailing.closure, Role::Body);
+                },
+                [&] (Expr::For const& for_expr) {
+                    destructure(for_expr.binding, Role::Binding);
+                    child(*for_expr.iterator);
+                    optional(for_expr.where_clause, Role::Where);
+                    child(*for_expr.body, Role::Body);
+                    if (for_expr.else_binding) destructure(*for_expr.else_binding, Role::ElseBinding);
+                    optional(for_expr.else_body, Role::Else);
+                },
+                [&] (Expr::Binding const& binding) {
+                    name(Symbol(binding.name));
+                    if (binding.mut) flag |= NodeMut;
+                    if (binding.ref) flag |= NodeRef;
+                    optional(binding.type_expr, Role::Type);
+                    optional(binding.rhs, Role::Rhs);
+                },
+                [&] (Expr::DestructuringBinding const& binding) {
+                    destructure(binding.pattern, Role::Binding);
+                    optional(binding.rhs, Role::Rhs);
+                },
+                [&] (Expr::PatternBinding const& binding) {
+                    name(Symbol(binding.name));
+                    if (binding.mut) flag |= NodeMut;
+                    if (binding.ref) flag |= NodeRef;
+                    optional(binding.type_expr, Role::Type);
+                },
+                [&] (Expr::Pattern const& pattern) {
+                    kind = u8(pattern.data.index());
+
+                    std::visit(overloaded {
+                        [&] (Expr::Pattern::Enum const& enum_pattern) {
+                            name(Symbol(enum_pattern.name));
+                            for (auto const& element : enum_pattern.elements) child(*element, Role::Element);
+                        },
+                        [&] (Expr::Pattern::Tuple const& tuple) {
+                            for (auto const& element : tuple.elements) child(*element, Role::Element);
+                        },
+                        [&] (Expr::Pattern::Value const& value) { child(*value.expr); }
+                    }, pattern.data);
+
+                    optional(pattern.rhs, Role::Rhs);
+                    optional(pattern.where_clause, Role::Where);
+                },
+                [&] (Expr::Lifetime const& lifetime) { name(Symbol(lifetime.name)); },
+                [&] (Expr::New const&) {}
+            }, expr.data);
+
+            Index index = Index(tags.size());
+
+            tags.push_back(Tag(expr.data.index()));
+            kinds.push_back(kind);
+            flags.push_back(flag);
+            payloads.push_back(payload);
+            provenances.push_back(expr.provenance);
+
+            for (usize i = base; i < pending.size(); i += 1) {
+                slot_nodes.push_back(pending[i].node);
+                slot_roles.push_back(pending[i].role);
+                slot_labels.push_back(pending[i].label);
+                slot_modifiers.push_back(pending[i].flags);
+                slot_groups.push_back(pending[i].group);
+            }
+
+            pending.resize(base);
+            offsets.push_back(u32(slot_nodes.size()));
+
+            return index;
+        }
+
+        auto slot_range(Index node) const -> std::pair<u32, u32> {
+            return { offsets[node], offsets[node + 1] - offsets[node] };
+        }
+
+      public:
+        /// Flattens an expression tree, the expression itself becomes the root.
+        static auto from(Expr const& expr) -> FlatExpr {
+            FlatExpr flat;
+            (void) flat.emit(expr);
+            flat.pending = {};
+            return flat;
+        }
+
+        auto size() const -> usize { return tags.size(); }
+        auto root() const -> Index { return Index(tags.size() - 1); }
+
+        auto tag(Index node) const -> Tag { return tags[node]; }
+        template <typename T> auto is(Index node) const -> bool { return tags[node] == tag_of<T>; }
+
+        auto kind(Index node) const -> u8 { return kinds[node]; }
+        auto has(Index node, NodeFlag flag) const -> bool { return flags[node] & flag; }
+        auto name(Index node) const -> Symbol { return Symbol::from_id(payloads[node]); }
+        auto literal(Index node) const -> std::string_view { return literals[payloads[node]]; }
+        auto provenance(Index node) const -> Provenance { return provenances[node]; }
+
+        /// The child nodes of a node, with `none` for absent optional children and destructuring groups.
+        auto children(Index node) const -> std::span<const Index> {
+            auto [begin, count] = slot_range(node);
+            return std::span(slot_nodes).subspan(begin, count);
         }
 
-        template <typename T> auto get_as() -> T* {
-            if (std::holds_alternative<T>(data)) {
-                return &std::get<T>(data);
-            } else {
-                return nullptr;
-            }
+        auto roles(Index node) const -> std::span<const Role> {
+            auto [begin, count] = slot_range(node);
+            return std::span(slot_roles).subspan(begin, count);
         }
 
-        template <typename T> auto get() const -> T const& {
-            return std::get<T>(data);
+        auto labels(Index node) const -> std::span<const Symbol> {
+            auto [begin, count] = slot_range(node);
+            return std::span(slot_labels).subspan(begin, count);
         }
 
-        template <typename T> auto get_as() const -> T const* {
-            if (std::holds_alternative<T>(data)) {
-                return &std::get<T>(data);
-            } else {
-                return nullptr;
-            }
+        /// The slot flags of the children of a node.
+        auto modifiers(Index node) const -> std::span<const u8> {
+            auto [begin, count] = slot_range(node);
+            return std::span(slot_modifiers).subspan(begin, count);
         }
-    };
 
-    class Ast final {
-      public:
-        std::vector<Decl> decls;
-        Path module;
-        std::string_view source;
+        /// The number of elements of each `Group` slot of a node, which are the slots right after it.
+        auto groups(Index node) const -> std::span<const u32> {
+            auto [begin, count] = slot_range(node);
+            return std::span(slot_groups).subspan(begin, count);
+        }
 
-        Ast(std::vector<Decl> decls, Path module, std::string_view source)
-            : decls(std::move(decls)), module(std::move(module)), source(source) {}
+        /// The tag column, for passes that only need to scan node kinds in post-order.
+        auto get_tags() const -> std::span<const Tag> { return tags; }
     };
 }
 
@@ -2761,6 +4598,67 @@ namespace str {
         T const& range;
         constexpr explicit MultilineRange(T const& range) : range(range) {}
     };
+
+    namespace detail {
+        /// Writes a part of a syntax tree with everything below it, classes by name with every member.
+        /// Bodies which are still deferred are written as `deferred`, formatting must not parse them.
+        template <typename T> void write_tree(std::string& out, T const& value) {
+            if constexpr (std::same_as<T, Decl::Body>) {
+                if (value.parsed()) {
+                    write_tree(out, value.get());
+                } else {
+                    out += "deferred";
+                }
+            } else if constexpr (std::same_as<T, bool>) {
+                out += value ? "true" : "false";
+            } else if constexpr (std::is_arithmetic_v<T>) {
+                std::format_to(std::back_inserter(out), "{}", value);
+            } else if constexpr (std::is_enum_v<T>) {
+                std::format_to(std::back_inserter(out), "{}", std::to_underlying(value));
+            } else if constexpr (std::same_as<T, Path>) {
+                out += std::string(value);
+            } else if constexpr (std::is_convertible_v<T const&, std::string_view>) {
+                std::format_to(std::back_inserter(out), "{:?}", std::string_view(value));
+            } else if constexpr (requires { typename T::element_type; value.get(); } or coding::detail::is_optional_v<T>) {
+                if (value) {
+                    write_tree(out, *value);
+                } else {
+                    out += "none";
+                }
+            } else if constexpr (coding::detail::is_variant_v<T>) {
+                std::visit([&] (auto const& alternative) { write_tree(out, alternative); }, value);
+            } else if constexpr (std::ranges::range<T>) {
+                out += '[';
+
+                bool first = true;
+                for (auto const& element : value) {
+                    if (not first) out += ", "; first = false;
+                    write_tree(out, element);
+                }
+
+                out += ']';
+            } else if constexpr (std::is_class_v<T>) {
+                if constexpr (std::meta::has_identifier(^^T)) {
+                    out += std::meta::identifier_of(^^T);
+                    out += ' ';
+                }
+                out += '{';
+
+                bool first = true;
+                constexpr auto members = coding::detail::reflected_members<T>();
+                template for (constexpr auto member : members) {
+                    out += first ? " " : ", "; first = false;
+                    out += std::meta::identifier_of(member);
+                    out += ": ";
+                    write_tree(out, value.[:member:]);
+                }
+
+                out += first ? "}" : " }";
+            } else {
+                static_assert(sizeof(T) == 0, "unsupported syntax tree type");
+            }
+        }
+    }
 }
 
 template <typename R> struct std::formatter<str::MultilineRange<R>, char> {
@@ -2788,224 +4686,33 @@ template <typename R> struct std::formatter<str::MultilineRange<R>, char> {
     }
 };
 
-// template <> struct std::formatter<str::Expr, char> {
-//     constexpr auto parse(std::format_parse_context& ctx) {
-//         auto it = ctx.begin();
-//         if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Expr");
-//         return it;
-//     }
-
-//     constexpr auto format(str::Expr const& expr, std::format_context& ctx) const {
-//         throw std::runtime_error("todo");
-//         return ctx.out();
-//     }
-// };
-
-// template <> struct std::formatter<str::Decl, char> {
-//     constexpr auto parse(std::format_parse_context& ctx) {
-//         auto it = ctx.begin();
-//         if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Decl");
-//         return it;
-//     }
-
-//     constexpr auto format(str::Decl const& decl, std::format_context& ctx) const {
-//         using namespace str;
-
-//         auto out = ctx.out();
-
-//         switch (decl.mod_visibility) {
-//             case str::Decl::Visibility::Pub:    out = std::format_to(out, "pub ");      break;
-//             case str::Decl::Visibility::PubGet: out = std::format_to(out, "pub(get) "); break;
-//             case str::Decl::Visibility::PubSet: out = std::format_to(out, "pub(set) "); break;
-//         }
-
-//         if (decl.mod_unsafe)   out = std::format_to(out, "unsafe ");
-//         if (decl.mod_open)     out = std::format_to(out, "open ");
-//         if (decl.mod_override) out = std::format_to(out, "override ");
-//         if (decl.mod_inherent) out = std::format_to(out, "inherent ");
-//         if (decl.mod_const)    out = std::format_to(out, "const ");
-//         if (decl.mod_static)   out = std::format_to(out, "static ");
-//         if (decl.mod_inline)   out = std::format_to(out, "inline ");
-//         if (decl.mod_implicit) out = std::format_to(out, "implicit ");
-//         if (decl.mod_final)    out = std::format_to(out, "final ");
-//         if (decl.mod_base)     out = std::format_to(out, "base ");
-
-//         return std::visit(overloaded {
-//             [&] (Decl::Fun const& decl) {
-//                 return std::format_to(out,
-//                     "Fun(\n"
-//                     " deinit: {},\n"
-//                     " operator: {},\n"
-//                     " accessor: {},\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " self: {},\n"
-//                     " args: {},\n"
-//                     " throws: {},\n"
-//                     " rethrows: {},\n"
-//                     " where: {},\n"
-//                     " body: {}\n"
-//                     ")",
-//                     decl.deinit
-//                 );
-//             },
-//             [&] (Decl::Init const& decl) {
-//                 return std::format_to(out,
-//                     "Init(\n"
-//                     " generics: {},\n"
-//                     " args: {},\n"
-//                     " lifetimes: {},\n"
-//                     " throws: {},\n"
-//                     " rethrows: {},\n"
-//                     " where: {},\n"
-//                     " body: {}\n"
-//                     ")"
-//                 );
-//             },
-//             [&] (Decl::StaticInit const& decl) {
-//                 return std::format_to(out,
-//                     "StaticInit(\n"
-//                     " body: {}\n"
-//                     ")",
-//                     decl.body
-//                 );
-//             },
-//             [&] (Decl::Deinit const& decl) {
-//                 return std::format_to(out,
-//                     "Deinit(\n"
-//                     " body: {}\n"
-//                     ")",
-//                     decl.body
-//                 );
-//             },
-//             [&] (Decl::Struct const& decl) {
-//                 return std::format_to(out,
-//                     "Struct(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")",
-//                     decl.name,
-//                     MultilineRange(decl.generics),
-//                     MultilineRange(decl.superlist),
-//                     decl.where,
-//                     MultilineRange(decl.decls)
-//                 );
-//             },
-//             [&] (Decl::Enum const& decl) {
-//                 return std::format_to(out,
-//                     "Enum(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {},\n"
-//                     " cases: {}\n"
-//                     ")",
-//                     decl.name,
-//                     decl.generics,
-//                     decl.superlist,
-//                     decl.where,
-//                     decl.decls,
-//                     decl.cases
-//                 );
-//             },
-//             [&] (Decl::Category const& decl) {
-//                 return std::format_to(out,
-//                     "Category(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")",
-//                     decl.name,
-//                     decl.generics,
-//                     decl.superlist,
-//                     decl.where,
-//                     decl.decls
-//                 );
-//             },
-//             [&] (Decl::Extend const& decl) {
-//                 return std::format_to(out,
-//                     "Extend(\n"
-//                     " path: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")",
-//                     std::string(decl.target_path),
-//                     decl.superlist,
-//                     decl.where,
-//                     decl.decls
-//                 );
-//             },
-//             [&] (Decl::TypeAlias const& decl) {
-//                 return std::format_to(out, "TypeAlias(name: {}, expr: {})", decl.name, decl.expr);
-//             },
-//             [&] (Decl::CategoryAlias const& decl) {
-//                 return std::format_to(out, "CategoryAlias(name: {}, expr: {})", decl.name, decl.expr);
-//             },
-//             [&] (Decl::TypeOperator const& decl) {
-//                 std::string_view kind; switch (decl.kind) {
-//                     case str::Decl::TypeOperator::Kind::Prefix:  kind = "Prefix";  break;
-//                     case str::Decl::TypeOperator::Kind::Postfix: kind = "Postfix"; break;
-//                 }
-
-//                 return std::format_to(out, "TypeOperator(name: {}, kind: {}, expr: {})", decl.name, kind, decl.expr);
-//             },
-//             [&] (Decl::DecayType const& decl) {
-//                 return std::format_to(out, "DecayType(expr: {})", decl.expr);
-//             },
-//             [&] (Decl::Class const& decl) {
-//                 return std::format_to(out,
-//                     "Class(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")",
-//                     decl.name,
-//                     decl.generics,
-//                     decl.superlist,
-//                     decl.where,
-//                     decl.decls
-//                 );
-//             },
-//             [&] (Decl::Member const& decl) {
-//                 return out;
-//             },
-//             [&] (Decl::Object const& decl) {
-//                 return std::format_to(out,
-//                     "Object(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")"
-//                 );
-//             },
-//             [&] (Decl::Annotation const& decl) {
-//                 return std::format_to(out,
-//                     "Annotation(\n"
-//                     " name: {},\n"
-//                     " generics: {},\n"
-//                     " superlist: {},\n"
-//                     " where: {},\n"
-//                     " decls: {}\n"
-//                     ")"
-//                 );
-//             },
-//             [&] (Decl::Import const& decl) {
-//                 return std::format_to(out, "Import(path: {})", std::string(decl.path));
-//             }
-//         }, decl.data);
-//     }
-// };
+template <> struct std::formatter<str::Expr, char> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto it = ctx.begin();
+        if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Expr");
+        return it;
+    }
+
+    auto format(str::Expr const& expr, std::format_context& ctx) const {
+        std::string out;
+        str::detail::write_tree(out, expr);
+        return std::ranges::copy(out, ctx.out()).out;
+    }
+};
+
+template <> struct std::formatter<str::Decl, char> {
+    constexpr auto parse(std::format_parse_context& ctx) {
+        auto it = ctx.begin();
+        if (it != ctx.end() and *it != '}') throw std::format_error("invalid format args for str::Decl");
+        return it;
+    }
+
+    auto format(str::Decl const& decl, std::format_context& ctx) const {
+        std::string out;
+        str::detail::write_tree(out, decl);
+        return std::ranges::copy(out, ctx.out()).out;
+    }
+};
 
 namespace str {
     class Parser final {
@@ -3015,16 +4722,35 @@ namespace str {
         // are only written in one place, forcing jumps between files to know the default values for arguments.
         // That is exceptionally stupid but everything just works inside a class so it's okay.
 
+        /// Defers parsing function and initializer bodies until they are first asked for.
+        bool lazy_bodies = false;
+
+        /// Parses the block body of a function or initializer, or defers it when parsing lazily.
+        ///
+        /// Bodies are only deferred when they are being allocated into a tree and their braces balance,
+        /// anything else is parsed right away so that malformed text fails at the same point either way.
+        auto parse_body(TokenStream& tokens) -> Decl::Body {
+            if (lazy_bodies and current_arena) {
+                if (auto block = tokens.skip_balanced()) {
+                    return Decl::Body(make_box<Decl::Body::Deferred>(
+                        tokens.get_text(), tokens.get_source(), tokens.get_id(), *block, current_arena
+                    ));
+                }
+            }
+
+            return parse_block_expr(tokens);
+        }
+
         /// Parses the initial module header at the very top of the file.
         auto parse_module_header(TokenStream& tokens) -> Path {
             tokens.expect<Token::Identifier>("module");
 
             // Base path.
-            Path path = tokens.expect_as<Token::Identifier>().content;
+            Path path = tokens.expect_as<Token::Identifier>().symbol;
 
             // Submodule path.
             while (tokens.match<Token::Dot>()) {
-                path += tokens.expect_as<Token::Identifier>().content;
+                path += tokens.expect_as<Token::Identifier>().symbol;
             }
 
             // Required newline.
@@ -3038,7 +4764,7 @@ namespace str {
 
             tokens.expect<Token::BraceLeft>();
 
-            std::vector<Expr::ExprBox> expressions;
+            ArenaVector<Expr::ExprBox> expressions;
 
             while (true) {
                 tokens.drop_while(&Token::is<Token::NewLine>);
@@ -3064,7 +4790,7 @@ namespace str {
             auto span = tokens.span();
 
             std::optional<std::string_view> case_name;
-            std::vector<Expr::ExprBox> elements;
+            ArenaVector<Expr::ExprBox> elements;
             bool tuple_or_enum = false;
 
             if (tokens.match<Token::Dot>()) {
@@ -3140,7 +4866,7 @@ namespace str {
 
         auto parse_destructuring(TokenStream& tokens) -> Expr::Destructuring {
             if (tokens.match<Token::ParenLeft>()) {
-                std::vector<Expr::Destructuring> elements;
+                ArenaVector<Expr::Destructuring> elements;
 
                 if (not tokens.peek_match<Token::ParenRight>()) {
                     do {
@@ -3181,7 +4907,7 @@ namespace str {
 
                 tokens.expect<Token::ParenLeft>();
 
-                std::vector<Expr::ExprBox> arguments;
+                ArenaVector<Expr::ExprBox> arguments;
 
                 if (not tokens.peek_match<Token::ParenRight>()) {
                     do {
@@ -3368,7 +5094,7 @@ namespace str {
             }
 
             if (tokens.match<Token::Dot>()) {
-                std::string_view name = tokens.expect_as<Token::Identifier>().content;
+                Symbol name = tokens.expect_as<Token::Identifier>().symbol;
                 return Expr(span.take(), Expr::MemberInfer(name));
             }
 
@@ -3414,11 +5140,11 @@ namespace str {
             }
 
             if (auto string = tokens.match_as<Token::String>()) {
-                return Expr(span.take(), Expr::String(std::string(string->content)));
+                return Expr(span.take(), Expr::String(ArenaString(string->content)));
             }
 
             if (auto string_base = tokens.match_as<Token::MultilineString>()) {
-                std::string string = std::string(string_base->content);
+                ArenaString string = ArenaString(string_base->content);
 
                 bool past_newline = false;
                 while (true) {
@@ -3441,7 +5167,7 @@ namespace str {
                 // The special case of an empty tuple.
                 if (tokens.match<Token::ParenRight>()) return Expr(span.take(), Expr::Tuple());
 
-                std::vector<Expr::Tuple::Element> elements;
+                ArenaVector<Expr::Tuple::Element> elements;
                 bool is_tuple = false;
 
                 tokens.allow<Token::NewLine>();
@@ -3456,7 +5182,7 @@ namespace str {
                         next_1 and next_1->is<Token::Identifier>() and
                         next_2 and next_2->is<Token::Colon>()
                     ) {
-                        std::string_view content = next_1->get<Token::Identifier>().content;
+                        std::string_view content = tokens.get<Token::Identifier>(*next_1).content;
 
                         // Disambiguate labels from subtype expressions with this hack.
                         // In the enforced Strawberry style types always start with an upper case character,
@@ -3498,7 +5224,7 @@ namespace str {
             }
 
             if (tokens.match<Token::Pipe>()) {
-                std::vector<Expr::Closure::Argument> arguments;
+                ArenaVector<Expr::Closure::Argument> arguments;
 
                 if (not tokens.peek_match<Token::Pipe>()) {
                     do {
@@ -3515,7 +5241,7 @@ namespace str {
 
                 tokens.expect<Token::Pipe>();
 
-                std::optional<std::vector<Expr::Closure::Capture>> captures;
+                std::optional<ArenaVector<Expr::Closure::Capture>> captures;
                 if (tokens.match<Token::Colon>()) {
                     tokens.expect<Token::BracketLeft>();
                     captures.emplace();
@@ -3538,7 +5264,7 @@ namespace str {
 
                 bool async = (bool) tokens.match<Token::Identifier>("async");
 
-                std::optional<std::vector<Expr::ExprBox>> throws;
+                std::optional<ArenaVector<Expr::ExprBox>> throws;
                 if (tokens.match<Token::Identifier>("throws")) {
                     throws.emplace();
 
@@ -3570,7 +5296,7 @@ namespace str {
             // Annotates an expression with one or more annotations.
             // type Foo = @Convention("c") @!Bar ():[] -> ()
             if (tokens.match<Token::At>()) {
-                std::vector<Expr::Annotations::Annotation> annotations;
+                ArenaVector<Expr::Annotations::Annotation> annotations;
 
                 do {
                     bool unsafe = false;
@@ -3582,7 +5308,7 @@ namespace str {
                         identifier and identifier->trailing_whitespace
                     ) {
                         auto token = tokens.expect<Token::Identifier>();
-                        Expr annotation = Expr(token, Expr::Identifier(identifier->identifier_content().value()));
+                        Expr annotation = Expr(token, Expr::Identifier(tokens.identifier_symbol(*identifier).value()));
                         annotations.emplace_back(std::move(annotation), unsafe);
                     } else {
                         Expr annotation = parse_expr(tokens);
@@ -3621,7 +5347,7 @@ namespace str {
             }
 
             if (auto identifier = tokens.match_as<Token::Identifier>()) {
-                return Expr(span.take(), Expr::Identifier(identifier->content));
+                return Expr(span.take(), Expr::Identifier(identifier->symbol));
             }
 
             throw Diagnostic::error(tokens.fallthrough_provenance(), "expected expression");
@@ -3633,7 +5359,7 @@ namespace str {
                 if (tokens.finished()) break;
 
                 if (tokens.match<Token::ParenLeft>()) {
-                    std::vector<Expr::Call::Argument> arguments;
+                    ArenaVector<Expr::Call::Argument> arguments;
 
                     if (not tokens.peek_match<Token::ParenRight>()) {
                         do {
@@ -3661,7 +5387,7 @@ namespace str {
                     lhs = Expr(provenance, Expr::Call(std::move(lhs), std::move(arguments)));
                 } else if (tokens.match<Token::Dot>()) {
                     auto name_token = tokens.expect<Token::Identifier>();
-                    std::string_view name = name_token.get<Token::Identifier>().content;
+                    Symbol name = tokens.get<Token::Identifier>(name_token).symbol;
 
                     auto provenance = Provenance(lhs.provenance, Provenance(name_token));
 
@@ -3672,7 +5398,7 @@ namespace str {
                     tokens.expect<Token::Arrow>();
 
                     auto name_token = tokens.expect<Token::Identifier>();
-                    std::string_view name = name_token.get<Token::Identifier>().content;
+                    Symbol name = tokens.get<Token::Identifier>(name_token).symbol;
 
                     auto provenance = Provenance(lhs.provenance, Provenance(name_token));
 
@@ -3680,7 +5406,7 @@ namespace str {
                 } else if (tokens.match<Token::DoubleColon>()) {
                     auto name_token = tokens.expect<Token::Identifier>();
 
-                    std::string_view name = name_token.get<Token::Identifier>().content;
+                    Symbol name = tokens.get<Token::Identifier>(name_token).symbol;
 
                     auto provenance = Provenance(lhs.provenance, Provenance(name_token));
 
@@ -3692,7 +5418,7 @@ namespace str {
 
                     lhs = Expr(provenance, Expr::Subtype(std::move(lhs), std::move(rhs)));
                 } else if (tokens.match<Token::BracketLeft>()) {
-                    std::vector<Expr::Subscript::Argument> arguments;
+                    ArenaVector<Expr::Subscript::Argument> arguments;
 
                     if (not tokens.peek_match<Token::BracketRight>()) {
                         do {
@@ -3721,7 +5447,7 @@ namespace str {
                 } else if (tokens.match<Token::Identifier>("match")) {
                     tokens.expect<Token::BraceLeft>();
 
-                    std::vector<Expr::Match::Arm> arms;
+                    ArenaVector<Expr::Match::Arm> arms;
 
                     while (not tokens.match<Token::BraceRight>()) {
                         tokens.drop_while(&Token::is<Token::NewLine>);
@@ -3743,7 +5469,7 @@ namespace str {
                 } else if (tokens.match<Token::Identifier>("catch")) {
                     tokens.expect<Token::BraceLeft>();
 
-                    std::vector<Expr::Catch::Arm> arms;
+                    ArenaVector<Expr::Catch::Arm> arms;
 
                     while (not tokens.match<Token::BraceRight>()) {
                         tokens.drop_while(&Token::is<Token::NewLine>);
@@ -3769,7 +5495,7 @@ namespace str {
 
                     lhs = Expr(provenance, Expr::Catch(std::move(lhs), std::move(arms)));
                  } else if (tokens.match<Token::Symbolic>("<")) {
-                    std::vector<Expr::Generics::Parameter> parameters;
+                    ArenaVector<Expr::Generics::Parameter> parameters;
 
                     if (not tokens.peek_match<Token::Symbolic>(">")) {
                         do {
@@ -3824,7 +5550,7 @@ namespace str {
 
                     lhs = Expr(
                         provenance,
-                        Expr::Postfix(symbolic->get<Token::Symbolic>().content, std::move(lhs))
+                        Expr::Postfix(tokens.get<Token::Symbolic>(*symbolic).content, std::move(lhs))
                     );
                 } else {
                     break;
@@ -3852,14 +5578,11 @@ namespace str {
                 auto op = tokens.peek();
                 if (not op) break;
                 if (not op->is<Token::Identifier>() and not op->is<Token::Symbolic>()) break;
-                if (op->is<Token::Identifier>()) {
-                    auto content = op->identifier_content().value();
-                    if (content != "and" and content != "or") break;
-                }
-                if (((op->identifier_content() == excluded_ops) or ...)) break;
+                if (op->is<Token::Identifier>() and op->keyword() != Keyword::And and op->keyword() != Keyword::Or) break;
+                if (((tokens.identifier_content(*op) == excluded_ops) or ...)) break;
                 if (operator_role(*op) != OperatorRole::Infix) break;
 
-                usize prec = precedence(op->identifier_content().value());
+                usize prec = op->precedence;
                 if (prec < minimum_precedence) break;
 
                 tokens.drop();
@@ -3869,7 +5592,7 @@ namespace str {
                     Provenance provenance = Provenance(lhs.provenance, Provenance(*token));
                     lhs = Expr(
                         provenance,
-                        Expr::Fold(std::move(lhs), Expr::Fold::InfixConjunction(op->identifier_content().value()))
+                        Expr::Fold(std::move(lhs), Expr::Fold::InfixConjunction(tokens.identifier_content(*op).value()))
                     );
                     break;
                 }
@@ -3881,22 +5604,20 @@ namespace str {
                     std::holds_alternative<Provenance::Span>(lhs.provenance.data) and
                     std::holds_alternative<Provenance::Span>(rhs.provenance.data)
                 ) {
-                    auto lhs_span = std::get<Provenance::Span>(lhs.provenance.data);
-                    auto rhs_span = std::get<Provenance::Span>(rhs.provenance.data);
-                    provenance = Provenance(lhs_span.start, rhs_span.end);
+                    provenance = Provenance(lhs.provenance, rhs.provenance);
                 }
 
                 lhs = Expr(
                     provenance,
-                    Expr::Infix(op->identifier_content().value(), std::move(lhs), std::move(rhs))
+                    Expr::Infix(tokens.identifier_content(*op).value(), std::move(lhs), std::move(rhs))
                 );
             }
 
             return lhs;
         }
 
-        auto parse_generics(TokenStream& tokens) -> std::vector<Decl::GenericParameter> {
-            std::vector<Decl::GenericParameter> parameters;
+        auto parse_generics(TokenStream& tokens) -> ArenaVector<Decl::GenericParameter> {
+            ArenaVector<Decl::GenericParameter> parameters;
             tokens.expect<Token::Symbolic>("<");
 
             do {
@@ -3904,13 +5625,13 @@ namespace str {
 
                 if (tokens.match<Token::Identifier>("let")) {
                     std::optional<std::string_view> label;
-                    std::string_view name;
+                    Symbol name;
 
-                    std::string_view first = tokens.expect_as<Token::Identifier>().content;
+                    auto first = tokens.expect_as<Token::Identifier>();
                     if (auto second = tokens.match_as<Token::Identifier>()) {
-                        label = first; name = second->content;
+                        label = first.content; name = second->symbol;
                     } else {
-                        name = first;
+                        name = first.symbol;
                     }
 
                     tokens.expect<Token::Colon>();
@@ -3938,7 +5659,7 @@ namespace str {
                     }
 
                     if (tokens.match<Token::Tick>()) {
-                        std::string_view name = tokens.expect_as<Token::Identifier>().content;
+                        Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
                         parameters.push_back({
                             .kind = Decl::GenericParameter::Kind::Lifetime,
@@ -3950,7 +5671,7 @@ namespace str {
                     } else {
                         bool is_category = (bool) tokens.match<Token::Identifier>("category");
 
-                        std::string_view name = tokens.expect_as<Token::Identifier>().content;
+                        Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
                         std::optional<Expr> default_expr;
                         if (tokens.match<Token::Symbolic>("=")) default_expr = parse_expr(tokens, ">");
@@ -3978,12 +5699,12 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>(keyword);
 
-            std::string_view name = tokens.expect_as<Token::Identifier>().content;
+            Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
-            std::vector<Decl::GenericParameter> generics;
+            ArenaVector<Decl::GenericParameter> generics;
             if (tokens.peek_match_as<Token::Symbolic>("<")) generics = parse_generics(tokens);
 
-            std::vector<Expr> superlist;
+            ArenaVector<Expr> superlist;
             if (tokens.match<Token::Colon>()) {
                 do {
                     superlist.emplace_back(parse_expr(tokens));
@@ -3998,7 +5719,7 @@ namespace str {
                 tokens.allow<Token::NewLine>();
             }
 
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
 
             if (tokens.match<Token::BraceLeft>()) {
                 while (true) {
@@ -4027,7 +5748,7 @@ namespace str {
         auto parse_fun(TokenStream& tokens, bool is_deinit = false) -> Decl {
             auto span = tokens.span();
 
-            static constexpr auto token_name_transform = [] (auto token) { return token.content; };
+            static constexpr auto token_name_transform = [] (auto token) { return token.symbol; };
 
             std::optional<Decl::Fun::Operator> operator_spec;
             if (tokens.match<Token::Identifier>("prefix")) {
@@ -4064,12 +5785,12 @@ namespace str {
                 accessor = Decl::Fun::Accessor::None;
             }
 
-            std::optional<std::string_view> name = tokens.match_as<Token::Identifier>().transform(token_name_transform);
+            std::optional<Symbol> name = tokens.match_as<Token::Identifier>().transform(token_name_transform);
 
-            std::vector<Decl::GenericParameter> generics;
+            ArenaVector<Decl::GenericParameter> generics;
             if (tokens.peek_match_as<Token::Symbolic>("<")) generics = parse_generics(tokens);
 
-            std::vector<Decl::Argument> args;
+            ArenaVector<Decl::Argument> args;
             Decl::Fun::SelfArgument self;
 
             tokens.expect<Token::ParenLeft>();
@@ -4111,13 +5832,13 @@ namespace str {
                     if (tokens.peek_match<Token::ParenRight>()) break;
 
                     std::optional<std::string_view> label;
-                    std::string_view name;
+                    Symbol name;
 
-                    std::string_view first = tokens.expect_as<Token::Identifier>().content;
+                    auto first = tokens.expect_as<Token::Identifier>();
                     if (auto second = tokens.match_as<Token::Identifier>()) {
-                        label = first; name = second->content;
+                        label = first.content; name = second->symbol;
                     } else {
-                        name = first;
+                        name = first.symbol;
                     }
 
                     tokens.expect<Token::Colon>();
@@ -4165,7 +5886,7 @@ namespace str {
             tokens.allow<Token::NewLine>();
             tokens.expect<Token::ParenRight>();
 
-            std::vector<Expr> throws;
+            ArenaVector<Expr> throws;
             if (tokens.match<Token::Identifier>("throws")) {
                 do {
                     throws.emplace_back(parse_expr(tokens));
@@ -4198,8 +5919,8 @@ namespace str {
             std::optional<Expr> where;
             if (tokens.match<Token::Identifier>("where")) where = parse_expr(tokens);
 
-            std::optional<Expr> body;
-            if (tokens.peek_match<Token::BraceLeft>()) body = parse_block_expr(tokens);
+            std::optional<Decl::Body> body;
+            if (tokens.peek_match<Token::BraceLeft>()) body = parse_body(tokens);
 
             return Decl(
                 span.take(),
@@ -4224,10 +5945,10 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>("init");
 
-            std::vector<Decl::GenericParameter> generics;
+            ArenaVector<Decl::GenericParameter> generics;
             if (tokens.peek_match_as<Token::Symbolic>("<")) generics = parse_generics(tokens);
 
-            std::vector<Decl::Argument> args;
+            ArenaVector<Decl::Argument> args;
             if (tokens.match<Token::ParenLeft>()) {
                 if (not tokens.peek_match<Token::ParenRight>()) {
                     do {
@@ -4235,13 +5956,13 @@ namespace str {
                         if (tokens.peek_match<Token::ParenRight>()) break;
 
                         std::optional<std::string_view> label;
-                        std::string_view name;
+                        Symbol name;
 
-                        std::string_view first = tokens.expect_as<Token::Identifier>().content;
+                        auto first = tokens.expect_as<Token::Identifier>();
                         if (auto second = tokens.match_as<Token::Identifier>()) {
-                            label = first; name = second->content;
+                            label = first.content; name = second->symbol;
                         } else {
-                            name = first;
+                            name = first.symbol;
                         }
 
                         tokens.expect<Token::Colon>();
@@ -4289,13 +6010,13 @@ namespace str {
                 tokens.allow<Token::NewLine>();
                 tokens.expect<Token::ParenRight>();
 
-                std::vector<std::string_view> lifetimes;
+                ArenaVector<std::string_view> lifetimes;
 
                 while (tokens.match<Token::Tick>()) {
                     lifetimes.emplace_back(tokens.expect_as<Token::Identifier>().content);
                 }
 
-                std::vector<Expr> throws;
+                ArenaVector<Expr> throws;
                 if (tokens.match<Token::Identifier>("throws")) {
                     do {
                         throws.emplace_back(parse_expr(tokens));
@@ -4307,8 +6028,8 @@ namespace str {
                 std::optional<Expr> where;
                 if (tokens.match<Token::Identifier>("where")) where = parse_expr(tokens);
 
-                std::optional<Expr> body;
-                if (tokens.peek_match<Token::BraceLeft>()) body = parse_block_expr(tokens);
+                std::optional<Decl::Body> body;
+                if (tokens.peek_match<Token::BraceLeft>()) body = parse_body(tokens);
 
                 return Decl(
                     span.take(),
@@ -4323,7 +6044,7 @@ namespace str {
                     }
                 );
             } else {
-                Expr body = parse_block_expr(tokens);
+                Decl::Body body = parse_body(tokens);
 
                 return Decl(
                     span.take(),
@@ -4338,12 +6059,12 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>("deinit");
 
-            Expr expr = parse_block_expr(tokens);
+            Decl::Body body = parse_body(tokens);
 
             return Decl(
                 span.take(),
                 Decl::Deinit {
-                    .body = std::move(expr)
+                    .body = std::move(body)
                 }
             );
         }
@@ -4356,12 +6077,12 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>("enum");
 
-            std::string_view name = tokens.expect_as<Token::Identifier>().content;
+            Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
-            std::vector<Decl::GenericParameter> generics;
+            ArenaVector<Decl::GenericParameter> generics;
             if (tokens.peek_match_as<Token::Symbolic>("<")) generics = parse_generics(tokens);
 
-            std::vector<Expr> superlist;
+            ArenaVector<Expr> superlist;
             if (tokens.match<Token::Colon>()) {
                 do {
                     superlist.emplace_back(parse_expr(tokens));
@@ -4371,8 +6092,8 @@ namespace str {
             std::optional<Expr> where;
             if (tokens.match<Token::Identifier>("where")) where = parse_expr(tokens);
 
-            std::vector<Decl> decls;
-            std::vector<Decl::Enum::Case> cases;
+            ArenaVector<Decl> decls;
+            ArenaVector<Decl::Enum::Case> cases;
 
             if (tokens.match<Token::BraceLeft>()) {
                 while (true) {
@@ -4389,7 +6110,7 @@ namespace str {
 
                     if (is_case) {
                         do {
-                            std::string_view case_name = tokens.expect_as<Token::Identifier>().content;
+                            Symbol case_name = tokens.expect_as<Token::Identifier>().symbol;
 
                             std::optional<Expr> tuple_expr;
                             if (tokens.peek_match<Token::ParenLeft>()) tuple_expr = parse_expr(tokens, "=");
@@ -4429,11 +6150,11 @@ namespace str {
         }
 
         auto parse_category(TokenStream& tokens) -> Decl {
-            if (auto token = tokens.peek(3); token and token->identifier_content() == "=") {
+            if (auto token = tokens.peek(3); token and tokens.identifier_content(*token) == "=") {
                 auto span = tokens.span();
                 tokens.expect<Token::Identifier>("category");
 
-                std::string_view name = tokens.expect_as<Token::Identifier>().content;
+                Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
                 tokens.expect<Token::Symbolic>("=");
 
@@ -4457,10 +6178,10 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>("extend");
 
-            Path path = tokens.expect_as<Token::Identifier>().content;
-            while (tokens.match<Token::Dot>()) path += tokens.expect_as<Token::Identifier>().content;
+            Path path = tokens.expect_as<Token::Identifier>().symbol;
+            while (tokens.match<Token::Dot>()) path += tokens.expect_as<Token::Identifier>().symbol;
 
-            std::vector<Expr> superlist;
+            ArenaVector<Expr> superlist;
             if (tokens.match<Token::Colon>()) {
                 do {
                     superlist.emplace_back(parse_expr(tokens));
@@ -4470,7 +6191,7 @@ namespace str {
             std::optional<Expr> where;
             if (tokens.match<Token::Identifier>("where")) where = parse_expr(tokens);
 
-            std::vector<Decl> decls;
+            ArenaVector<Decl> decls;
 
             if (tokens.match<Token::BraceLeft>()) {
                 while (true) {
@@ -4500,7 +6221,7 @@ namespace str {
             auto span = tokens.span();
             tokens.expect<Token::Identifier>("type");
 
-            std::string_view name = tokens.expect_as<Token::Identifier>().content;
+            Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
             tokens.expect<Token::Symbolic>("=");
 
@@ -4531,7 +6252,7 @@ namespace str {
             tokens.expect<Token::Identifier>("type");
             tokens.expect<Token::Identifier>("operator");
 
-            std::string_view name = tokens.expect_as<Token::Symbolic>().content;
+            Symbol name = tokens.expect_as<Token::Symbolic>().symbol;
 
             tokens.expect<Token::Symbolic>("=");
 
@@ -4582,7 +6303,7 @@ namespace str {
             std::optional<std::string_view> lifetime;
             if (tokens.match<Token::Tick>()) lifetime = tokens.expect_as<Token::Identifier>().content;
 
-            std::string_view name = tokens.expect_as<Token::Identifier>().content;
+            Symbol name = tokens.expect_as<Token::Identifier>().symbol;
 
             std::optional<Expr> type_expr;
             if (tokens.match<Token::Colon>()) type_expr = parse_expr(tokens, "=");
@@ -4618,11 +6339,11 @@ namespace str {
             tokens.expect<Token::Identifier>("import");
 
             // Base path.
-            Path path = tokens.expect_as<Token::Identifier>().content;
+            Path path = tokens.expect_as<Token::Identifier>().symbol;
 
             // Submodule path.
             while (tokens.match<Token::Dot>()) {
-                path += tokens.expect_as<Token::Identifier>().content;
+                path += tokens.expect_as<Token::Identifier>().symbol;
             }
 
             // Required newline.
@@ -4635,160 +6356,602 @@ namespace str {
         }
 
         auto parse_decl(TokenStream& tokens) -> Decl {
-            std::vector<std::string_view> docs;
+            ArenaVector<std::string_view> docs;
 
             while (auto doc = tokens.match_as<Token::Comment>([] (auto comment) { return comment.selector == "/"; })) {
                 docs.push_back(doc->content);
                 tokens.expect<Token::NewLine>();
             }
 
-            std::optional<std::string> documentation;
+            std::optional<ArenaString> documentation;
             if (not docs.empty()) documentation = docs
                 | std::views::join_with('\n')
-                | std::ranges::to<std::string>();
+                | std::ranges::to<ArenaString>();
 
-            std::vector<Decl::AnnotationAttachment> annotations;
+            ArenaVector<Decl::AnnotationAttachment> annotations;
 
             while (tokens.match<Token::At>()) {
                 bool unsafe = false;
                 if (tokens.match<Token::Symbolic>("!")) unsafe = true;
 
-                Expr expr = parse_expr(tokens);
-                annotations.emplace_back(std::move(expr), unsafe);
-                tokens.expect<Token::NewLine>();
+                Expr expr = parse_expr(tokens);
+                annotations.emplace_back(std::move(expr), unsafe);
+                tokens.expect<Token::NewLine>();
+            }
+
+            Decl::Visibility mod_visibility;
+            if (tokens.match<Token::Identifier>("pub")) {
+                if (tokens.match<Token::ParenLeft>()) {
+                    auto token = tokens.expect<Token::Identifier>();
+                    std::string_view mode = tokens.get<Token::Identifier>(token).content;
+
+                    if      (mode == "get") mod_visibility = Decl::Visibility::PubGet;
+                    else if (mode == "set") mod_visibility = Decl::Visibility::PubSet;
+                    else throw Diagnostic::error(token,
+                        "visibility can only be refined to `get` or `set`"
+                    );
+
+                    tokens.expect<Token::ParenRight>();
+                } else {
+                    mod_visibility = Decl::Visibility::Pub;
+                }
+            }
+
+            bool mod_unsafe   = (bool) tokens.match<Token::Identifier>("unsafe");
+            bool mod_open     = (bool) tokens.match<Token::Identifier>("open");
+            bool mod_override = (bool) tokens.match<Token::Identifier>("override");
+            bool mod_inherent = (bool) tokens.match<Token::Identifier>("inherent");
+            bool mod_const    = (bool) tokens.match<Token::Identifier>("const");
+            bool mod_static   = (bool) tokens.match<Token::Identifier>("static");
+            bool mod_inline   = (bool) tokens.match<Token::Identifier>("inline");
+            bool mod_implicit = (bool) tokens.match<Token::Identifier>("implicit");
+            bool mod_final    = (bool) tokens.match<Token::Identifier>("final");
+            bool mod_base     = (bool) tokens.match<Token::Identifier>("base");
+
+            Keyword next = tokens.peek_expect<Token::Identifier>().keyword();
+            bool immediate_brace = false;
+            bool immediate_type = false;
+            if (auto token = tokens.peek(2); token and token->is<Token::BraceLeft>()) immediate_brace = true;
+            if (auto token = tokens.peek(2); token and token->keyword() == Keyword::Type) immediate_type = true;
+
+            std::optional<Decl> decl;
+            switch (next) {
+                case Keyword::Prefix:
+                case Keyword::Postfix:
+                    decl = immediate_type ? parse_type_operator(tokens) : parse_fun(tokens);
+                    break;
+                case Keyword::Deinit:
+                    decl = immediate_brace ? parse_deinit(tokens) : parse_fun(tokens);
+                    break;
+                case Keyword::Fun:
+                case Keyword::Infix:
+                case Keyword::Get:
+                case Keyword::Set:
+                case Keyword::Mut:        decl = parse_fun(tokens);        break;
+                case Keyword::Init:       decl = parse_init(tokens);       break;
+                case Keyword::Struct:     decl = parse_struct(tokens);     break;
+                case Keyword::Enum:       decl = parse_enum(tokens);       break;
+                case Keyword::Category:   decl = parse_category(tokens);   break;
+                case Keyword::Extend:     decl = parse_extend(tokens);     break;
+                case Keyword::Type:       decl = parse_type(tokens);       break;
+                case Keyword::Class:      decl = parse_class(tokens);      break;
+                case Keyword::Let:        decl = parse_member(tokens);     break;
+                case Keyword::Object:     decl = parse_object(tokens);     break;
+                case Keyword::Annotation: decl = parse_annotation(tokens); break;
+                case Keyword::Import:     decl = parse_import(tokens);     break;
+                case Keyword::Decay:      decl = parse_decay(tokens);      break;
+                default: throw Diagnostic::error(tokens.fallthrough_provenance(), "invalid declaration");
+            }
+
+            decl->documentation = std::move(documentation);
+            decl->annotations = std::move(annotations);
+            decl->mod_visibility = mod_visibility;
+            decl->mod_unsafe = mod_unsafe;
+            decl->mod_open = mod_open;
+            decl->mod_override = mod_override;
+            decl->mod_inherent = mod_inherent;
+            decl->mod_const = mod_const;
+            decl->mod_static = mod_static;
+            decl->mod_inline = mod_inline;
+            decl->mod_implicit = mod_implicit;
+            decl->mod_final = mod_final;
+            decl->mod_base = mod_base;
+
+            return std::move(decl.value());
+        }
+    };
+
+    /// Names a declaration for traces, as its kind followed by its name if it has one.
+    inline auto describe(Decl const& decl) -> std::string {
+        return std::visit([] <typename T> (T const& data) -> std::string {
+            std::string kind(std::meta::identifier_of(^^T));
+
+            if constexpr (requires { data.name; }) {
+                if constexpr (std::same_as<decltype(data.name), std::optional<Symbol>>) {
+                    return data.name ? std::format("{} {}", kind, *data.name) : kind;
+                } else {
+                    return std::format("{} {}", kind, data.name);
+                }
+            } else if constexpr (requires { data.target_path; }) {
+                return std::format("{} {}", kind, std::string(data.target_path));
+            } else if constexpr (requires { data.path; }) {
+                return std::format("{} {}", kind, std::string(data.path));
+            } else {
+                return kind;
+            }
+        }, decl.data);
+    }
+
+    inline auto parse(TokenStream& tokens, bool lazy_bodies = false) -> Ast {
+        auto arena = std::make_unique<Arena>();
+        ArenaScope scope(*arena);
+
+        Parser parser { .lazy_bodies = lazy_bodies };
+
+        ArenaVector<Decl> decls;
+        Path module = parser.parse_module_header(tokens);
+
+        while (not tokens.finished()) {
+            tokens.drop_while(&Token::is<Token::NewLine>);
+            if (tokens.finished()) break;
+
+            trace::Scope trace_scope("declaration");
+            decls.emplace_back(parser.parse_decl(tokens));
+            trace_scope.describe([&] { return describe(decls.back()); });
+        }
+
+        return Ast(std::move(arena), std::move(decls), std::move(module), tokens.get_source());
+    }
+
+    inline auto Decl::Body::get() const -> Expr const& {
+        if (auto expr = std::get_if<Expr>(&data)) return *expr;
+
+        auto& deferred = *std::get<Box<Deferred>>(data);
+        if (Expr* expr = deferred.expr.load(std::memory_order_acquire)) return *expr;
+
+        std::lock_guard lock(deferred.arena->get_mutex());
+        if (Expr* expr = deferred.expr.load(std::memory_order_relaxed)) return *expr;
+
+        ArenaScope scope(*deferred.arena);
+        auto tokens = TokenStream::replay(deferred.text, deferred.source, deferred.id, deferred.tokens);
+
+        // Released into the arena, which reclaims it along with the rest of the tree.
+        Expr* expr = make_box<Expr>(Parser().parse_block_expr(tokens)).release();
+        deferred.expr.store(expr, std::memory_order_release);
+
+        return *expr;
+    }
+}
+
+namespace str {
+    /// Hardcoded search paths for the bootstrap compiler.
+    static constexpr auto MODULE_PATHS = std::to_array<std::string_view>({
+        "modules", "src"
+    });
+
+    /// Hardcoded automatic imports for the bootstrap compiler.
+    static constexpr auto AUTO_IMPORTS = std::to_array<std::string_view>({
+        "core"
+    });
+
+    /// Hardcoded directory of the entry module for the bootstrap compiler.
+    static constexpr std::string_view ENTRY_PATH = "src";
+
+    /// Hardcoded directory of the parse cache for the bootstrap compiler.
+    static constexpr std::string_view CACHE_PATH = ".strc-cache";
+
+    /// Hardcoded path of the socket the watch daemon serves builds on.
+    static constexpr std::string_view WATCH_SOCKET_PATH = ".strc-watch.sock";
+}
+
+namespace str::stats {
+    inline Counter cache_hits { "cache.hits" };
+    inline Counter cache_misses { "cache.misses" };
+}
+
+namespace str::cache {
+    /// Bumped whenever the layout of cached trees changes in a way the build id would not catch.
+    static constexpr u64 FORMAT_VERSION = 3;
+
+    /// A fast non-cryptographic hash reading eight bytes at a time, good enough to key a cache by file contents.
+    inline auto hash_bytes(std::string_view bytes, u64 seed = 0) -> u64 {
+        auto mix = [] (u64 value) {
+            value ^= value >> 32;
+            value *= 0xd6e8feb86659fd93;
+            value ^= value >> 32;
+            value *= 0xd6e8feb86659fd93;
+            value ^= value >> 32;
+            return value;
+        };
+
+        u64 hash = mix(seed ^ (bytes.size() * 0x9e3779b97f4a7c15));
+        usize i = 0;
+
+        for (; i + 8 <= bytes.size(); i += 8) {
+            u64 word;
+            std::memcpy(&word, bytes.data() + i, 8);
+            hash = mix(hash ^ word) + 0x9e3779b97f4a7c15;
+        }
+
+        u64 tail = 0;
+        if (i < bytes.size()) std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+
+        return mix(hash ^ tail);
+    }
+
+    /// Identifies the compiler build that writes and reads cache entries, by hashing the running binary once.
+    ///
+    /// If the binary can't be read the id is random, so the process never reads entries it did not write.
+    inline auto build_id() -> u64 {
+        static u64 id = [] {
+            auto random = [] {
+                std::random_device device;
+                return u64(device()) << 32 | device();
+            };
+
+            std::FILE* file = std::fopen("/proc/self/exe", "rb");
+            if (not file) return random();
+
+            ScopeExit scope_exit = [file] { std::fclose(file); };
+
+            u64 hash = FORMAT_VERSION;
+            std::string chunk(usize(1) << 20, '\0');
+
+            while (usize count = std::fread(chunk.data(), 1, chunk.size(), file)) {
+                hash = hash_bytes(std::string_view(chunk).substr(0, count), hash);
+            }
+
+            return std::ferror(file) ? random() : hash;
+        }();
+
+        return id;
+    }
+
+    namespace detail {
+        template <typename T> constexpr bool is_box_v = false;
+        template <typename T> constexpr bool is_box_v<Box<T>> = true;
+
+        /// The types whose representation in cache entries differs from the generic binary coding.
+        template <typename T> concept Hooked =
+            std::same_as<T, std::string_view> or
+            std::same_as<T, Symbol> or
+            std::same_as<T, Path> or
+            std::same_as<T, Provenance> or
+            std::same_as<T, Expr> or
+            std::same_as<T, Decl> or
+            std::same_as<T, Decl::Body> or
+            is_box_v<T>;
+    }
+
+    /// Adapts the binary coding to syntax trees of a single source unit.
+    ///
+    /// Views into the source text are stored as offsets so they can be rebased onto the text when loaded,
+    /// and symbols are spelled out once per entry and referenced by index afterwards, since their ids only
+    /// mean something within one process. Provenance is rebased onto the source unit being loaded, which has
+    /// the same text as the one the entry was written for, but not necessarily the same path or id.
+    /// Deferred bodies are stored as their tokens, so they stay deferred once loaded.
+    /// Boxes are allocated from the arena of the current thread.
+    class Hooks final {
+        std::string_view text;
+        std::string_view path;
+        u16 source;
+        std::unordered_map<u32, u32> indices;
+        std::vector<Symbol> symbols;
+
+      public:
+        explicit Hooks(SourceUnit const& source_unit)
+            : text(source_unit.text), path(source_unit.source), source(source_unit.id) {}
+
+        template <detail::Hooked T> void encode(coding::Binary& binary, std::string& out, T const& value) {
+            if constexpr (std::same_as<T, std::string_view>) {
+                auto begin = reinterpret_cast<usize>(value.data());
+                auto base = reinterpret_cast<usize>(text.data());
+
+                if (begin >= base and begin + value.size() <= base + text.size()) {
+                    binary.encode_varint(out, 0);
+                    binary.encode_varint(out, begin - base);
+                    binary.encode_varint(out, value.size());
+                } else {
+                    binary.encode_varint(out, 1);
+                    binary.encode_bytes(out, value);
+                }
+            } else if constexpr (std::same_as<T, Symbol>) {
+                auto [it, inserted] = indices.emplace(value.get_id(), u32(indices.size()));
+
+                if (inserted) {
+                    binary.encode_varint(out, 0);
+                    binary.encode_bytes(out, value.spelling());
+                } else {
+                    binary.encode_varint(out, u64(it->second) + 1);
+                }
+            } else if constexpr (std::same_as<T, Path>) {
+                binary.encode_varint(out, value.split().size());
+                for (auto component : value.split()) encode(binary, out, component);
+            } else if constexpr (std::same_as<T, Provenance>) {
+                std::visit(overloaded {
+                    [&] (Provenance::Span const& span) {
+                        binary.encode_varint(out, 0);
+                        binary.encode_varint(out, span.begin);
+                        binary.encode_varint(out, span.end);
+                    },
+                    [&] (Provenance::Source const&) {
+                        binary.encode_varint(out, 1);
+                    }
+                }, value.data);
+            } else if constexpr (std::same_as<T, Expr>) {
+                encode(binary, out, value.provenance);
+                binary.encode_into(out, value.data, *this);
+            } else if constexpr (std::same_as<T, Decl>) {
+                constexpr auto members = coding::detail::reflected_members<Decl>();
+                template for (constexpr auto member : members) {
+                    binary.encode_into(out, value.[:member:], *this);
+                }
+            } else if constexpr (std::same_as<T, Decl::Body>) {
+                if (auto deferred = value.get_deferred()) {
+                    binary.encode_varint(out, 1);
+                    binary.encode_varint(out, deferred->tokens.size());
+
+                    for (Token const& token : deferred->tokens) {
+                        binary.encode_varint(out, u64(token.kind));
+                        binary.encode_varint(out, u64(token.leading_whitespace) | u64(token.trailing_whitespace) << 1);
+                        binary.encode_varint(out, token.offset);
+                        binary.encode_varint(out, token.length);
+                    }
+                } else {
+                    binary.encode_varint(out, 0);
+                    encode(binary, out, value.get());
+                }
+            } else {
+                binary.encode_into(out, *value, *this);
+            }
+        }
+
+        template <detail::Hooked T> auto decode(coding::Binary& binary, std::string_view& in, std::type_identity<T>) -> T {
+            using Error = coding::Binary::Error;
+
+            if constexpr (std::same_as<T, std::string_view>) {
+                if (binary.decode_varint(in) == 0) {
+                    u64 offset = binary.decode_varint(in);
+                    u64 size = binary.decode_varint(in);
+                    if (offset > text.size() or size > text.size() - offset) throw Error("view out of range");
+                    return text.substr(offset, size);
+                } else {
+                    // Views that did not point into the text are kept alive by the interner.
+                    return Symbol(binary.decode_bytes(in)).spelling();
+                }
+            } else if constexpr (std::same_as<T, Symbol>) {
+                u64 index = binary.decode_varint(in);
+
+                if (index == 0) {
+                    return symbols.emplace_back(binary.decode_bytes(in));
+                } else if (index <= symbols.size()) {
+                    return symbols[index - 1];
+                } else {
+                    throw Error("symbol out of range");
+                }
+            } else if constexpr (std::same_as<T, Path>) {
+                u64 count = binary.decode_varint(in);
+                if (count == 0) throw Error("empty path");
+
+                Path path = decode(binary, in, std::type_identity<Symbol>());
+                for (u64 i = 1; i < count; i += 1) path += decode(binary, in, std::type_identity<Symbol>());
+                return path;
+            } else if constexpr (std::same_as<T, Provenance>) {
+                if (binary.decode_varint(in) == 0) {
+                    u32 begin = binary.decode_from<u32>(in, *this);
+                    u32 end = binary.decode_from<u32>(in, *this);
+                    if (begin > end or end > text.size()) throw Error("span out of range");
+                    return Provenance::Span { source, begin, end };
+                } else {
+                    return Provenance(source);
+                }
+            } else if constexpr (std::same_as<T, Expr>) {
+                auto provenance = decode(binary, in, std::type_identity<Provenance>());
+                return Expr(provenance, binary.decode_from<Expr::Data>(in, *this));
+            } else if constexpr (std::same_as<T, Decl>) {
+                // Declarations are built from their data and provenance, the modifiers are assigned afterwards.
+                auto data = binary.decode_from<Decl::Data>(in, *this);
+                Decl decl(decode(binary, in, std::type_identity<Provenance>()), std::move(data));
+
+                constexpr auto members = coding::detail::reflected_members<Decl>();
+                template for (constexpr auto member : members) {
+                    if constexpr (member != ^^Decl::data and member != ^^Decl::provenance) {
+                        decl.[:member:] = binary.decode_from<std::remove_cvref_t<decltype(decl.[:member:])>>(in, *this);
+                    }
+                }
+
+                return decl;
+            } else if constexpr (std::same_as<T, Decl::Body>) {
+                if (binary.decode_varint(in) == 0) return Decl::Body(decode(binary, in, std::type_identity<Expr>()));
+
+                u64 count = binary.decode_varint(in);
+                if (count == 0 or count > in.size()) throw Error("deferred body out of range");
+
+                std::vector<Token> tokens;
+                tokens.reserve(count);
+
+                for (u64 i = 0; i < count; i += 1) {
+                    u64 kind = binary.decode_varint(in);
+                    u64 whitespace = binary.decode_varint(in);
+                    u64 offset = binary.decode_varint(in);
+                    u64 length = binary.decode_varint(in);
+
+                    if (kind > u64(Token::Kind::Symbolic) or whitespace > 3) throw Error("invalid token");
+                    if (offset > text.size() or length > text.size() - offset) throw Error("token out of range");
+
+                    // Symbols, precedences and dots are recovered from the text the same way the lexer does it.
+                    u32 symbol = 0;
+                    bool dotted = false;
+                    u8 precedence = GENERIC_PRECEDENCE;
+
+                    if (Token::Kind(kind) == Token::Kind::Identifier or Token::Kind(kind) == Token::Kind::Symbolic) {
+                        auto spelling = text.substr(offset, length);
+
+                        if (u32 builtin = builtin::find(spelling)) {
+                            symbol = builtin;
+                            precedence = builtin::precedences[builtin];
+                        } else {
+                            symbol = interner().intern(spelling);
+                        }
+
+                        dotted = Token::Kind(kind) == Token::Kind::Symbolic and spelling.contains('.');
+                    }
+
+                    tokens.push_back(Token(
+                        Token::Kind(kind), source, u32(offset), u32(length), symbol,
+                        whitespace & 1, whitespace >> 1, dotted, precedence
+                    ));
+                }
+
+                if (not tokens.front().is<Token::BraceLeft>() or not tokens.back().is<Token::BraceRight>()) {
+                    throw Error("unbalanced deferred body");
+                }
+
+                return Decl::Body(make_box<Decl::Body::Deferred>(text, path, source, tokens, current_arena));
+            } else {
+                using Element = typename T::element_type;
+                return make_box<Element>(binary.decode_from<Element>(in, *this));
+            }
+        }
+    };
+
+    /// An on-disk cache of parsed source units, keyed by a hash of their text.
+    ///
+    /// Trees parsed with deferred bodies are keyed apart from eagerly parsed ones, so each mode
+    /// loads exactly the trees it would have parsed itself.
+    /// Entries live in a directory named after the build id, so a rebuilt compiler never reads entries
+    /// written by another build. Opening the cache touches its directory, and removes the directories of
+    /// other builds that nothing opened for a week, since builds running side by side share the root.
+    /// Entries are written to a temporary file and renamed into place, so readers see a whole entry or none.
+    /// Anything unexpected while loading an entry counts as a miss.
+    class ParseCache final {
+        static constexpr std::string_view magic = "STRC";
+        static constexpr auto stale_after = std::chrono::days(7);
+
+        std::filesystem::path directory;
+        bool lazy_bodies;
+        std::atomic<usize> hits = 0;
+        std::atomic<usize> misses = 0;
+
+        auto entry_path(u64 hash) const -> std::filesystem::path {
+            return directory / std::format("{:016x}", hash);
+        }
+
+        auto key(SourceUnit const& source_unit) const -> u64 {
+            return hash_bytes(source_unit.text, lazy_bodies);
+        }
+
+      public:
+        explicit ParseCache(std::filesystem::path const& root, bool lazy_bodies = false)
+            : directory(root / std::format("{:016x}", build_id())), lazy_bodies(lazy_bodies)
+        {
+            std::error_code error_code;
+            std::filesystem::create_directories(directory, error_code);
+
+            auto now = std::filesystem::file_time_type::clock::now();
+            std::filesystem::last_write_time(directory, now, error_code);
+
+            for (auto const& entry : std::filesystem::directory_iterator(root, error_code)) {
+                if (not entry.is_directory() or entry.path() == directory) continue;
+
+                auto modified = entry.last_write_time(error_code);
+                if (not error_code and now - modified > stale_after) std::filesystem::remove_all(entry.path(), error_code);
             }
+        }
 
-            Decl::Visibility mod_visibility;
-            if (tokens.match<Token::Identifier>("pub")) {
-                if (tokens.match<Token::ParenLeft>()) {
-                    auto token = tokens.expect<Token::Identifier>();
-                    std::string_view mode = token.get<Token::Identifier>().content;
+        /// Answers the cached tree of a source unit, or nothing if there is no usable entry.
+        auto load(SourceUnit const& source_unit) -> std::optional<Ast> {
+            u64 hash = key(source_unit);
 
-                    if      (mode == "get") mod_visibility = Decl::Visibility::PubGet;
-                    else if (mode == "set") mod_visibility = Decl::Visibility::PubSet;
-                    else throw Diagnostic::error(token,
-                        "visibility can only be refined to `get` or `set`"
-                    );
+            std::string content;
+            if (std::FILE* file = std::fopen(entry_path(hash).c_str(), "rb")) {
+                ScopeExit scope_exit = [file] { std::fclose(file); };
 
-                    tokens.expect<Token::ParenRight>();
-                } else {
-                    mod_visibility = Decl::Visibility::Pub;
+                // An entry whose size can't be told is left empty, which misses below.
+                long size = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+
+                if (size > 0) {
+                    content.resize(usize(size));
+                    std::rewind(file);
+
+                    if (std::fread(content.data(), 1, content.size(), file) != content.size()) content.clear();
                 }
             }
 
-            bool mod_unsafe   = (bool) tokens.match<Token::Identifier>("unsafe");
-            bool mod_open     = (bool) tokens.match<Token::Identifier>("open");
-            bool mod_override = (bool) tokens.match<Token::Identifier>("override");
-            bool mod_inherent = (bool) tokens.match<Token::Identifier>("inherent");
-            bool mod_const    = (bool) tokens.match<Token::Identifier>("const");
-            bool mod_static   = (bool) tokens.match<Token::Identifier>("static");
-            bool mod_inline   = (bool) tokens.match<Token::Identifier>("inline");
-            bool mod_implicit = (bool) tokens.match<Token::Identifier>("implicit");
-            bool mod_final    = (bool) tokens.match<Token::Identifier>("final");
-            bool mod_base     = (bool) tokens.match<Token::Identifier>("base");
+            coding::Binary binary;
+            Hooks hooks(source_unit);
+            std::string_view in = content;
 
-            std::string_view next = tokens.peek_expect_as<Token::Identifier>().content;
-            bool immediate_brace = false;
-            bool immediate_type = false;
-            if (auto token = tokens.peek(2); token and token->is<Token::BraceLeft>()) immediate_brace = true;
-            if (auto token = tokens.peek(2); token and token->identifier_content() == "type") immediate_type = true;
+            auto miss = [&] () -> std::optional<Ast> {
+                misses += 1;
+                stats::cache_misses.add();
+                return std::nullopt;
+            };
 
-            std::optional<Decl> decl;
-            if ((next == "prefix" or next == "postfix") and immediate_type) {
-                decl = parse_type_operator(tokens);
-            } else if (
-                (next == "deinit" and not immediate_brace) or
-                next == "fun" or
-                next == "infix" or
-                next == "prefix" or
-                next == "postfix" or
-                next == "get" or
-                next == "set" or
-                next == "mut"
-            ) {
-                decl = parse_fun(tokens);
-            } else if (next == "init") {
-                decl = parse_init(tokens);
-            } else if (next == "deinit") {
-                decl = parse_deinit(tokens);
-            } else if (next == "struct") {
-                decl = parse_struct(tokens);
-            } else if (next == "enum") {
-                decl = parse_enum(tokens);
-            } else if (next == "category") {
-                decl = parse_category(tokens);
-            } else if (next == "extend") {
-                decl = parse_extend(tokens);
-            } else if (next == "type") {
-                decl = parse_type(tokens);
-            } else if (next == "class") {
-                decl = parse_class(tokens);
-            } else if (next == "let") {
-                decl = parse_member(tokens);
-            } else if (next == "object") {
-                decl = parse_object(tokens);
-            } else if (next == "annotation") {
-                decl = parse_annotation(tokens);
-            } else if (next == "import") {
-                decl = parse_import(tokens);
-            } else if (next == "decay") {
-                decl = parse_decay(tokens);
-            } else {
-                throw Diagnostic::error(tokens.fallthrough_provenance(), "invalid declaration");
+            try {
+                if (not in.starts_with(magic)) return miss();
+                in.remove_prefix(magic.size());
+
+                if (binary.decode_from<u64>(in, hooks) != build_id()) return miss();
+                if (binary.decode_from<u64>(in, hooks) != hash) return miss();
+                if (binary.decode_from<u64>(in, hooks) != source_unit.text.size()) return miss();
+
+                auto arena = std::make_unique<Arena>();
+                ArenaScope scope(*arena);
+
+                auto module = binary.decode_from<Path>(in, hooks);
+                auto decls = binary.decode<ArenaVector<Decl>>(in, hooks);
+
+                hits += 1;
+                stats::cache_hits.add();
+                return Ast(std::move(arena), std::move(decls), std::move(module), source_unit.source);
+            } catch (coding::Binary::Error const&) {
+                return miss();
+            } catch (std::logic_error const&) {
+                return miss();
             }
+        }
 
-            decl->documentation = std::move(documentation);
-            decl->annotations = std::move(annotations);
-            decl->mod_visibility = mod_visibility;
-            decl->mod_unsafe = mod_unsafe;
-            decl->mod_open = mod_open;
-            decl->mod_override = mod_override;
-            decl->mod_inherent = mod_inherent;
-            decl->mod_const = mod_const;
-            decl->mod_static = mod_static;
-            decl->mod_inline = mod_inline;
-            decl->mod_implicit = mod_implicit;
-            decl->mod_final = mod_final;
-            decl->mod_base = mod_base;
+        /// Stores the tree of a source unit, along with the tokens of its deferred bodies.
+        void store(SourceUnit const& source_unit, Ast const& ast) {
+            u64 hash = key(source_unit);
 
-            return std::move(decl.value());
-        }
-    };
+            coding::Binary binary;
+            Hooks hooks(source_unit);
+            std::string content(magic);
 
-    inline auto parse(TokenStream& tokens) -> Ast {
-        Parser parser;
+            binary.encode_into(content, build_id(), hooks);
+            binary.encode_into(content, hash, hooks);
+            binary.encode_into(content, u64(source_unit.text.size()), hooks);
+            binary.encode_into(content, ast.module, hooks);
+            binary.encode_into(content, ast.get_decls(), hooks);
 
-        std::vector<Decl> decls;
-        Path module = parser.parse_module_header(tokens);
+            auto path = entry_path(hash);
+            auto temporary = path;
+            temporary += std::format(
+                ".{:x}.{:x}.tmp",
+                std::hash<std::thread::id>()(std::this_thread::get_id()),
+                std::chrono::steady_clock::now().time_since_epoch().count()
+            );
 
-        while (not tokens.finished()) {
-            tokens.drop_while(&Token::is<Token::NewLine>);
-            if (tokens.finished()) break;
-            decls.emplace_back(parser.parse_decl(tokens));
-        }
+            std::FILE* file = std::fopen(temporary.c_str(), "wb");
+            if (not file) return;
 
-        return Ast(std::move(decls), module, tokens.get_source());
-    }
-}
+            bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+            written = std::fclose(file) == 0 and written;
 
-namespace str {
-    /// Hardcoded search paths for the bootstrap compiler.
-    static constexpr auto MODULE_PATHS = std::to_array<std::string_view>({
-        "modules", "src"
-    });
+            std::error_code error_code;
+            if (written) std::filesystem::rename(temporary, path, error_code);
+            if (not written or error_code) std::filesystem::remove(temporary, error_code);
+        }
 
-    /// Hardcoded automatic imports for the bootstrap compiler.
-    static constexpr auto AUTO_IMPORTS = std::to_array<std::string_view>({
-        "core"
-    });
+        auto get_hits() const -> usize { return hits; }
+        auto get_misses() const -> usize { return misses; }
+    };
 }
 
 namespace str::raw {
-    /// Implementation of the `Integer` intrinsic type.
-    /// The bootstrap compiler should be fine maxing out at 64 bits.
-    struct Integer final {
-        i64 number;
-    };
+    // The `Integer` intrinsic type is unbounded, it is implemented in `integer.hpp`.
 
     /// Implementation of the `Int` intrinsic type.
     /// The bootstrap compiler should be fine maxing out at 64 bits.
@@ -4809,12 +6972,17 @@ namespace str::raw {
 }
 
 namespace str {
-    struct SourceUnit final {
-        std::string text;
-        std::string source;
-    };
-
-    using Modules = std::unordered_map<std::string, std::vector<Ast>>;
+    using Modules = std::unordered_map<Path, std::vector<Ast>, PathHash>;
+
+    namespace stats {
+        inline Counter memo_hits { "sir.memo.hits" };
+        inline Counter memo_misses { "sir.memo.misses" };
+        inline Counter memo_evictions { "sir.memo.evictions" };
+        inline Counter interned_types { "sir.types" };
+        inline Counter instantiations { "sir.instantiations" };
+        inline Counter instantiation_reuses { "sir.instantiations.reused" };
+        inline Histogram instantiation_ns { "sir.instantiation_ns" };
+    }
 
     /// The actual data structure we form from the Ast and operate on as we evaluate.
     /// It was named the Strawberry Intermediate Representation.
@@ -4824,13 +6992,13 @@ namespace str {
     class Sir final {
         Modules modules;
         std::vector<SourceUnit> source_units;
-        std::vector<std::string> auto_imports;
+        std::vector<Path> auto_imports;
         std::vector<Diagnostic> diagnostics;
 
         Sir(
             Modules modules,
             std::vector<SourceUnit> source_units,
-            std::vector<std::string> auto_imports
+            std::vector<Path> auto_imports
         ) : modules(std::move(modules))
           , source_units(std::move(source_units))
           , auto_imports(std::move(auto_imports))
@@ -4847,6 +7015,12 @@ namespace str {
             return source_units;
         }
 
+        /// Gives the modules back once the sir is no longer needed, so they can be kept resident
+        /// and evaluated again without parsing them anew.
+        auto release_modules() && -> Modules {
+            return std::move(modules);
+        }
+
         /// Answers true if the evaluation is erroneous, that is, if any diagnostics of error severity were raised.
         auto erroneous() const -> bool {
             for (auto const& diagnostic : diagnostics)
@@ -4854,58 +7028,804 @@ namespace str {
             return false;
         }
 
-        /// An exception used to propagate multiple diagnostics at once.
-        struct DiagnosticBundle final : std::exception {
-            std::vector<Diagnostic> diagnostics;
-            auto what() const noexcept -> char const* override { return "N/A"; }
+        /// An exception used to propagate multiple diagnostics at once.
+        struct DiagnosticBundle final : std::exception {
+            std::vector<Diagnostic> diagnostics;
+            auto what() const noexcept -> char const* override { return "N/A"; }
+
+            template <std::same_as<Diagnostic>... Diagnostic> DiagnosticBundle(Diagnostic... diagnostics)
+                : diagnostics({ diagnostics... }) {}
+        };
+
+        /// Identifies a type known to the evaluator.
+        using TypeId = u32;
+
+        class TermArena;
+
+        /// The evaluator domain type of either a Type, Value or Residual.
+        ///
+        /// Terms are 16 bytes and trivially copyable, so they are passed around by value. Scalars are stored
+        /// inline, apart from integers which outgrow 64 bits. Those and the elements of aggregates are kept
+        /// in a `TermArena` and only referred to by index, so evaluating constants doesn't allocate per value,
+        /// and everything goes away with the arena.
+        class Term final {
+          public:
+            enum class Kind : u8 {
+                /// The empty tuple.
+                Unit,
+                Boolean,
+                /// An `Integer` which fits in 64 bits, inline.
+                Integer,
+                /// An `Integer` which doesn't fit in 64 bits, by index.
+                BigInteger,
+                /// An `Int` of up to 64 bits, inline along with its size.
+                Int,
+                /// A type, by id.
+                Type,
+                /// An expression which could not be evaluated and is left for runtime.
+                Residual,
+                Tuple,
+                Struct,
+                /// An enum case with its payload, if any.
+                Enum,
+                List
+            };
+
+          private:
+            Kind kind = Kind::Unit;
+            /// The size of an `Int` in bits.
+            u8 size = 0;
+            /// The case of an enum.
+            u16 index = 0;
+            /// The element count of an aggregate.
+            u32 count = 0;
+            /// The inline value, the residual expression, or the first element of an aggregate in the low
+            /// half and its type in the high half.
+            u64 payload = 0;
+
+            constexpr Term(Kind kind, u64 payload) noexcept : kind(kind), payload(payload) {}
+
+            friend class TermArena;
+
+          public:
+            constexpr Term() noexcept = default;
+
+            static constexpr auto unit() noexcept -> Term { return Term(); }
+
+            static constexpr auto of(raw::Boolean boolean) noexcept -> Term {
+                return Term(Kind::Boolean, boolean.value);
+            }
+
+            /// Makes an integer term, integers which may not fit in 64 bits are made by `TermArena::integer`.
+            static constexpr auto of(i64 integer) noexcept -> Term {
+                return Term(Kind::Integer, std::bit_cast<u64>(integer));
+            }
+
+            static constexpr auto of(raw::Int integer) -> Term {
+                if (integer.size > 64) throw std::logic_error("Int wider than 64 bits");
+
+                Term term(Kind::Int, integer.number);
+                term.size = u8(integer.size);
+                return term;
+            }
+
+            static constexpr auto type(TypeId type) noexcept -> Term {
+                return Term(Kind::Type, type);
+            }
+
+            static auto residual(Expr const& expr) noexcept -> Term {
+                return Term(Kind::Residual, std::bit_cast<u64>(&expr));
+            }
+
+            constexpr auto get_kind() const noexcept -> Kind { return kind; }
+
+            constexpr auto is_aggregate() const noexcept -> bool { return kind >= Kind::Tuple; }
+
+            constexpr auto get_boolean() const noexcept -> std::optional<raw::Boolean> {
+                if (kind != Kind::Boolean) return std::nullopt;
+                return raw::Boolean { .value = payload != 0 };
+            }
+
+            /// Answers an integer which fits in 64 bits, `TermArena::integer_of` answers any integer.
+            constexpr auto get_small_integer() const noexcept -> std::optional<i64> {
+                if (kind != Kind::Integer) return std::nullopt;
+                return std::bit_cast<i64>(payload);
+            }
+
+            constexpr auto get_int() const noexcept -> std::optional<raw::Int> {
+                if (kind != Kind::Int) return std::nullopt;
+                return raw::Int { .number = payload, .size = size };
+            }
+
+            /// Answers the type of a type term, or of a struct or enum.
+            constexpr auto get_type() const noexcept -> std::optional<TypeId> {
+                switch (kind) {
+                    case Kind::Type:   return TypeId(payload);
+                    case Kind::Struct:
+                    case Kind::Enum:   return TypeId(payload >> 32);
+                    default:           return std::nullopt;
+                }
+            }
+
+            auto get_residual() const noexcept -> Expr const* {
+                if (kind != Kind::Residual) return nullptr;
+                return std::bit_cast<Expr const*>(payload);
+            }
+
+            /// Answers the case of an enum.
+            constexpr auto get_case() const noexcept -> std::optional<u16> {
+                if (kind != Kind::Enum) return std::nullopt;
+                return index;
+            }
+
+            /// Answers the element count of an aggregate.
+            constexpr auto get_count() const noexcept -> u32 { return count; }
+
+            /// Compares the terms themselves, aggregates compare by identity. `TermArena::equal`
+            /// compares aggregates by their elements.
+            constexpr auto operator == (Term const& other) const noexcept -> bool = default;
+        };
+
+        static_assert(sizeof(Term) == 16);
+        static_assert(std::is_trivially_copyable_v<Term>);
+
+        /// Holds the elements of aggregate terms, contiguously and in order of construction.
+        ///
+        /// Terms refer to their elements by index, so they stay valid as the arena grows, and each
+        /// aggregate costs a single append rather than an allocation of its own.
+        class TermArena final {
+            std::vector<Term> elements;
+            std::vector<raw::Integer> integers;
+
+            auto make(Term::Kind kind, TypeId type, std::span<const Term> values) -> Term {
+                if (elements.size() + values.size() > std::numeric_limits<u32>::max()) {
+                    throw std::length_error("evaluation arena exhausted");
+                }
+
+                Term term(kind, u64(type) << 32 | u64(elements.size()));
+                term.count = u32(values.size());
+
+                // The values may be the elements of another aggregate, which growing would invalidate.
+                auto data = elements.data();
+                if (not values.empty() and std::less_equal()(data, values.data()) and std::less()(values.data(), data + elements.size())) {
+                    usize offset = values.data() - data;
+                    elements.resize(elements.size() + values.size());
+                    std::copy_n(elements.begin() + offset, values.size(), elements.end() - values.size());
+                } else {
+                    elements.append_range(values);
+                }
+
+                return term;
+            }
+
+          public:
+            /// Makes an integer term, inline if the integer fits in 64 bits.
+            auto integer(raw::Integer integer) -> Term {
+                if (auto small = integer.get_small()) return Term::of(*small);
+
+                Term term(Term::Kind::BigInteger, integers.size());
+                integers.push_back(std::move(integer));
+                return term;
+            }
+
+            auto integer_of(Term term) const -> std::optional<raw::Integer> {
+                if (auto small = term.get_small_integer()) return raw::Integer(*small);
+                if (term.kind == Term::Kind::BigInteger) return integers[term.payload];
+                return std::nullopt;
+            }
+
+            auto tuple(std::span<const Term> values) -> Term {
+                if (values.empty()) return Term::unit();
+                return make(Term::Kind::Tuple, 0, values);
+            }
+
+            auto structure(TypeId type, std::span<const Term> fields) -> Term {
+                return make(Term::Kind::Struct, type, fields);
+            }
+
+            auto enumeration(TypeId type, u16 index, std::span<const Term> payload = {}) -> Term {
+                Term term = make(Term::Kind::Enum, type, payload);
+                term.index = index;
+                return term;
+            }
+
+            auto list(std::span<const Term> values) -> Term {
+                return make(Term::Kind::List, 0, values);
+            }
+
+            /// Answers the elements of an aggregate, which are empty for any other term.
+            auto elements_of(Term term) -> std::span<Term> {
+                if (not term.is_aggregate()) return {};
+                return std::span(elements).subspan(u32(term.payload), term.count);
+            }
+
+            auto elements_of(Term term) const -> std::span<const Term> {
+                if (not term.is_aggregate()) return {};
+                return std::span(elements).subspan(u32(term.payload), term.count);
+            }
+
+            /// Compares terms structurally, descending into aggregates.
+            auto equal(Term a, Term b) const -> bool {
+                return equal(*this, a, *this, b);
+            }
+
+            /// Compares terms structurally, where each term belongs to a different arena.
+            static auto equal(TermArena const& a_terms, Term a, TermArena const& b_terms, Term b) -> bool {
+                if (a.kind == Term::Kind::BigInteger and b.kind == Term::Kind::BigInteger) {
+                    return a_terms.integers[a.payload] == b_terms.integers[b.payload];
+                }
+
+                if (not a.is_aggregate() or not b.is_aggregate()) return a == b;
+                if (a.kind != b.kind or a.index != b.index or a.count != b.count) return false;
+                if (a.get_type() != b.get_type()) return false;
+
+                return std::ranges::equal(
+                    a_terms.elements_of(a),
+                    b_terms.elements_of(b),
+                    [&] (Term x, Term y) { return equal(a_terms, x, b_terms, y); }
+                );
+            }
+
+            /// Copies a term of another arena into this one, along with everything it refers to.
+            auto copy(TermArena const& from, Term term) -> Term {
+                if (term.kind == Term::Kind::BigInteger) return integer(from.integers[term.payload]);
+                if (not term.is_aggregate()) return term;
+
+                std::vector<Term> values;
+                values.reserve(term.count);
+                for (Term element : from.elements_of(term)) values.push_back(copy(from, element));
+
+                Term copied = make(term.kind, TypeId(term.payload >> 32), values);
+                copied.index = term.index;
+                return copied;
+            }
+
+            /// Hashes terms structurally, consistently with `equal`. Where the elements are stored doesn't
+            /// matter, so equal terms of different arenas hash the same.
+            auto hash(Term term) const -> u64 {
+                auto mix = [] (u64 hash, u64 value) {
+                    hash = (hash ^ value) * 0x9e3779b97f4a7c15;
+                    return hash ^ hash >> 32;
+                };
+
+                u64 hash = mix(u64(term.kind), u64(term.size) | u64(term.index) << 8 | u64(term.count) << 32);
+
+                if (term.kind == Term::Kind::BigInteger) return mix(hash, integers[term.payload].hash());
+                if (not term.is_aggregate()) return mix(hash, term.payload);
+
+                hash = mix(hash, term.payload >> 32);
+                for (Term element : elements_of(term)) hash = mix(hash, this->hash(element));
+                return hash;
+            }
+
+            /// Answers true if the term is fully evaluated, without a residual anywhere inside of it.
+            auto is_constant(Term term) const -> bool {
+                if (term.kind == Term::Kind::Residual) return false;
+                return std::ranges::all_of(elements_of(term), [this] (Term element) { return is_constant(element); });
+            }
+
+            /// Answers the count of elements held, which only grows until the arena is cleared.
+            auto size() const -> usize { return elements.size(); }
+
+            /// Answers the memory held by the arena in bytes, including the limbs of big integers.
+            auto get_bytes() const -> usize {
+                usize bytes = elements.capacity() * sizeof(Term) + integers.capacity() * sizeof(raw::Integer);
+                for (auto const& integer : integers) bytes += integer.get_limb_count() * sizeof(u64);
+                return bytes;
+            }
+
+            void reserve(usize count) { elements.reserve(count); }
+
+            /// Drops every aggregate and big integer at once, invalidating all terms referring to them.
+            void clear() {
+                elements.clear();
+                integers.clear();
+            }
+        };
+
+        /// The elements of every aggregate term the evaluator produces.
+        TermArena terms;
+
+        /// A declaration applied to arguments, which identifies both types and instantiations.
+        ///
+        /// The arguments are copied out of their arena along with everything they refer to, since the evaluation
+        /// arena is cleared far more often than types and instantiations go away.
+        struct AppliedDecl {
+            Decl const* decl = nullptr;
+            std::vector<Term> arguments;
+            /// Holds the aggregates among the arguments, and among anything else kept along with them.
+            TermArena terms;
+            u64 hash = 0;
+
+            AppliedDecl() = default;
+
+            AppliedDecl(TermArena const& terms, Decl const& decl, std::span<const Term> arguments, u64 hash)
+                : decl(&decl), hash(hash)
+            {
+                this->arguments.reserve(arguments.size());
+                for (Term argument : arguments) this->arguments.push_back(this->terms.copy(terms, argument));
+            }
+
+            static auto hash_of(TermArena const& terms, Decl const& decl, std::span<const Term> arguments) -> u64 {
+                u64 hash = std::hash<Decl const*>()(&decl);
+                for (Term term : arguments) hash = (hash ^ terms.hash(term)) * 0xd6e8feb86659fd93;
+                return hash ^ arguments.size();
+            }
+
+            /// Answers true if this is the declaration applied to the arguments, which belong to another arena.
+            auto matches(TermArena const& terms, Decl const& decl, std::span<const Term> arguments) const -> bool {
+                return this->decl == &decl and std::ranges::equal(this->arguments, arguments, [&] (Term a, Term b) {
+                    return TermArena::equal(this->terms, a, terms, b);
+                });
+            }
+        };
+
+        /// Interns every type the evaluator constructs, so each distinct type exists once and is referred
+        /// to by its id. Comparing types is comparing their ids, and so is hashing them.
+        ///
+        /// A type is its declaration applied to its generic arguments, `UInt<8>` is the `UInt` declaration
+        /// applied to `8`. Instantiating a generic type which was seen before finds its entry rather than
+        /// building it again.
+        ///
+        /// Types are looked up far more often than they are created, so lookups only share a lock, and reading
+        /// an interned type takes none at all. Entries live in segments which never move once published.
+        class TypeTable final {
+          public:
+            using Type = AppliedDecl;
+
+          private:
+            /// Segment `n` holds `FIRST_SEGMENT << n` entries, so the table grows geometrically.
+            static constexpr usize FIRST_SEGMENT = 64;
+            static constexpr usize SEGMENT_COUNT = 26;
+            static constexpr usize CAPACITY = FIRST_SEGMENT * ((usize(1) << SEGMENT_COUNT) - 1);
+
+            std::array<std::atomic<Type*>, SEGMENT_COUNT> segments {};
+            std::atomic<u32> count = 0;
+            std::unordered_multimap<u64, TypeId> index;
+            mutable std::shared_mutex mutex;
+
+            static auto locate(TypeId id) -> std::pair<usize, usize> {
+                usize segment = std::bit_width(id / FIRST_SEGMENT + 1) - 1;
+                return { segment, id - FIRST_SEGMENT * ((usize(1) << segment) - 1) };
+            }
+
+            /// Finds an entry, the lock must be held.
+            auto find(u64 hash, TermArena const& terms, Decl const& decl, std::span<const Term> arguments) const
+                -> std::optional<TypeId>
+            {
+                auto [begin, end] = index.equal_range(hash);
+                for (auto candidate = begin; candidate != end; ++candidate) {
+                    if (get(candidate->second).matches(terms, decl, arguments)) return candidate->second;
+                }
+                return std::nullopt;
+            }
+
+          public:
+            TypeTable() = default;
+
+            /// Tables are only moved along with the sir, never while in use.
+            TypeTable(TypeTable&& other) noexcept
+                : count(other.count.exchange(0)), index(std::move(other.index))
+            {
+                for (usize i = 0; i < SEGMENT_COUNT; i += 1) segments[i] = other.segments[i].exchange(nullptr);
+            }
+
+            TypeTable(TypeTable const&) = delete;
+            auto operator = (TypeTable const&) -> TypeTable& = delete;
+            auto operator = (TypeTable&&) -> TypeTable& = delete;
+
+            ~TypeTable() {
+                for (auto& segment : segments) delete[] segment.load(std::memory_order_relaxed);
+            }
+
+            /// Answers the id of a declaration applied to generic arguments, interning it if it is new.
+            /// The arguments are copied out of their arena, which may be cleared afterwards.
+            auto intern(TermArena const& terms, Decl const& decl, std::span<const Term> arguments) -> TypeId {
+                u64 hash = AppliedDecl::hash_of(terms, decl, arguments);
+
+                {
+                    std::shared_lock lock(mutex);
+                    if (auto id = find(hash, terms, decl, arguments)) return *id;
+                }
+
+                std::unique_lock lock(mutex);
+                // Another thread may have interned the same type in between.
+                if (auto id = find(hash, terms, decl, arguments)) return *id;
+
+                TypeId id = count.load(std::memory_order_relaxed);
+                if (id == CAPACITY) throw std::length_error("type table exhausted");
+
+                auto [segment, offset] = locate(id);
+                Type* entries = segments[segment].load(std::memory_order_relaxed);
+                if (not entries) {
+                    entries = new Type[FIRST_SEGMENT << segment];
+                    segments[segment].store(entries, std::memory_order_release);
+                }
+
+                entries[offset] = Type(terms, decl, arguments, hash);
+
+                index.emplace(hash, id);
+                count.store(id + 1, std::memory_order_release);
+                stats::interned_types.add();
+                return id;
+            }
+
+            /// Answers an interned type. Any id answered by `intern` can be read from any thread without locking.
+            auto get(TypeId id) const -> Type const& {
+                auto [segment, offset] = locate(id);
+                return segments[segment].load(std::memory_order_acquire)[offset];
+            }
+
+            auto size() const -> usize { return count.load(std::memory_order_acquire); }
+        };
+
+        TypeTable types;
+
+        /// Makes a type term of a declaration applied to generic arguments.
+        auto type(Decl const& decl, std::span<const Term> arguments = {}) -> Term {
+            return Term::type(types.intern(terms, decl, arguments));
+        }
+
+        /// Completes the generic arguments of a use of a declaration, so that uses which spell the same
+        /// instantiation differently find the same one.
+        ///
+        /// The arguments are matched to the parameters by position, labels are resolved by the caller.
+        /// Missing arguments take the default of their parameter, evaluated by the caller.
+        auto canonical_generics(
+            Decl const& decl,
+            std::span<const std::optional<Term>> arguments,
+            Provenance provenance,
+            std::invocable<Decl::GenericParameter const&> auto&& evaluate_default
+        ) -> std::vector<Term> {
+            auto parameters = decl.get_generics();
+
+            if (arguments.size() > parameters.size()) {
+                throw Diagnostic::error(
+                    provenance,
+                    std::format("expected at most {} generic arguments, found {}", parameters.size(), arguments.size())
+                );
+            }
+
+            std::vector<Term> canonical;
+            canonical.reserve(parameters.size());
+
+            for (usize i = 0; i < parameters.size(); i += 1) {
+                if (i < arguments.size() and arguments[i]) {
+                    canonical.push_back(*arguments[i]);
+                } else if (parameters[i].default_expr) {
+                    canonical.push_back(evaluate_default(parameters[i]));
+                } else {
+                    throw Diagnostic::error(provenance, std::format("missing generic argument `{}`", parameters[i].name));
+                }
+            }
+
+            return canonical;
+        }
+
+        class InstantiationCache;
+
+        /// A generic declaration applied to one set of generic arguments in canonical form, along with everything
+        /// the evaluator derives from them.
+        struct Instantiation final : AppliedDecl {
+            struct Layout final {
+                u64 size = 0;
+                u64 alignment = 1;
+                std::vector<u64> offsets;
+            };
+
+            /// The members with the generic parameters substituted, their aggregates are held by `terms`.
+            std::unordered_map<Symbol, Term> members;
+            /// The categories the instantiation conforms to.
+            std::vector<TypeId> conformances;
+            /// The layout of a type instantiation.
+            std::optional<Layout> layout;
+
+            /// How many times the instantiation was asked for.
+            mutable std::atomic<u64> uses = 0;
+            /// How long computing it took.
+            u64 cost = 0;
+
+          private:
+            std::once_flag built;
+
+            friend class InstantiationCache;
 
-            template <std::same_as<Diagnostic>... Diagnostic> DiagnosticBundle(Diagnostic... diagnostics)
-                : diagnostics({ diagnostics... }) {}
+          public:
+            using AppliedDecl::AppliedDecl;
         };
 
-        /// The evaluator domain type of either a Type, Value or Residual.
-        struct Term final {
-            struct Type final {
+        /// Computes every instantiation once and shares it between all of its uses.
+        ///
+        /// Instantiations are keyed by the declaration and the canonical generic arguments. Like the type
+        /// table, lookups only share a lock. An instantiation being computed holds up only the uses of that
+        /// same instantiation.
+        class InstantiationCache final {
+            /// Instantiations never move once created.
+            std::deque<Instantiation> entries;
+            std::unordered_multimap<u64, Instantiation*> index;
+            mutable std::shared_mutex mutex;
+
+            /// Finds an entry, the lock must be held.
+            auto find(u64 hash, TermArena const& terms, Decl const& decl, std::span<const Term> arguments) const
+                -> Instantiation*
+            {
+                auto [begin, end] = index.equal_range(hash);
+                for (auto candidate = begin; candidate != end; ++candidate) {
+                    if (candidate->second->matches(terms, decl, arguments)) return candidate->second;
+                }
+                return nullptr;
+            }
 
-            };
+            auto find_or_insert(TermArena const& terms, Decl const& decl, std::span<const Term> arguments) -> Instantiation& {
+                u64 hash = AppliedDecl::hash_of(terms, decl, arguments);
 
-            struct Value final {
+                {
+                    std::shared_lock lock(mutex);
+                    if (auto instantiation = find(hash, terms, decl, arguments)) return *instantiation;
+                }
 
-            };
+                std::unique_lock lock(mutex);
+                if (auto instantiation = find(hash, terms, decl, arguments)) return *instantiation;
 
-            struct Residual final {
+                Instantiation& instantiation = entries.emplace_back(terms, decl, arguments, hash);
+                index.emplace(hash, &instantiation);
+                return instantiation;
+            }
 
-            };
+          public:
+            InstantiationCache() = default;
 
-            using Data = std::variant<Type, Value, Residual>;
+            /// Caches are only moved along with the sir, never while in use.
+            InstantiationCache(InstantiationCache&& other) noexcept
+                : entries(std::move(other.entries)), index(std::move(other.index)) {}
 
-            Data data;
+            InstantiationCache(InstantiationCache const&) = delete;
+            auto operator = (InstantiationCache const&) -> InstantiationCache& = delete;
+            auto operator = (InstantiationCache&&) -> InstantiationCache& = delete;
 
-            template <typename T> auto get() -> T& {
-                return std::get<T>(data);
+            /// Answers the instantiation of a declaration for canonical generic arguments, building it first
+            /// if this is its first use. If building it throws, the next use builds it again from scratch.
+            ///
+            /// The members are made in the arena of the arguments, and copied into the instantiation once built.
+            auto instantiate(
+                TermArena const& terms,
+                Decl const& decl,
+                std::span<const Term> arguments,
+                std::invocable<Instantiation&> auto&& build
+            ) -> Instantiation const& {
+                Instantiation& instantiation = find_or_insert(terms, decl, arguments);
+
+                bool reused = true;
+                std::call_once(instantiation.built, [&] {
+                    // A build that threw before may have filled some of these in.
+                    instantiation.members.clear();
+                    instantiation.conformances.clear();
+                    instantiation.layout.reset();
+
+                    trace::Scope trace_scope("instantiate", [&] { return describe(decl); });
+
+                    auto begin = std::chrono::steady_clock::now();
+                    build(instantiation);
+                    for (auto& [name, member] : instantiation.members) member = instantiation.terms.copy(terms, member);
+                    auto end = std::chrono::steady_clock::now();
+
+                    instantiation.cost = u64(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+                    stats::instantiations.add();
+                    stats::instantiation_ns.record(instantiation.cost);
+                    reused = false;
+                });
+
+                if (reused) stats::instantiation_reuses.add();
+                instantiation.uses.fetch_add(1, std::memory_order_relaxed);
+                return instantiation;
             }
 
-            template <typename T> auto get_as() -> T* {
-                if (std::holds_alternative<T>(data)) {
-                    return &std::get<T>(data);
-                } else {
-                    return nullptr;
+            auto size() const -> usize {
+                std::shared_lock lock(mutex);
+                return entries.size();
+            }
+
+            /// Writes every instantiation with how often it was used and how long it took to compute,
+            /// costliest first.
+            void write_report(std::ostream& out) const {
+                std::shared_lock lock(mutex);
+
+                std::vector<Instantiation const*> sorted;
+                for (auto const& instantiation : entries) sorted.push_back(&instantiation);
+                std::ranges::sort(sorted, std::ranges::greater(), &Instantiation::cost);
+
+                std::println(out, "{:<32} {:>9} {:>8} {:>12}", "instantiation", "arguments", "uses", "cost");
+                for (auto instantiation : sorted) {
+                    std::println(
+                        out, "{:<32} {:>9} {:>8} {:>9.3f} ms",
+                        describe(*instantiation->decl),
+                        instantiation->arguments.size(),
+                        instantiation->uses.load(std::memory_order_relaxed),
+                        f64(instantiation->cost) / 1e6
+                    );
                 }
             }
+        };
+
+        InstantiationCache instantiations;
+
+        /// Answers the instantiation of a declaration for canonical generic arguments, see `canonical_generics`.
+        auto instantiate(
+            Decl const& decl,
+            std::span<const Term> arguments,
+            std::invocable<Instantiation&> auto&& build
+        ) -> Instantiation const& {
+            return instantiations.instantiate(terms, decl, arguments, build);
+        }
+
+        /// Remembers the results of constant calls, so a pure function called with the same arguments
+        /// over and over is only evaluated once.
+        ///
+        /// Calls are keyed by the resolved declaration, the generic arguments and the arguments, where the
+        /// terms compare and hash structurally. Each entry copies its key and result into an arena of its own,
+        /// so entries outlive clearing the evaluation arena, and the cap in bytes bounds everything the table
+        /// holds. Once it is full the least recently used results are evicted.
+        class CallMemo final {
+          public:
+            /// The default cap of the memory held by the table.
+            static constexpr usize CAPACITY = 64 * 1024 * 1024;
+
+          private:
+            struct Entry final {
+                Decl const* decl = nullptr;
+                std::vector<Term> generics;
+                std::vector<Term> arguments;
+                Term result;
+                /// Holds the aggregates among the key and the result.
+                TermArena terms;
+                u64 hash = 0;
+                usize bytes = 0;
+            };
+
+            usize capacity;
+            usize bytes = 0;
+            /// Most recently used first.
+            std::list<Entry> entries;
+            std::unordered_multimap<u64, std::list<Entry>::iterator> index;
+
+            u64 hits = 0;
+            u64 misses = 0;
+            u64 evictions = 0;
+
+            static auto hash_of(
+                TermArena const& terms,
+                Decl const& decl,
+                std::span<const Term> generics,
+                std::span<const Term> arguments
+            ) -> u64 {
+                u64 hash = std::hash<Decl const*>()(&decl);
+                for (Term term : generics) hash = (hash ^ terms.hash(term)) * 0xd6e8feb86659fd93;
+                hash ^= generics.size() << 48;
+                for (Term term : arguments) hash = (hash ^ terms.hash(term)) * 0xd6e8feb86659fd93;
+                return hash;
+            }
 
-            template <typename T> auto get() const -> T const& {
-                return std::get<T>(data);
+            static auto equal(Entry const& entry, std::span<const Term> a, TermArena const& terms, std::span<const Term> b) -> bool {
+                return std::ranges::equal(a, b, [&] (Term x, Term y) { return TermArena::equal(entry.terms, x, terms, y); });
             }
 
-            template <typename T> auto get_as() const -> T const* {
-                if (std::holds_alternative<T>(data)) {
-                    return &std::get<T>(data);
-                } else {
-                    return nullptr;
+          public:
+            explicit CallMemo(usize capacity = CAPACITY) : capacity(capacity) {}
+
+            /// Answers the remembered result of a call copied into the arena of the arguments, if there is one.
+            auto find(
+                TermArena& terms,
+                Decl const& decl,
+                std::span<const Term> generics,
+                std::span<const Term> arguments
+            ) -> std::optional<Term> {
+                u64 hash = hash_of(terms, decl, generics, arguments);
+
+                auto [begin, end] = index.equal_range(hash);
+                for (auto candidate = begin; candidate != end; ++candidate) {
+                    auto entry = candidate->second;
+                    if (entry->decl != &decl) continue;
+                    if (not equal(*entry, entry->generics, terms, generics)) continue;
+                    if (not equal(*entry, entry->arguments, terms, arguments)) continue;
+
+                    entries.splice(entries.begin(), entries, entry);
+                    hits += 1;
+                    stats::memo_hits.add();
+                    return terms.copy(entry->terms, entry->result);
+                }
+
+                misses += 1;
+                stats::memo_misses.add();
+                return std::nullopt;
+            }
+
+            /// Remembers the result of a call, evicting the least recently used results to stay within the cap.
+            void insert(
+                TermArena const& terms,
+                Decl const& decl,
+                std::span<const Term> generics,
+                std::span<const Term> arguments,
+                Term result
+            ) {
+                Entry entry { .decl = &decl, .hash = hash_of(terms, decl, generics, arguments) };
+                entry.generics.reserve(generics.size());
+                entry.arguments.reserve(arguments.size());
+
+                for (Term generic : generics) entry.generics.push_back(entry.terms.copy(terms, generic));
+                for (Term argument : arguments) entry.arguments.push_back(entry.terms.copy(terms, argument));
+                entry.result = entry.terms.copy(terms, result);
+
+                // The list and index nodes are estimated at a few pointers each.
+                entry.bytes = sizeof(Entry) + 6 * sizeof(void*) + (generics.size() + arguments.size()) * sizeof(Term);
+                entry.bytes += entry.terms.get_bytes();
+                if (entry.bytes > capacity) return;
+
+                while (bytes + entry.bytes > capacity) {
+                    auto& victim = entries.back();
+
+                    auto [begin, end] = index.equal_range(victim.hash);
+                    for (auto candidate = begin; candidate != end; ++candidate) {
+                        if (&*candidate->second == &victim) {
+                            index.erase(candidate);
+                            break;
+                        }
+                    }
+
+                    bytes -= victim.bytes;
+                    entries.pop_back();
+                    evictions += 1;
+                    stats::memo_evictions.add();
                 }
+
+                bytes += entry.bytes;
+                entries.push_front(std::move(entry));
+                index.emplace(entries.front().hash, entries.begin());
+            }
+
+            /// Forgets every result.
+            void clear() {
+                entries.clear();
+                index.clear();
+                bytes = 0;
             }
+
+            auto get_hits() const -> u64 { return hits; }
+            auto get_misses() const -> u64 { return misses; }
+            auto get_evictions() const -> u64 { return evictions; }
+            auto get_bytes() const -> usize { return bytes; }
         };
 
+        CallMemo memo;
+
+        /// Evaluates a constant call through the memo table.
+        ///
+        /// A remembered result is answered without evaluating anything. Otherwise the call is evaluated and
+        /// its result remembered, but only if the call is pure as far as the evaluator can tell: every argument
+        /// and the result are fully evaluated, and evaluating it raised no diagnostics.
+        auto memoized_call(
+            Decl const& decl,
+            std::span<const Term> generics,
+            std::span<const Term> arguments,
+            std::invocable auto&& evaluate
+        ) -> Term {
+            auto constant = [this] (std::span<const Term> span) {
+                return std::ranges::all_of(span, [this] (Term term) { return terms.is_constant(term); });
+            };
+
+            if (not constant(generics) or not constant(arguments)) return evaluate();
+
+            if (auto result = memo.find(terms, decl, generics, arguments)) return *result;
+
+            usize diagnostic_count = diagnostics.size();
+            Term result = evaluate();
+
+            if (diagnostics.size() == diagnostic_count and terms.is_constant(result)) {
+                memo.insert(terms, decl, generics, arguments, result);
+            }
+
+            return result;
+        }
+
         /// As the evaluator descends it may be operating in a lexical scope, like a block. Blocks allow a few
         /// additional statement expressions which declare bindings for the duration of the lexical scope, and
         /// this type is used to represent that associated state.
@@ -4928,7 +7848,7 @@ namespace str {
                 /// The kind of the binding.
                 Kind kind;
                 /// The name of the binding.
-                std::string_view name;
+                Symbol name;
                 /// The provenance of the binding.
                 Provenance provenance;
                 /// The meaning is as follows:
@@ -5031,7 +7951,7 @@ namespace str {
         /// to abort other evaluations that depend on it as well.
         /// This is because individual evaluations will catch diagnostics and we can continue evaluating something else.
         /// In the end, if any diagnostics of error severity were present, the sir is erroneous and can't be lowered.
-        std::unordered_set<std::string> active_evaluations;
+        std::unordered_set<Symbol> active_evaluations;
 
         /// A unique evaluation context.
         struct EvaluationContext final {
@@ -5060,87 +7980,606 @@ namespace str {
         }
     };
 
+    namespace stats {
+        inline Counter diagnostics { "sir.diagnostics" };
+    }
+
     /// Produces an evaluated Sir instance.
     inline auto evaluate(Modules modules, std::vector<SourceUnit> source_units) -> Sir {
         Sir sir(
             std::move(modules),
             std::move(source_units),
             AUTO_IMPORTS
-                | std::views::transform([] (auto s) { return std::string(s); })
+                | std::views::transform([] (std::string_view s) { return Path(s); })
                 | std::ranges::to<std::vector>()
         );
 
-        sir.evaluate();
+        {
+            trace::Scope trace_scope("evaluate");
+            alloc::Tag alloc_tag(alloc::Phase::Evaluate);
+            sir.evaluate();
+        }
+
+        stats::diagnostics.add(sir.get_diagnostics().size());
 
         return sir;
     }
 }
 
-namespace str {
-    /// Unlike the actual compiler, the bootstrap compiler naively executes the residual tree directly
-    /// instead of lowering, since it would be a waste to write non self-hosted backends.
-    inline i32 execute(Sir& sir) {
-        // auto residuals = sir.residualize_all_annotated_as("core.Entry");
+namespace str {
+    /// Unlike the actual compiler, the bootstrap compiler naively executes the residual tree directly
+    /// instead of lowering, since it would be a waste to write non self-hosted backends.
+    inline i32 execute(Sir& sir) {
+        // auto residuals = sir.residualize_all_annotated_as("core.Entry");
+
+        // for (auto residual : residuals) {
+
+        // }
+
+        return 0;
+    }
+
+    /// A special temporary backend for the 6502 for prototyping the language in an extremely constrained environment.
+    inline i32 backend_lower_ca65(Sir& sir) {
+        // auto residuals = sir.residualize_all_annotated_as("core.Entry", "core.Export");
+
+        // for (auto residual : residuals) {
+
+        // }
+
+        return 0;
+    }
+}
+
+namespace str {
+    /// A fixed set of workers running indexed tasks, stealing from each other when they run dry.
+    ///
+    /// Tasks are dealt out in contiguous runs up front. A worker takes from the back of its own queue
+    /// and steals from the front of the others, so uneven task costs still keep every worker busy.
+    class WorkPool final {
+        struct Queue final {
+            std::mutex mutex;
+            std::deque<usize> tasks;
+        };
+
+        usize workers;
+
+        static auto take_back(Queue& queue) -> std::optional<usize> {
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) return std::nullopt;
+            usize task = queue.tasks.back();
+            queue.tasks.pop_back();
+            return task;
+        }
+
+        static auto take_front(Queue& queue) -> std::optional<usize> {
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) return std::nullopt;
+            usize task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return task;
+        }
+
+      public:
+        explicit WorkPool(usize workers) : workers(std::max<usize>(workers, 1)) {}
+
+        auto get_workers() const -> usize { return workers; }
+
+        /// Runs `task(index)` for every index below `count` and waits for all of them to finish.
+        ///
+        /// The first exception escaping a task is rethrown once every worker has stopped.
+        void run(usize count, std::invocable<usize> auto&& task) {
+            usize active = std::min(workers, count);
+
+            if (active <= 1) {
+                for (usize index = 0; index < count; index += 1) task(index);
+                return;
+            }
+
+            std::vector<Queue> queues(active);
+            for (usize worker = 0; worker < active; worker += 1) {
+                for (usize index = count * worker / active; index < count * (worker + 1) / active; index += 1) {
+                    queues[worker].tasks.push_back(index);
+                }
+            }
+
+            std::mutex failure_mutex;
+            std::exception_ptr failure;
+
+            auto work = [&] (usize self) {
+                while (true) {
+                    auto index = take_back(queues[self]);
+
+                    for (usize offset = 1; not index and offset < active; offset += 1) {
+                        index = take_front(queues[(self + offset) % active]);
+                    }
+
+                    // Nothing is ever queued after dealing, so once every queue is empty we are done.
+                    if (not index) return;
+
+                    try {
+                        task(*index);
+                    } catch (...) {
+                        std::lock_guard lock(failure_mutex);
+                        if (not failure) failure = std::current_exception();
+                    }
+                }
+            };
+
+            {
+                std::vector<std::jthread> threads;
+                for (usize worker = 1; worker < active; worker += 1) threads.emplace_back(work, worker);
+                work(0);
+            }
+
+            if (failure) std::rethrow_exception(failure);
+        }
+    };
+}
+
+namespace str::stats {
+    inline Histogram unit_bytes { "loader.unit_bytes" };
+}
+
+namespace str::run {
+    /// Reads a source file into a new source unit with the next free id.
+    inline void read_source_unit(std::filesystem::path const& path, std::vector<SourceUnit>& source_units) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (not file) return;
+
+        ScopeExit scope_exit = [file] { std::fclose(file); };
+
+        std::fseek(file, 0, SEEK_END);
+        u32 size = std::ftell(file);
+        std::rewind(file);
+
+        std::string content;
+        content.resize(size);
+        std::fread(content.data(), 1, size, file);
+
+        if (source_units.size() > std::numeric_limits<u16>::max()) {
+            throw std::runtime_error("too many source units");
+        }
+
+        source_units.push_back(SourceUnit::from_string(std::move(content), path.string(), u16(source_units.size())));
+    }
+
+    /// The ways a batch of source files can be read, the bench subcommand compares them.
+    enum class Loader {
+        /// One file after another with blocking calls, each into its own string.
+        Sequential,
+        /// Blocking calls spread over a work pool, into a single buffer.
+        Threads,
+        /// Batches of stats, opens, reads and closes submitted through io_uring, into a single buffer.
+        /// It is only available on Linux and falls back to threads when the kernel refuses it.
+        Uring,
+        /// Every file mapped read only, without copying anything. The pages stay shared with the page cache,
+        /// and so with every other process reading the same files.
+        ///
+        /// A file truncated while it is mapped faults with SIGBUS on access to the lost pages, and changes
+        /// to the file show through. Many editors save by truncating and rewriting a file in place, so this
+        /// is only safe for one shot runs over files nothing writes meanwhile, never in long running processes
+        /// such as the language server or the watch daemon.
+        Mapped
+    };
+
+    /// Answers the fastest loader of the platform.
+    inline auto default_loader() -> Loader {
+        return uring::supported ? Loader::Uring : Loader::Threads;
+    }
+
+    namespace detail {
+        /// A read only mapping of a whole file, unmapped once the last unit viewing it is gone.
+        class Mapping final {
+            void* data;
+            usize size;
+
+          public:
+            Mapping(void* data, usize size) : data(data), size(size) {}
+            ~Mapping() { munmap(data, size); }
+
+            Mapping(Mapping const&) = delete;
+            auto operator = (Mapping const&) -> Mapping& = delete;
+
+            auto get_text() const -> std::string_view { return { static_cast<char const*>(data), size }; }
+        };
+
+        /// Maps a source file into a new source unit with the next free id.
+        inline void map_source_unit(std::filesystem::path const& path, std::vector<SourceUnit>& source_units) {
+            i32 fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return;
+
+            ScopeExit scope_exit = [fd] { ::close(fd); };
+
+            struct stat status;
+            if (fstat(fd, &status) != 0 or not S_ISREG(status.st_mode)) return;
+
+            SourceUnit source_unit { .source = path.string(), .id = u16(source_units.size()) };
+
+            // Empty files can't be mapped, and there is nothing to keep alive for them anyway.
+            if (status.st_size > 0) {
+                void* data = mmap(nullptr, usize(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) return;
+
+                auto mapping = std::make_shared<const Mapping>(data, usize(status.st_size));
+                source_unit.text = mapping->get_text();
+                source_unit.storage = std::move(mapping);
+            }
+
+            source_unit.index_lines();
+            source_units.push_back(std::move(source_unit));
+        }
+
+        /// Where a file of a batch lands in the shared buffer. The size is negative if the file can't be read.
+        struct Slot final {
+            i64 size = -1;
+            u64 offset = 0;
+            u64 read = 0;
+        };
+
+        /// Places the readable files after each other, answering the size of the buffer they need.
+        inline auto place(std::span<Slot> slots) -> u64 {
+            u64 total = 0;
+
+            for (auto& slot : slots) {
+                if (slot.size < 0) continue;
+                slot.offset = total;
+                total += u64(slot.size);
+            }
+
+            return total;
+        }
+
+        inline void read_with_threads(std::span<const std::filesystem::path> paths, std::span<Slot> slots, auto allocate) {
+            WorkPool pool(std::thread::hardware_concurrency());
+
+            pool.run(paths.size(), [&] (usize index) {
+                std::error_code error_code;
+                u64 size = std::filesystem::file_size(paths[index], error_code);
+                if (not error_code) slots[index].size = i64(size);
+            });
+
+            char* buffer = allocate(place(slots));
+
+            pool.run(paths.size(), [&] (usize index) {
+                auto& slot = slots[index];
+                if (slot.size < 0) return;
+
+                std::FILE* file = std::fopen(paths[index].c_str(), "rb");
+                if (not file) {
+                    slot.size = -1;
+                    return;
+                }
+
+                slot.read = std::fread(buffer + slot.offset, 1, u64(slot.size), file);
+                std::fclose(file);
+            });
+        }
+
+        /// Reads a batch in three round trips to the kernel, whatever the number of files.
+        /// Answers false without reading anything if io_uring is unavailable.
+        inline auto read_with_uring(std::span<const std::filesystem::path> paths, std::span<Slot> slots, auto allocate) -> bool {
+        #if defined(__linux__)
+            static constexpr u32 depth = 256;
+
+            auto ring = uring::Ring::create(depth);
+            if (not ring) return false;
+
+            bool unsupported = false;
+
+            std::vector<struct statx> stats(paths.size());
+            bool ran = ring->run(
+                paths.size(),
+                [&] (usize index, uring::Submission& submission) {
+                    uring::prepare_statx(submission, paths[index].c_str(), &stats[index]);
+                },
+                [&] (usize index, i32 result) {
+                    if (result == -EINVAL) unsupported = true;
+                    if (result == 0 and S_ISREG(stats[index].stx_mode)) slots[index].size = i64(stats[index].stx_size);
+                }
+            );
+            if (not ran or unsupported) return false;
+
+            std::vector<i32> fds(paths.size(), -1);
+            ran = ring->run(
+                paths.size(),
+                [&] (usize index, uring::Submission& submission) {
+                    uring::prepare_open(submission, paths[index].c_str());
+                },
+                [&] (usize index, i32 result) {
+                    if (result >= 0) fds[index] = result;
+                }
+            );
+
+            ScopeExit close_files = [&] {
+                std::vector<usize> open;
+                for (usize index = 0; index < fds.size(); index += 1) {
+                    if (fds[index] >= 0) open.push_back(index);
+                }
+
+                ring->run(
+                    open.size(),
+                    [&] (usize i, uring::Submission& submission) { uring::prepare_close(submission, fds[open[i]]); },
+                    [&] (usize i, i32 result) { if (result == 0) fds[open[i]] = -1; }
+                );
+
+                // Whatever the ring did not close, say on kernels without asynchronous close, is closed here.
+                for (i32 fd : fds) {
+                    if (fd >= 0) ::close(fd);
+                }
+            };
+
+            if (not ran) return false;
+
+            for (usize index = 0; index < paths.size(); index += 1) {
+                if (fds[index] < 0) slots[index].size = -1;
+            }
+
+            char* buffer = allocate(place(slots));
+
+            // Reads can come back short, those are submitted again for the rest until every file is done.
+            std::vector<usize> pending;
+            for (usize index = 0; index < paths.size(); index += 1) {
+                if (slots[index].size > 0) pending.push_back(index);
+            }
+
+            while (not pending.empty()) {
+                std::vector<usize> next;
+
+                ran = ring->run(
+                    pending.size(),
+                    [&] (usize i, uring::Submission& submission) {
+                        auto& slot = slots[pending[i]];
+                        u64 rest = std::min<u64>(u64(slot.size) - slot.read, std::numeric_limits<i32>::max());
+                        uring::prepare_read(submission, fds[pending[i]], buffer + slot.offset + slot.read, u32(rest), slot.read);
+                    },
+                    [&] (usize i, i32 result) {
+                        auto& slot = slots[pending[i]];
+
+                        if (result > 0) {
+                            slot.read += u64(result);
+                            if (slot.read < u64(slot.size)) next.push_back(pending[i]);
+                        } else if (result == -EINTR or result == -EAGAIN) {
+                            next.push_back(pending[i]);
+                        } else if (result < 0) {
+                            slot.size = -1;
+                        }
+                    }
+                );
+
+                // The buffer is already handed out, so a failing ring can only drop the files still pending.
+                if (not ran) {
+                    for (usize index : pending) slots[index].size = -1;
+                    break;
+                }
+
+                pending = std::move(next);
+            }
+
+            return true;
+        #else
+            (void) paths, (void) slots, (void) allocate;
+            return false;
+        #endif
+        }
+    }
+
+    /// Reads a batch of source files, appending a source unit for each one that could be read in order.
+    ///
+    /// The threads and io_uring loaders read every text of the batch straight into one shared buffer.
+    inline void read_source_units(
+        std::span<const std::filesystem::path> paths,
+        std::vector<SourceUnit>& source_units,
+        Loader loader = default_loader()
+    ) {
+        if (source_units.size() + paths.size() > usize(std::numeric_limits<u16>::max()) + 1) {
+            throw std::runtime_error("too many source units");
+        }
+
+        if (loader == Loader::Sequential) {
+            for (auto const& path : paths) read_source_unit(path, source_units);
+            return;
+        }
+
+        if (loader == Loader::Mapped) {
+            for (auto const& path : paths) detail::map_source_unit(path, source_units);
+            return;
+        }
+
+        std::vector<detail::Slot> slots(paths.size());
+        std::shared_ptr<char[]> storage;
+
+        auto allocate = [&] (u64 size) -> char* {
+            storage = std::make_shared_for_overwrite<char[]>(std::max<u64>(size, 1));
+            return storage.get();
+        };
+
+        if (loader != Loader::Uring or not detail::read_with_uring(paths, slots, allocate)) {
+            std::ranges::fill(slots, detail::Slot());
+            detail::read_with_threads(paths, slots, allocate);
+        }
+
+        for (usize index = 0; index < paths.size(); index += 1) {
+            auto const& slot = slots[index];
+            if (slot.size < 0) continue;
+
+            source_units.push_back({
+                .text = std::string_view(storage.get() + slot.offset, slot.read),
+                .source = paths[index].string(),
+                .id = u16(source_units.size()),
+                .storage = storage
+            });
+            source_units.back().index_lines();
+        }
+    }
+
+    /// Reads every source file under the module paths, regardless of whether anything imports it.
+    /// The language server uses this to check the whole tree.
+    inline auto collect_all_source_units(Loader loader = default_loader()) -> std::vector<SourceUnit> {
+        std::vector<std::filesystem::path> files;
+
+        for (auto path : MODULE_PATHS) {
+            std::error_code error_code;
+            if (not std::filesystem::exists(path, error_code)) continue;
+
+            auto options = std::filesystem::directory_options::skip_permission_denied;
+            for (auto const& entry : std::filesystem::recursive_directory_iterator(path, options, error_code)) {
+                if (entry.is_regular_file() and entry.path().extension() == ".str") files.push_back(entry.path());
+            }
+        }
+
+        std::vector<SourceUnit> source_units;
+        read_source_units(files, source_units, loader);
+        return source_units;
+    }
+
+    /// Answers the source files directly inside a directory, in a stable order.
+    inline auto source_files_in(std::filesystem::path const& directory) -> std::vector<std::filesystem::path> {
+        std::vector<std::filesystem::path> files;
+
+        std::error_code error_code;
+        if (not std::filesystem::is_directory(directory, error_code)) return files;
+
+        auto options = std::filesystem::directory_options::skip_permission_denied;
+        for (auto const& entry : std::filesystem::directory_iterator(directory, options, error_code)) {
+            if (entry.is_regular_file() and entry.path().extension() == ".str") files.push_back(entry.path());
+        }
+
+        std::ranges::sort(files);
+        return files;
+    }
 
-        // for (auto residual : residuals) {
+    /// Answers the source files of a module. A module `a.b` is made of the files directly inside
+    /// the `a/b` directory of every module path.
+    inline auto module_files(Path const& module) -> std::vector<std::filesystem::path> {
+        std::vector<std::filesystem::path> files;
 
-        // }
+        for (auto root : MODULE_PATHS) {
+            std::filesystem::path directory = root;
+            for (auto component : module.split()) directory /= component.spelling();
+            files.append_range(source_files_in(directory));
+        }
 
-        return 0;
+        return files;
     }
 
-    /// A special temporary backend for the 6502 for prototyping the language in an extremely constrained environment.
-    inline i32 backend_lower_ca65(Sir& sir) {
-        // auto residuals = sir.residualize_all_annotated_as("core.Entry", "core.Export");
+    /// Answers the modules a source unit imports, without parsing it.
+    ///
+    /// Imports are the top level `import` declarations, so a token scan outside of any brackets finds all of them.
+    /// A lexer diagnostic just ends the scan early, the parser reports it later.
+    inline auto imports_of(SourceUnit const& source_unit) -> std::vector<Path> {
+        std::vector<Path> imports;
+
+        auto stream = tokenize(source_unit);
+        auto tokens = stream.get_tokens();
+        i32 depth = 0;
+
+        for (usize i = 0; i < tokens.size(); i += 1) {
+            switch (tokens[i].kind) {
+                case Token::Kind::ParenLeft:
+                case Token::Kind::BraceLeft:
+                case Token::Kind::BracketLeft: depth += 1; continue;
+                case Token::Kind::ParenRight:
+                case Token::Kind::BraceRight:
+                case Token::Kind::BracketRight: depth -= 1; continue;
+                default: break;
+            }
 
-        // for (auto residual : residuals) {
+            if (depth != 0 or tokens[i].keyword() != Keyword::Import) continue;
+            if (i + 1 == tokens.size() or not tokens[i + 1].is<Token::Identifier>()) continue;
 
-        // }
+            Path path = Symbol::from_id(tokens[i + 1].symbol);
+            i += 1;
 
-        return 0;
+            while (i + 2 < tokens.size() and tokens[i + 1].is<Token::Dot>() and tokens[i + 2].is<Token::Identifier>()) {
+                path += Symbol::from_id(tokens[i + 2].symbol);
+                i += 2;
+            }
+
+            imports.push_back(std::move(path));
+        }
+
+        return imports;
     }
-}
 
-namespace str::run {
-    inline auto collect_all_source_units() -> std::vector<SourceUnit> {
+    /// Reads only the source units reachable from the entry module.
+    ///
+    /// Starting from the files of the entry directory and the automatic imports, the import declarations
+    /// of every unit read are followed until no new modules turn up. Units are numbered in the order
+    /// they are discovered, which only depends on the imports and the file names.
+    ///
+    /// The files of every module discovered in the same round are read as one batch.
+    inline auto collect_reachable_source_units(Loader loader = default_loader()) -> std::vector<SourceUnit> {
         std::vector<SourceUnit> source_units;
+        std::unordered_set<Path, PathHash> visited;
+        std::deque<Path> queue;
 
-        for (auto path : MODULE_PATHS) {
-            std::error_code error_code;
-            if (not std::filesystem::exists(path, error_code)) continue;
+        auto request = [&] (Path module) {
+            if (visited.insert(module).second) queue.push_back(std::move(module));
+        };
 
-            auto options = std::filesystem::directory_options::skip_permission_denied;
-            for (auto const& entry : std::filesystem::recursive_directory_iterator(path, options, error_code)) {
-                if (entry.is_regular_file() and entry.path().extension() == ".str") {
-                    std::FILE* file = std::fopen(entry.path().c_str(), "rb");
+        read_source_units(source_files_in(ENTRY_PATH), source_units, loader);
+        for (auto module : AUTO_IMPORTS) request(Path(module));
 
-                    if (file) {
-                        ScopeExit scope_exit = [file] { std::fclose(file); };
+        usize scanned = 0;
 
-                        std::fseek(file, 0, SEEK_END);
-                        u32 size = std::ftell(file);
-                        std::rewind(file);
+        while (true) {
+            for (; scanned < source_units.size(); scanned += 1) {
+                for (auto& module : imports_of(source_units[scanned])) request(std::move(module));
+            }
 
-                        std::string content;
-                        content.resize(size);
-                        std::fread(content.data(), 1, size, file);
+            if (queue.empty()) break;
 
-                        source_units.push_back({
-                            .text = std::move(content),
-                            .source = entry.path().string()
-                        });
-                    }
-                }
-            }
+            // Scanning modules in queue order numbers units exactly as taking the modules one by one would.
+            std::vector<std::filesystem::path> files;
+            for (; not queue.empty(); queue.pop_front()) files.append_range(module_files(queue.front()));
+
+            read_source_units(files, source_units, loader);
         }
 
         return source_units;
     }
 
-    inline void print_compile_diagnostic(std::ostream& os, Diagnostic const& diagnostic, std::span<const SourceUnit> source_units) {
+    /// Finds source units by id or by source name without scanning them.
+    class SourceUnitIndex final {
+        std::span<const SourceUnit> source_units;
+        /// Ids are small and handed out in order, so they index a dense table. Missing ids map to `npos`.
+        std::vector<usize> by_id;
+        std::unordered_map<std::string_view, usize> by_source;
+
+        static constexpr usize npos = std::numeric_limits<usize>::max();
+
+      public:
+        explicit SourceUnitIndex(std::span<const SourceUnit> source_units) : source_units(source_units) {
+            by_source.reserve(source_units.size());
+
+            for (usize index = 0; index < source_units.size(); index += 1) {
+                auto const& unit = source_units[index];
+
+                if (unit.id >= by_id.size()) by_id.resize(usize(unit.id) + 1, npos);
+                if (by_id[unit.id] == npos) by_id[unit.id] = index;
+                by_source.try_emplace(unit.source, index);
+            }
+        }
+
+        auto find(u16 id) const -> SourceUnit const* {
+            if (id >= by_id.size() or by_id[id] == npos) return nullptr;
+            return &source_units[by_id[id]];
+        }
+
+        auto find(std::string_view source) const -> SourceUnit const* {
+            auto entry = by_source.find(source);
+            return entry != by_source.end() ? &source_units[entry->second] : nullptr;
+        }
+    };
+
+    /// Renders a diagnostic with the source lines it points at, appending it to a buffer.
+    inline void render_compile_diagnostic(std::string& buffer, Diagnostic const& diagnostic, SourceUnitIndex const& index) {
         static constexpr auto reset = "\033[0m";
         static constexpr auto dim   = "\033[90m";
 
+        auto out = std::back_inserter(buffer);
+
         std::string_view color;
         std::string_view level;
 
@@ -5151,102 +8590,219 @@ namespace str::run {
             case Diagnostic::Severity::Runtime: color = "\033[35m"; level = "runtime"; break; // Purple
         }
 
-        std::println(os, "{}{}:{}{} {}", color, level, reset, "\033[97m", diagnostic.what());
+        std::format_to(out, "{}{}:{}{} {}\n", color, level, reset, "\033[97m", diagnostic.what());
 
         std::visit(overloaded {
             [&] (Provenance::Span const& span) {
-                auto f = span.start;
-                auto l = span.end;
-
-                std::println(os, "{}{}:{}:{}-{}:{}{}", dim, f.source, f.line, f.column - f.count + 1, l.line, l.column, reset);
-
-                u32 max_lines = 3;
-                u32 line_count = l.line - f.line + 1;
-
-                std::string_view src_text;
-                for (auto const& source_unit : source_units) {
-                    if (source_unit.source == f.source) {
-                        src_text = source_unit.text;
-                        break;
-                    }
-                }
+                auto unit = index.find(span.source);
 
-                if (src_text.empty()) {
-                    std::println(os, "");
+                if (not unit) {
+                    buffer += '\n';
                     return;
                 }
 
-                std::vector<std::string_view> lines;
-                usize line_n = 1;
-                usize pos = 0;
-
-                while (pos < src_text.size()) {
-                    usize next_nl = src_text.find('\n', pos);
-                    std::string_view line_str =
-                        next_nl == std::string_view::npos
-                            ? src_text.substr(pos)
-                            : src_text.substr(pos, next_nl - pos);
-
-                    if (line_n >= f.line) {
-                        lines.push_back(line_str);
-                    }
+                // Lines and columns are only derived here, spans just carry byte offsets.
+                auto f = unit->location(span.begin);
+                auto l = unit->location(span.last());
 
-                    if (line_n >= l.line or lines.size() >= max_lines) {
-                        break;
-                    }
+                std::format_to(out, "{}{}:{}:{}-{}:{}{}\n", dim, unit->source, f.line, f.column, l.line, l.column, reset);
 
-                    pos = next_nl == std::string_view::npos ? src_text.size() : next_nl + 1;
-                    line_n += 1;
-                }
+                u32 max_lines = 3;
+                u32 line_count = l.line - f.line + 1;
+                u32 shown = std::min(line_count, max_lines);
 
-                for (usize i = 0; i < lines.size(); i += 1) {
+                for (u32 i = 0; i < shown; i += 1) {
                     u32 curr_line = f.line + i;
-                    std::string ln_str = std::to_string(curr_line);
-                    std::string pad(ln_str.size() < 4 ? 4 - ln_str.size() : 0, ' ');
+                    std::string_view line = unit->line(curr_line);
 
-                    std::println(os, "{}{} | {}{}", dim, pad + ln_str, reset, lines[i]);
-
-                    std::print(os, "{}     | {}", dim, color);
+                    std::format_to(out, "{}{:>4} | {}{}\n", dim, curr_line, reset, line);
+                    std::format_to(out, "{}     | {}", dim, color);
 
                     if (f.line == l.line) {
-                        u32 start_col = (f.column >= f.count) ? f.column - f.count : 0;
+                        u32 start_col = f.column - 1;
                         u32 width = (l.column > start_col) ? l.column - start_col : 1;
-                        std::println(os, "{}{}", std::string(start_col, ' '), std::string(std::max(1u, width), '^'));
+                        buffer.append(start_col, ' ').append(std::max(1u, width), '^');
                     } else if (curr_line == f.line) {
-                        u32 start_col = (f.column >= f.count) ? f.column - f.count : 0;
-                        u32 width = lines[i].size() > start_col ? lines[i].size() - start_col : 1;
-                        std::println(os, "{}{}", std::string(start_col, ' '), std::string(std::max(1u, width), '^'));
+                        u32 start_col = f.column - 1;
+                        u32 width = line.size() > start_col ? line.size() - start_col : 1;
+                        buffer.append(start_col, ' ').append(std::max(1u, width), '^');
                     } else if (curr_line == l.line) {
-                        std::println(os, "{}", std::string(l.column, '^'));
+                        buffer.append(l.column, '^');
                     } else {
-                        std::println(os, "{}", std::string(lines[i].size(), '^'));
+                        buffer.append(line.size(), '^');
                     }
-                    std::print(os, "{}", reset);
+
+                    buffer += '\n';
+                    buffer += reset;
                 }
 
-                if (line_count > max_lines) std::println(os, "{} ... | {}", dim, reset);
+                if (line_count > max_lines) std::format_to(out, "{} ... | {}\n", dim, reset);
 
-                std::println(os, "");
+                buffer += '\n';
             },
             [&] (Provenance::Source const& src) {
-                std::println(os, "{}{}{}\n", dim, src.source, reset);
+                auto unit = index.find(src.source);
+                std::format_to(out, "{}{}{}\n\n", dim, unit ? std::string_view(unit->source) : "<unknown>", reset);
             }
         }, diagnostic.provenance.data);
     }
 
+    /// Renders any number of diagnostics into one buffer, so that they are written out in a single call
+    /// instead of a few unbuffered writes per line.
+    class DiagnosticWriter final {
+        SourceUnitIndex index;
+        std::string buffer;
+
+      public:
+        explicit DiagnosticWriter(std::span<const SourceUnit> source_units) : index(source_units) {}
+
+        void add(Diagnostic const& diagnostic) {
+            render_compile_diagnostic(buffer, diagnostic, index);
+        }
+
+        void add(std::span<const Diagnostic> diagnostics) {
+            for (auto const& diagnostic : diagnostics) add(diagnostic);
+        }
+
+        /// Writes out and clears everything rendered so far.
+        void flush(std::ostream& os) {
+            os.write(buffer.data(), std::streamsize(buffer.size()));
+            os.flush();
+            buffer.clear();
+        }
+    };
+
+    /// Prints a single diagnostic, prefer a `DiagnosticWriter` for more than one.
+    inline void print_compile_diagnostic(std::ostream& os, Diagnostic const& diagnostic, std::span<const SourceUnit> source_units) {
+        DiagnosticWriter writer(source_units);
+        writer.add(diagnostic);
+        writer.flush(os);
+    }
+
+    /// Options of the run subcommand.
+    struct Options final {
+        /// The number of threads used to parse source units.
+        usize jobs = 1;
+        /// Defers parsing function and initializer bodies until the evaluator asks for them.
+        bool lazy_bodies = false;
+        /// Reuses the trees of unchanged source units from the on-disk parse cache.
+        bool cache = true;
+        /// How source files are read.
+        Loader loader = default_loader();
+        /// Prints how long each phase took once the run is over.
+        bool time_report = false;
+        /// Where to write a Chrome trace of every phase once the run is over.
+        std::optional<std::string> trace;
+        /// Where to write every statistic as JSON once the run is over, standard error if the path is empty.
+        std::optional<std::string> stats;
+    };
+
+    /// Parses the arguments following the run subcommand.
+    inline auto parse_options(std::span<const std::string_view> args) -> std::expected<Options, std::string> {
+        Options options;
+
+        for (usize i = 0; i < args.size(); i += 1) {
+            auto arg = args[i];
+
+            if (arg == "--lazy-bodies") {
+                options.lazy_bodies = true;
+            } else if (arg == "--no-cache") {
+                options.cache = false;
+            } else if (arg == "--mmap") {
+                options.loader = Loader::Mapped;
+            } else if (arg == "--time-report") {
+                options.time_report = true;
+            } else if (arg.starts_with("--trace=")) {
+                options.trace = std::string(arg.substr(8));
+                if (options.trace->empty()) return std::unexpected("expected a file name after --trace=");
+            } else if (arg == "--stats") {
+                options.stats = "";
+            } else if (arg.starts_with("--stats=")) {
+                options.stats = std::string(arg.substr(8));
+                if (options.stats->empty()) return std::unexpected("expected a file name after --stats=");
+            } else if (arg.starts_with("-j")) {
+                auto value = arg.substr(2);
+                if (value.empty()) {
+                    if (i + 1 == args.size()) return std::unexpected("expected a thread count after -j");
+                    value = args[++i];
+                }
+
+                auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.jobs);
+                if (error != std::errc() or end != value.data() + value.size() or options.jobs == 0) {
+                    return std::unexpected(std::format("invalid thread count '{}'", value));
+                }
+            } else {
+                return std::unexpected(std::format("unknown option '{}'", arg));
+            }
+        }
+
+        return options;
+    }
+
+    /// Tokenizes and parses every source unit, using up to `options.jobs` threads.
+    ///
+    /// Units are independent until they are grouped into modules, so they are parsed on a work pool
+    /// and merged afterwards in source unit order. Module contents and diagnostics come out exactly
+    /// as they would from a sequential run.
+    ///
+    /// When a cache is given, units whose text is unchanged since they were stored are loaded from it
+    /// instead of being parsed, and freshly parsed units are stored in it.
     inline auto parse_modules(
-        std::span<const SourceUnit> source_units
+        std::span<const SourceUnit> source_units,
+        Options const& options = {},
+        cache::ParseCache* cache = nullptr
     ) -> std::expected<Modules, std::vector<Diagnostic>> {
+        std::vector<std::optional<Ast>> asts(source_units.size());
+        std::vector<std::optional<Diagnostic>> failures(source_units.size());
+
+        WorkPool(options.jobs).run(source_units.size(), [&] (usize index) {
+            try {
+                auto const& source = source_units[index].source;
+                stats::unit_bytes.record(source_units[index].text.size());
+
+                if (cache) {
+                    trace::Scope trace_scope("cache load", [&] { return source; });
+                    alloc::Tag alloc_tag(alloc::Phase::Parse);
+
+                    if (auto ast = cache->load(source_units[index])) {
+                        asts[index].emplace(std::move(*ast));
+                        return;
+                    }
+                }
+
+                std::optional<TokenStream> tokens;
+                {
+                    trace::Scope trace_scope("tokenize", [&] { return source; });
+                    alloc::Tag alloc_tag(alloc::Phase::Tokenize);
+                    tokens.emplace(tokenize(source_units[index]));
+                }
+                {
+                    trace::Scope trace_scope("parse", [&] { return source; });
+                    alloc::Tag alloc_tag(alloc::Phase::Parse);
+                    asts[index].emplace(parse(*tokens, options.lazy_bodies));
+                }
+
+                tokens->record_statistics();
+
+                if (cache) {
+                    trace::Scope trace_scope("cache store", [&] { return source; });
+                    cache->store(source_units[index], *asts[index]);
+                }
+            } catch (Diagnostic& diagnostic) {
+                failures[index].emplace(std::move(diagnostic));
+            }
+        });
+
         Modules modules;
         std::vector<Diagnostic> diagnostics;
 
-        for (auto const& source_unit : source_units) {
-            try {
-                auto tokens = tokenize(source_unit.text, source_unit.source);
-                auto ast = parse(tokens);
+        for (usize index = 0; index < source_units.size(); index += 1) {
+            if (asts[index]) {
+                auto& ast = *asts[index];
+                if (stats::enabled) stats::count_nodes(ast.get_decls());
                 modules[ast.module].emplace_back(std::move(ast));
-            } catch (Diagnostic& diagnostic) {
-                diagnostics.emplace_back(std::move(diagnostic));
+            } else if (failures[index]) {
+                diagnostics.emplace_back(std::move(*failures[index]));
             }
         }
 
@@ -5257,26 +8813,84 @@ namespace str::run {
         }
     }
 
+    /// Writes the time report, trace and statistics requested by the options, from everything recorded so far.
+    inline void write_reports(Options const& options) {
+        if (trace::enabled) {
+            auto events = trace::events();
+
+            if (options.time_report) trace::write_time_report(std::cerr, events);
+
+            if (options.trace) {
+                std::ofstream file(*options.trace, std::ios::binary);
+                if (file) {
+                    trace::write_chrome_trace(file, events);
+                } else {
+                    std::println(std::cerr, "error: could not write trace to '{}'", *options.trace);
+                }
+            }
+        }
+
+        if (options.stats) {
+            if (options.stats->empty()) {
+                stats::write_json(std::cerr);
+            } else if (std::ofstream file(*options.stats, std::ios::binary); file) {
+                stats::write_json(file);
+            } else {
+                std::println(std::cerr, "error: could not write statistics to '{}'", *options.stats);
+            }
+        }
+    }
+
     /// The entry point for the run subcommand.
-    inline i32 main() {
-        auto source_units = collect_all_source_units();
+    inline i32 main(std::span<const std::string_view> args) {
+        auto options = parse_options(args);
+        if (not options) {
+            std::println(std::cerr, "error: {}", options.error());
+            return -1;
+        }
+
+        if (options->time_report or options->trace) trace::start();
+        if (options->stats) stats::enabled = true;
+        ScopeExit write = [&] { write_reports(*options); };
+
+        std::vector<SourceUnit> source_units;
+        {
+            trace::Scope trace_scope("collect");
+            source_units = collect_reachable_source_units(options->loader);
+        }
+
+        std::optional<cache::ParseCache> cache;
+        if (options->cache) cache.emplace(CACHE_PATH, options->lazy_bodies);
+
+        auto modules = parse_modules(source_units, *options, cache ? &*cache : nullptr);
+        if (cache and (options->time_report or options->stats)) {
+            std::println(std::cerr, "parse cache: {} hits, {} misses", cache->get_hits(), cache->get_misses());
+        }
 
-        auto modules = parse_modules(source_units);
         if (not modules) {
-            for (auto const& diagnostic : modules.error()) {
-                print_compile_diagnostic(std::cerr, diagnostic, source_units);
-            }
+            alloc::Tag alloc_tag(alloc::Phase::Diagnostics);
+
+            DiagnosticWriter writer(source_units);
+            writer.add(modules.error());
+            writer.flush(std::cerr);
 
             return -1;
         }
 
         auto sir = evaluate(std::move(modules.value()), std::move(source_units));
 
-        for (auto const& diagnostic : sir.get_diagnostics()) {
-            print_compile_diagnostic(std::cerr, diagnostic, sir.get_source_units());
+        {
+            alloc::Tag alloc_tag(alloc::Phase::Diagnostics);
+
+            DiagnosticWriter writer(sir.get_source_units());
+            writer.add(sir.get_diagnostics());
+            writer.flush(std::cerr);
         }
 
+        if (options->time_report and sir.instantiations.size() != 0) sir.instantiations.write_report(std::cerr);
+
         if (not sir.erroneous()) {
+            trace::Scope trace_scope("execute");
             return execute(sir);
         } else {
             return -1;
@@ -5323,7 +8937,8 @@ namespace str::test {
             : Test(std::move(name)), expr(std::move(expr)), expect(std::move(expect)) {}
 
         void run() override {/*
-            auto tokens = tokenize(expr, name);
+            auto unit = SourceUnit::from_string(expr, name);
+            auto tokens = tokenize(unit);
             auto ast = Parser().parse_expr(tokens);
             auto fmt = std::format("{}", ast);
 
@@ -5340,6 +8955,308 @@ namespace str::test {
         }
     };
 
+    /// A test flattening the function bodies of a source unit and walking each flat tree back from its root.
+    struct FlatExprTest final : Test {
+        /// The source unit, with at least one function with a body.
+        std::string text;
+
+        FlatExprTest(std::string name, std::string text) : Test(std::move(name)), text(std::move(text)) {}
+
+        void run() override {
+            auto unit = SourceUnit::from_string(text, name);
+            auto tokens = tokenize(unit);
+            auto ast = parse(tokens);
+
+            usize bodies = 0;
+            for (auto const& decl : ast.get_decls()) {
+                auto fun = decl.get_as<Decl::Fun>();
+                if (not fun or not fun->body) continue;
+
+                check(fun->body->get());
+                bodies += 1;
+            }
+
+            if (bodies == 0) throw Unexpected("no function bodies to flatten\n");
+        }
+
+        auto source() -> std::string override {
+            return text;
+        }
+
+      private:
+        static void check(Expr const& expr) {
+            auto flat = FlatExpr::from(expr);
+
+            if (flat.tag(flat.root()) != expr.data.index()) throw Unexpected("the root is not the expression\n");
+
+            std::vector<u32> visits(flat.size());
+            walk(flat, flat.root(), visits);
+
+            for (FlatExpr::Index node = 0; node < flat.size(); node += 1) {
+                if (visits[node] != 1) throw Unexpected(std::format(
+                    "node {} was reached {} times from the root\n", node, visits[node]
+                ));
+            }
+        }
+
+        /// Every child must precede its parent, and every group must hold slots of its own node.
+        static void walk(FlatExpr const& flat, FlatExpr::Index node, std::vector<u32>& visits) {
+            visits[node] += 1;
+
+            auto children = flat.children(node);
+            auto modifiers = flat.modifiers(node);
+            auto groups = flat.groups(node);
+
+            for (usize slot = 0; slot < children.size(); slot += 1) {
+                bool group = modifiers[slot] & FlatExpr::Group;
+
+                if (group and (children[slot] != FlatExpr::none or slot + groups[slot] >= children.size())) {
+                    throw Unexpected(std::format("slot {} of node {} is a malformed group\n", slot, node));
+                }
+
+                if (not group and groups[slot] != 0) {
+                    throw Unexpected(std::format("slot {} of node {} has elements but is not a group\n", slot, node));
+                }
+
+                if (children[slot] == FlatExpr::none) continue;
+
+                if (children[slot] >= node) throw Unexpected(std::format(
+                    "node {} has the child {}, which does not precede it\n", node, children[slot]
+                ));
+
+                walk(flat, children[slot], visits);
+            }
+        }
+    };
+
+    /// A test of the call memo table, keyed by the functions of a source unit.
+    struct CallMemoTest final : Test {
+        /// The source unit, with at least two functions, the first of which has a body.
+        std::string text;
+
+        CallMemoTest(std::string name, std::string text) : Test(std::move(name)), text(std::move(text)) {}
+
+        void run() override {
+            using Term = Sir::Term;
+
+            auto unit = SourceUnit::from_string(text, name);
+            auto tokens = tokenize(unit);
+            auto ast = parse(tokens);
+
+            auto decls = ast.get_decls();
+            if (decls.size() < 2 or not decls[0].get_as<Decl::Fun>() or not decls[0].get_as<Decl::Fun>()->body) {
+                throw Unexpected("expected two functions, the first with a body\n");
+            }
+
+            Decl const& first = decls[0];
+            Decl const& second = decls[1];
+
+            auto expect = [] (bool condition, std::string_view what) {
+                if (not condition) throw Unexpected(std::format("{}\n", what));
+            };
+
+            Sir::TermArena terms;
+            auto pair = [&] (i64 a, i64 b) { return terms.tuple(std::array { Term::of(a), Term::of(b) }); };
+
+            // Every entry below has the same shape, so a probe tells how many bytes each one takes.
+            usize entry_bytes;
+            {
+                Sir::CallMemo probe;
+                probe.insert(terms, first, {}, std::array { pair(0, 0) }, pair(0, 0));
+                entry_bytes = probe.get_bytes();
+            }
+
+            Sir::CallMemo memo(entry_bytes * 2 + entry_bytes / 2);
+
+            expect(not memo.find(terms, first, {}, std::array { pair(1, 2) }), "an empty table answered a result");
+
+            memo.insert(terms, first, {}, std::array { pair(1, 2) }, pair(3, 3));
+            memo.insert(terms, first, {}, std::array { pair(3, 4) }, pair(7, 7));
+
+            auto result = memo.find(terms, first, {}, std::array { pair(1, 2) });
+            expect(result and terms.equal(*result, pair(3, 3)), "a remembered call missed or answered the wrong result");
+            expect(not memo.find(terms, second, {}, std::array { pair(1, 2) }), "a call of another function hit");
+            expect(not memo.find(terms, first, std::array { Term::of(i64(1)) }, std::array { pair(1, 2) }), "a call with other generics hit");
+
+            // The first call was used last, so the second one is the least recently used and goes first.
+            memo.insert(terms, first, {}, std::array { pair(5, 6) }, pair(11, 11));
+            expect(memo.get_evictions() == 1, "inserting past the cap did not evict exactly one result");
+
+            // Results are held by the table, not by the arena of the call.
+            terms.clear();
+
+            expect(not memo.find(terms, first, {}, std::array { pair(3, 4) }), "the least recently used result was not evicted");
+            result = memo.find(terms, first, {}, std::array { pair(1, 2) });
+            expect(result and terms.equal(*result, pair(3, 3)), "a result did not survive clearing the arena");
+            result = memo.find(terms, first, {}, std::array { pair(5, 6) });
+            expect(result and terms.equal(*result, pair(11, 11)), "the latest result was evicted");
+            expect(memo.get_hits() == 3 and memo.get_misses() == 4, "hits and misses were miscounted");
+
+            auto sir = evaluate({}, {});
+            Term residual = Term::residual(decls[0].get_as<Decl::Fun>()->body->get());
+            usize evaluations = 0;
+
+            auto call = [&] (std::span<const Term> arguments, Term result) {
+                return sir.memoized_call(first, {}, arguments, [&] { evaluations += 1; return result; });
+            };
+
+            call(std::array { Term::of(i64(1)) }, Term::of(i64(2)));
+            call(std::array { Term::of(i64(1)) }, Term::of(i64(2)));
+            expect(evaluations == 1, "a constant call was evaluated twice");
+
+            call(std::array { residual }, Term::of(i64(2)));
+            call(std::array { residual }, Term::of(i64(2)));
+            expect(evaluations == 3, "a call with a residual argument was remembered");
+
+            call(std::array { Term::of(i64(2)) }, residual);
+            call(std::array { Term::of(i64(2)) }, residual);
+            expect(evaluations == 5, "a call with a residual result was remembered");
+        }
+
+        auto source() -> std::string override {
+            return text;
+        }
+    };
+
+    /// A test of the type table, interning types of the first two declarations of a source unit.
+    struct TypeTableTest final : Test {
+        /// The source unit, with at least two declarations.
+        std::string text;
+
+        TypeTableTest(std::string name, std::string text) : Test(std::move(name)), text(std::move(text)) {}
+
+        void run() override {
+            using Term = Sir::Term;
+
+            auto unit = SourceUnit::from_string(text, name);
+            auto tokens = tokenize(unit);
+            auto ast = parse(tokens);
+
+            auto decls = ast.get_decls();
+            if (decls.size() < 2) throw Unexpected("expected two declarations\n");
+
+            Decl const& range = decls[0];
+            Decl const& plane = decls[1];
+
+            auto expect = [] (bool condition, std::string_view what) {
+                if (not condition) throw Unexpected(std::format("{}\n", what));
+            };
+
+            Sir::TypeTable types;
+            Sir::TermArena terms;
+            auto pair = [&] (i64 a, i64 b) { return terms.tuple(std::array { Term::of(a), Term::of(b) }); };
+
+            auto byte = types.intern(terms, range, std::array { Term::of(i64(8)) });
+            expect(byte == types.intern(terms, range, std::array { Term::of(i64(8)) }), "the same type was interned twice");
+            expect(byte != types.intern(terms, range, std::array { Term::of(i64(16)) }), "types with other arguments share an id");
+            expect(byte != types.intern(terms, plane, std::array { Term::of(i64(8)) }), "types of other declarations share an id");
+
+            auto bounded = types.intern(terms, range, std::array { pair(0, 255) });
+
+            // The table holds its own copy of the arguments, so an equal aggregate elsewhere in a cleared
+            // and refilled arena still finds the type.
+            terms.clear();
+            (void) pair(7, 7);
+            expect(bounded == types.intern(terms, range, std::array { pair(0, 255) }), "an aggregate argument was not found again");
+
+            auto const& type = types.get(bounded);
+            auto elements = type.terms.elements_of(type.arguments.at(0));
+            expect(type.decl == &range and elements.size() == 2 and elements[1] == Term::of(i64(255)), "an aggregate argument was lost");
+
+            // Concurrent interns of the same types agree on their ids. The arguments repeat every 192 indices.
+            static constexpr usize count = 4096;
+            static constexpr usize period = 192;
+
+            std::vector<Sir::TypeId> ids(count);
+            WorkPool(8).run(count, [&] (usize index) {
+                Sir::TermArena local;
+                auto argument = local.tuple(std::array { Term::of(i64(index % 64)), Term::of(i64(index % 3)) });
+                ids[index] = types.intern(local, index % 2 ? range : plane, std::array { argument });
+            });
+
+            for (usize index = 0; index < count; index += 1) {
+                expect(ids[index] == ids[index % period], "concurrent interns of the same type disagree");
+                expect(types.get(ids[index]).decl == (index % 2 ? &range : &plane), "a concurrent intern has the wrong declaration");
+            }
+
+            expect(types.size() == 4 + period, "concurrent interns created the wrong number of types");
+        }
+
+        auto source() -> std::string override {
+            return text;
+        }
+    };
+
+    /// A test of the instantiation cache, instantiating the first declaration of a source unit.
+    struct InstantiationTest final : Test {
+        /// The source unit, whose first declaration has a single generic parameter with a default.
+        std::string text;
+
+        InstantiationTest(std::string name, std::string text) : Test(std::move(name)), text(std::move(text)) {}
+
+        void run() override {
+            using Term = Sir::Term;
+
+            auto unit = SourceUnit::from_string(text, name);
+            auto tokens = tokenize(unit);
+            auto ast = parse(tokens);
+
+            auto decls = ast.get_decls();
+            if (decls.empty() or decls[0].get_generics().size() != 1 or not decls[0].get_generics()[0].default_expr) {
+                throw Unexpected("expected a declaration with a single defaulted generic parameter\n");
+            }
+
+            Decl const& decl = decls[0];
+
+            auto expect = [] (bool condition, std::string_view what) {
+                if (not condition) throw Unexpected(std::format("{}\n", what));
+            };
+
+            auto sir = evaluate({}, {});
+            auto default_size = [] (Decl::GenericParameter const&) { return Term::of(i64(64)); };
+
+            // `UInt` and `UInt<64>` spell the same instantiation.
+            auto defaulted = sir.canonical_generics(decl, {}, decl.provenance, default_size);
+            auto spelled = sir.canonical_generics(decl, std::array { std::optional(Term::of(i64(64))) }, decl.provenance, default_size);
+
+            usize builds = 0;
+            auto build = [&] (Sir::Instantiation& instantiation) {
+                builds += 1;
+                instantiation.members[Symbol("bounds")] = sir.terms.tuple(std::array { Term::of(i64(0)), Term::of(i64(255)) });
+            };
+
+            auto& first = sir.instantiate(decl, defaulted, build);
+            auto& second = sir.instantiate(decl, spelled, build);
+            expect(&first == &second and builds == 1, "a defaulted and a spelled out argument were instantiated apart");
+            expect(first.uses.load() == 2, "the uses of an instantiation were miscounted");
+
+            // Members are held by the instantiation, not by the evaluation arena.
+            sir.terms.clear();
+            auto bounds = first.terms.elements_of(first.members.at(Symbol("bounds")));
+            expect(bounds.size() == 2 and bounds[1] == Term::of(i64(255)), "a member did not survive clearing the arena");
+
+            // A build which throws leaves nothing behind, and the next use builds it again.
+            auto narrow = std::array { Term::of(i64(8)) };
+            try {
+                sir.instantiate(decl, narrow, [&] (Sir::Instantiation& instantiation) {
+                    instantiation.members[Symbol("partial")] = Term::of(i64(1));
+                    instantiation.layout.emplace();
+                    throw std::runtime_error("failed build");
+                });
+                expect(false, "a throwing build did not throw");
+            } catch (std::runtime_error const&) {}
+
+            auto& retried = sir.instantiate(decl, narrow, build);
+            expect(builds == 2 and retried.uses.load() == 1, "a failed instantiation was not built again");
+            expect(not retried.members.contains(Symbol("partial")) and not retried.layout, "a failed build left state behind");
+            expect(sir.instantiations.size() == 2, "the cache holds the wrong number of instantiations");
+        }
+
+        auto source() -> std::string override {
+            return text;
+        }
+    };
+
     inline auto tests = std::to_array<std::unique_ptr<Test>>({
         std::make_unique<ExprTest>(
             "identifier",
@@ -5350,6 +9267,54 @@ namespace str::test {
             "intrinsic",
             "#Foo()",
             "#Foo()"
+        ),
+        std::make_unique<FlatExprTest>(
+            "flat round trip",
+            "module test\n"
+            "\n"
+            "fun sample(pairs: List<of: Int>) -> Int {\n"
+            "    let (first, (second, mut third)) = pairs.split()\n"
+            "    let mut total = first\n"
+            "    for (index, (key, value)) in pairs {\n"
+            "        total = total + value * index - key\n"
+            "    }\n"
+            "    pairs match {\n"
+            "        .empty -> second\n"
+            "        .some  -> third + total\n"
+            "    }\n"
+            "}\n"
+        ),
+        std::make_unique<CallMemoTest>(
+            "call memo",
+            "module test\n"
+            "\n"
+            "fun offset(x: Int) -> Int {\n"
+            "    x + 1\n"
+            "}\n"
+            "\n"
+            "fun scale(x: Int) -> Int {\n"
+            "    x * 2\n"
+            "}\n"
+        ),
+        std::make_unique<TypeTableTest>(
+            "type table",
+            "module test\n"
+            "\n"
+            "struct Range<of: Element> {\n"
+            "    let start: Element\n"
+            "}\n"
+            "\n"
+            "struct Plane<of: Element> {\n"
+            "    let first: Element\n"
+            "}\n"
+        ),
+        std::make_unique<InstantiationTest>(
+            "instantiation cache",
+            "module test\n"
+            "\n"
+            "struct UInt<let _ size: Integer = 64> {\n"
+            "    let value: Integer\n"
+            "}\n"
         )
     });
 
@@ -5368,10 +9333,7 @@ namespace str::test {
                 failures += 1;
             } catch (Diagnostic& diagnostic) {
                 std::array<SourceUnit, 1> pseudo_units = {
-                    SourceUnit {
-                        .text = test->source(),
-                        .source = test->name
-                    }
+                    SourceUnit::from_string(test->source(), test->name)
                 };
 
                 std::println(std::cout, R"(Test {}, "{}" failed\n)", i, test->name);
@@ -0,0 +1,253 @@
+// The Strawberry Programming Language Toolchain.
+// Copyright (c) 2026 Lua (TeamPuzel)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <optional>
+#include <utility>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include "primitive.hpp"
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace str::uring {
+#if defined(__linux__)
+    /// Answers true if io_uring may be available on this platform, it can still be disabled at runtime.
+    inline constexpr bool supported = true;
+
+    using Submission = io_uring_sqe;
+
+    /// A minimal io_uring instance, a submission and completion queue shared with the kernel.
+    ///
+    /// It is driven through raw system calls so it has no dependency beyond the kernel headers.
+    /// Every submission carries the index of the operation it belongs to as its user data,
+    /// which is what completions are reported with.
+    class Ring final {
+        i32 fd = -1;
+        u32 entries = 0;
+
+        void* sq_ring = MAP_FAILED;
+        usize sq_ring_size = 0;
+        void* cq_ring = MAP_FAILED;
+        usize cq_ring_size = 0;
+        Submission* sqes = static_cast<Submission*>(MAP_FAILED);
+        usize sqes_size = 0;
+
+        u32* sq_head = nullptr;
+        u32* sq_tail = nullptr;
+        u32* sq_mask = nullptr;
+        u32* sq_array = nullptr;
+        u32* cq_head = nullptr;
+        u32* cq_tail = nullptr;
+        u32* cq_mask = nullptr;
+        io_uring_cqe* cqes = nullptr;
+
+        /// The tail of the submission queue including submissions not yet published to the kernel.
+        u32 prepared_tail = 0;
+        /// Submissions prepared but not yet handed to the kernel.
+        u32 unsubmitted = 0;
+        /// Submissions handed to the kernel whose completions were not consumed yet.
+        u32 in_flight = 0;
+
+        Ring() = default;
+
+        void release() {
+            if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+            if (cq_ring != MAP_FAILED and cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+            if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+            if (fd >= 0) close(fd);
+        }
+
+        static auto at(void* ring, u32 offset) -> u32* {
+            return reinterpret_cast<u32*>(static_cast<char*>(ring) + offset);
+        }
+
+      public:
+        /// Sets up a ring with room for a number of submissions, or answers nothing if the kernel refuses.
+        static auto create(u32 entries) -> std::optional<Ring> {
+            io_uring_params params {};
+            i32 fd = i32(syscall(__NR_io_uring_setup, entries, &params));
+            if (fd < 0) return std::nullopt;
+
+            Ring ring;
+            ring.fd = fd;
+            ring.entries = params.sq_entries;
+
+            ring.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+            ring.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) ring.sq_ring_size = ring.cq_ring_size = std::max(ring.sq_ring_size, ring.cq_ring_size);
+
+            ring.sq_ring = mmap(nullptr, ring.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (ring.sq_ring == MAP_FAILED) return std::nullopt;
+
+            ring.cq_ring = single ? ring.sq_ring : mmap(
+                nullptr, ring.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING
+            );
+            if (ring.cq_ring == MAP_FAILED) return std::nullopt;
+
+            ring.sqes_size = params.sq_entries * sizeof(Submission);
+            ring.sqes = static_cast<Submission*>(mmap(
+                nullptr, ring.sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES
+            ));
+            if (ring.sqes == MAP_FAILED) return std::nullopt;
+
+            ring.sq_head = at(ring.sq_ring, params.sq_off.head);
+            ring.sq_tail = at(ring.sq_ring, params.sq_off.tail);
+            ring.sq_mask = at(ring.sq_ring, params.sq_off.ring_mask);
+            ring.sq_array = at(ring.sq_ring, params.sq_off.array);
+            ring.cq_head = at(ring.cq_ring, params.cq_off.head);
+            ring.cq_tail = at(ring.cq_ring, params.cq_off.tail);
+            ring.cq_mask = at(ring.cq_ring, params.cq_off.ring_mask);
+            ring.cqes = reinterpret_cast<io_uring_cqe*>(static_cast<char*>(ring.cq_ring) + params.cq_off.cqes);
+            ring.prepared_tail = *ring.sq_tail;
+
+            return ring;
+        }
+
+        Ring(Ring&& other) noexcept { *this = std::move(other); }
+
+        auto operator = (Ring&& other) noexcept -> Ring& {
+            if (this != &other) {
+                release();
+                fd = std::exchange(other.fd, -1);
+                entries = other.entries;
+                sq_ring = std::exchange(other.sq_ring, MAP_FAILED);
+                sq_ring_size = other.sq_ring_size;
+                cq_ring = std::exchange(other.cq_ring, MAP_FAILED);
+                cq_ring_size = other.cq_ring_size;
+                sqes = std::exchange(other.sqes, static_cast<Submission*>(MAP_FAILED));
+                sqes_size = other.sqes_size;
+                sq_head = other.sq_head;
+                sq_tail = other.sq_tail;
+                sq_mask = other.sq_mask;
+                sq_array = other.sq_array;
+                cq_head = other.cq_head;
+                cq_tail = other.cq_tail;
+                cq_mask = other.cq_mask;
+                cqes = other.cqes;
+                prepared_tail = other.prepared_tail;
+                unsubmitted = other.unsubmitted;
+                in_flight = other.in_flight;
+            }
+            return *this;
+        }
+
+        ~Ring() { release(); }
+
+        /// Runs a batch of operations and waits for all of them to complete.
+        ///
+        /// `prepare(index, submission)` fills in the submission of every index below `count` and
+        /// `complete(index, result)` receives its result, a negated errno on failure. Operations are
+        /// kept in flight up to the capacity of the ring. Answers false if the kernel rejects the batch,
+        /// operations which were not completed by then are never reported.
+        auto run(usize count, auto&& prepare, auto&& complete) -> bool {
+            usize next = 0;
+
+            while (next < count or in_flight + unsubmitted > 0) {
+                // The completion queue is twice the size of the submission queue, so it can't overflow.
+                while (next < count and in_flight + unsubmitted < entries) {
+                    u32 index = prepared_tail & *sq_mask;
+
+                    Submission& submission = sqes[index];
+                    std::memset(&submission, 0, sizeof(submission));
+                    prepare(next, submission);
+                    submission.user_data = next;
+
+                    sq_array[index] = index;
+                    prepared_tail += 1;
+                    unsubmitted += 1;
+                    next += 1;
+                }
+
+                std::atomic_ref(*sq_tail).store(prepared_tail, std::memory_order_release);
+
+                i64 submitted = syscall(__NR_io_uring_enter, fd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (submitted < 0) {
+                    if (errno == EINTR or errno == EAGAIN or errno == EBUSY) submitted = 0; else return false;
+                }
+
+                unsubmitted -= u32(submitted);
+                in_flight += u32(submitted);
+
+                u32 head = *cq_head;
+                u32 tail = std::atomic_ref(*cq_tail).load(std::memory_order_acquire);
+
+                for (; head != tail; head += 1) {
+                    io_uring_cqe const& completion = cqes[head & *cq_mask];
+                    in_flight -= 1;
+                    complete(usize(completion.user_data), completion.res);
+                }
+
+                std::atomic_ref(*cq_head).store(head, std::memory_order_release);
+            }
+
+            return true;
+        }
+    };
+
+    /// Prepares a `statx` of a path relative to the working directory, asking for its size.
+    inline void prepare_statx(Submission& submission, char const* path, struct statx* result) {
+        submission.opcode = IORING_OP_STATX;
+        submission.fd = AT_FDCWD;
+        submission.addr = reinterpret_cast<u64>(path);
+        submission.len = STATX_SIZE;
+        submission.off = reinterpret_cast<u64>(result);
+    }
+
+    /// Prepares a read only `openat` of a path relative to the working directory.
+    inline void prepare_open(Submission& submission, char const* path) {
+        submission.opcode = IORING_OP_OPENAT;
+        submission.fd = AT_FDCWD;
+        submission.addr = reinterpret_cast<u64>(path);
+        submission.open_flags = O_RDONLY | O_CLOEXEC;
+    }
+
+    /// Prepares a read into a buffer at an offset of an open file.
+    inline void prepare_read(Submission& submission, i32 fd, char* buffer, u32 size, u64 offset) {
+        submission.opcode = IORING_OP_READ;
+        submission.fd = fd;
+        submission.addr = reinterpret_cast<u64>(buffer);
+        submission.len = size;
+        submission.off = offset;
+    }
+
+    /// Prepares closing a file descriptor.
+    inline void prepare_close(Submission& submission, i32 fd) {
+        submission.opcode = IORING_OP_CLOSE;
+        submission.fd = fd;
+    }
+#else
+    /// Answers true if io_uring may be available on this platform, it can still be disabled at runtime.
+    inline constexpr bool supported = false;
+#endif
+}
@@ -0,0 +1,589 @@
+// The Strawberry Programming Language Toolchain.
+// Copyright (c) 2026 Lua (TeamPuzel)
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#pragma once
+
+#include <iostream>
+#include <print>
+#include <sstream>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <poll.h>
+#include "strc.hpp"
+#include "primitive.hpp"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+namespace str::watch {
+    /// The outcome of a build, as printed by the daemon and sent to clients.
+    struct Report final {
+        std::string output;
+        i32 status = 0;
+    };
+
+    /// Source units and their trees kept resident between builds.
+    ///
+    /// Every file keeps the id it was first given for as long as the session lives, so the provenance of
+    /// resident trees stays valid. A build re-reads and re-parses only the files reported as changed and
+    /// files seen for the first time, then evaluates the trees reachable from the entry module.
+    /// Directory listings are cached as well, and dropped when files are created or removed in them.
+    class Session final {
+        struct Unit final {
+            SourceUnit source_unit;
+            std::optional<Ast> ast;
+            std::optional<Diagnostic> failure;
+            std::vector<Path> imports;
+            /// False once the file is gone, its id stays reserved.
+            bool present = false;
+        };
+
+        run::Options options;
+        /// Indexed by id. Trees view the paths of their units, so units must never move.
+        std::deque<Unit> units;
+        std::unordered_map<std::string, u16> ids;
+        std::unordered_set<std::string> dirty;
+        bool stale = false;
+        std::unordered_map<std::string, std::vector<std::filesystem::path>> listings;
+
+        auto files_in(std::filesystem::path const& directory) -> std::vector<std::filesystem::path> const& {
+            auto key = directory.lexically_normal().string();
+            auto it = listings.find(key);
+            if (it == listings.end()) it = listings.emplace(key, run::source_files_in(directory)).first;
+            return it->second;
+        }
+
+        static auto key_of(std::filesystem::path const& path) -> std::string {
+            return path.lexically_normal().string();
+        }
+
+        /// Reads and parses a batch of files, answering the ids of the units read.
+        auto load(std::span<const std::filesystem::path> files) -> std::vector<u16> {
+            std::vector<SourceUnit> loaded;
+            // Mapping is avoided since an editor may truncate a file while its pages are still in use.
+            run::read_source_units(files, loaded, run::default_loader());
+
+            std::vector<u16> read;
+
+            for (auto const& file : files) {
+                auto key = key_of(file);
+                auto it = ids.find(key);
+
+                if (it == ids.end()) {
+                    if (units.size() > std::numeric_limits<u16>::max()) throw std::runtime_error("too many source units");
+                    it = ids.emplace(key, u16(units.size())).first;
+                    units.emplace_back();
+                    units.back().source_unit.source = file.string();
+                    units.back().source_unit.id = it->second;
+                }
+
+                auto& unit = units[it->second];
+                unit.present = false;
+                unit.ast.reset();
+                unit.failure.reset();
+                unit.imports.clear();
+                dirty.erase(key);
+            }
+
+            for (auto& source_unit : loaded) {
+                u16 id = ids.at(key_of(source_unit.source));
+                source_unit.id = id;
+
+                auto& unit = units[id];
+                unit.source_unit = std::move(source_unit);
+                unit.present = true;
+                read.push_back(id);
+            }
+
+            WorkPool(options.jobs).run(read.size(), [&] (usize index) {
+                auto& unit = units[read[index]];
+                unit.imports = run::imports_of(unit.source_unit);
+
+                try {
+                    auto tokens = tokenize(unit.source_unit);
+                    unit.ast.emplace(parse(tokens, options.lazy_bodies));
+                } catch (Diagnostic& diagnostic) {
+                    unit.failure.emplace(std::move(diagnostic));
+                }
+            });
+
+            return read;
+        }
+
+        /// Renders the diagnostics an evaluation threw, against the resident units since the evaluation
+        /// took the source units with it.
+        void report_failure(std::ostream& output, std::span<const Diagnostic> diagnostics) const {
+            std::vector<SourceUnit> source_units;
+            for (auto const& unit : units) source_units.push_back(unit.source_unit);
+
+            run::DiagnosticWriter writer(source_units);
+            writer.add(diagnostics);
+            writer.flush(output);
+        }
+
+      public:
+        explicit Session(run::Options options) : options(options) {}
+
+        /// Marks a source file as changed, it is read again by the next build if it is still reachable.
+        void invalidate_file(std::filesystem::path const& path) {
+            dirty.insert(key_of(path));
+            stale = true;
+        }
+
+        /// Drops the cached listing of a directory after files were created or removed in it.
+        void invalidate_directory(std::filesystem::path const& path) {
+            listings.erase(key_of(path));
+            stale = true;
+        }
+
+        /// Answers true if changes arrived since the last build.
+        auto pending() const -> bool {
+            return stale;
+        }
+
+        /// Brings the resident units up to date with the files and evaluates the reachable ones.
+        auto build() -> Report {
+            auto start = std::chrono::steady_clock::now();
+            stale = false;
+
+            std::vector<u16> reachable;
+            std::unordered_set<u16> seen;
+            std::unordered_set<Path, PathHash> visited;
+            std::deque<Path> queue;
+            usize parsed = 0;
+
+            auto request = [&] (Path const& module) {
+                if (visited.insert(module).second) queue.push_back(module);
+            };
+
+            // Discovery mirrors `collect_reachable_source_units`, except that resident clean units
+            // answer their imports without touching the disk.
+            auto visit = [&] (std::vector<std::filesystem::path> const& files) {
+                std::vector<std::filesystem::path> outdated;
+
+                for (auto const& file : files) {
+                    auto key = key_of(file);
+                    auto it = ids.find(key);
+
+                    // A unit without a tree or a failure lost its tree to an evaluation that threw.
+                    bool resident = it != ids.end() and units[it->second].present and
+                        (units[it->second].ast or units[it->second].failure);
+
+                    if (not resident or dirty.contains(key)) outdated.push_back(file);
+                }
+
+                parsed += load(outdated).size();
+
+                for (auto const& file : files) {
+                    auto it = ids.find(key_of(file));
+                    if (it == ids.end() or not units[it->second].present or not seen.insert(it->second).second) continue;
+
+                    reachable.push_back(it->second);
+                    for (auto const& module : units[it->second].imports) request(module);
+                }
+            };
+
+            visit(files_in(ENTRY_PATH));
+            for (auto module : AUTO_IMPORTS) request(Path(module));
+
+            while (not queue.empty()) {
+                std::vector<std::filesystem::path> files;
+
+                for (; not queue.empty(); queue.pop_front()) {
+                    for (auto root : MODULE_PATHS) {
+                        std::filesystem::path directory = root;
+                        for (auto component : queue.front().split()) directory /= component.spelling();
+                        files.append_range(files_in(directory));
+                    }
+                }
+
+                visit(files);
+            }
+
+            // Files that changed but are no longer reachable are read again only if they become reachable.
+            std::ranges::sort(reachable);
+
+            std::ostringstream output;
+            std::vector<SourceUnit> source_units;
+            for (auto const& unit : units) source_units.push_back(unit.source_unit);
+
+            bool failed = false;
+            {
+                run::DiagnosticWriter writer(source_units);
+                for (u16 id : reachable) {
+                    if (units[id].failure) {
+                        writer.add(*units[id].failure);
+                        failed = true;
+                    }
+                }
+                writer.flush(output);
+            }
+
+            i32 status = -1;
+
+            if (not failed) {
+                // The trees are taken out of their units, so an evaluation that throws leaves them empty
+                // and the next build reads them again.
+                Modules modules;
+                for (u16 id : reachable) {
+                    auto ast = std::exchange(units[id].ast, std::nullopt);
+                    modules[ast->module].push_back(std::move(*ast));
+                }
+
+                try {
+                    auto sir = evaluate(std::move(modules), std::move(source_units));
+
+                    run::DiagnosticWriter writer(sir.get_source_units());
+                    writer.add(sir.get_diagnostics());
+                    writer.flush(output);
+
+                    status = sir.erroneous() ? -1 : execute(sir);
+
+                    for (auto& [module, asts] : std::move(sir).release_modules()) {
+                        for (auto& ast : asts) units[ids.at(key_of(ast.source))].ast.emplace(std::move(ast));
+                    }
+                } catch (Diagnostic const& diagnostic) {
+                    report_failure(output, std::span(&diagnostic, 1));
+                    status = -1;
+                } catch (Sir::DiagnosticBundle const& bundle) {
+                    report_failure(output, bundle.diagnostics);
+                    status = -1;
+                } catch (std::exception const& exception) {
+                    std::println(output, "error: the build failed: {}", exception.what());
+                    status = -1;
+                }
+            }
+
+            auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+            std::println(output, "rebuilt in {:.2f} ms, parsed {} of {} units", seconds * 1e3, parsed, reachable.size());
+
+            return { .output = std::move(output).str(), .status = status };
+        }
+    };
+
+#if defined(__linux__)
+    /// Watches the source directories with inotify.
+    ///
+    /// Every directory under the watched roots is watched on its own, since inotify is not recursive.
+    /// Directories created later are picked up as they appear.
+    class Watcher final {
+        i32 fd;
+        std::unordered_map<i32, std::filesystem::path> directories;
+
+        static constexpr u32 mask =
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR;
+
+        explicit Watcher(i32 fd) : fd(fd) {}
+
+      public:
+        static auto create() -> std::optional<Watcher> {
+            i32 fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (fd < 0) return std::nullopt;
+            return Watcher(fd);
+        }
+
+        Watcher(Watcher&& other) noexcept
+            : fd(std::exchange(other.fd, -1)), directories(std::move(other.directories)) {}
+
+        Watcher(Watcher const&) = delete;
+        auto operator = (Watcher const&) -> Watcher& = delete;
+
+        ~Watcher() {
+            if (fd >= 0) close(fd);
+        }
+
+        auto get_fd() const -> i32 { return fd; }
+
+        /// Watches a directory and every directory below it.
+        void watch_tree(std::filesystem::path const& root) {
+            std::error_code error_code;
+            if (not std::filesystem::is_directory(root, error_code)) return;
+
+            i32 wd = inotify_add_watch(fd, root.c_str(), mask);
+            if (wd >= 0) directories[wd] = root;
+
+            auto options = std::filesystem::directory_options::skip_permission_denied;
+            for (auto const& entry : std::filesystem::recursive_directory_iterator(root, options, error_code)) {
+                if (not entry.is_directory()) continue;
+
+                wd = inotify_add_watch(fd, entry.path().c_str(), mask);
+                if (wd >= 0) directories[wd] = entry.path();
+            }
+        }
+
+        /// Reads every pending event and reports changed source files and directories to the session.
+        /// Answers true if anything relevant changed.
+        auto drain(Session& session) -> bool {
+            alignas(inotify_event) char buffer[64 * 1024];
+            bool changed = false;
+
+            while (true) {
+                isize size = read(fd, buffer, sizeof(buffer));
+                if (size <= 0) break;
+
+                for (isize offset = 0; offset < size;) {
+                    auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+                    offset += isize(sizeof(inotify_event) + event->len);
+
+                    auto directory = directories.find(event->wd);
+                    if (directory == directories.end()) continue;
+
+                    if (event->mask & IN_IGNORED) {
+                        directories.erase(directory);
+                        continue;
+                    }
+
+                    if (event->len == 0) continue;
+
+                    auto path = directory->second / event->name;
+                    bool listing = event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+
+                    if (event->mask & IN_ISDIR) {
+                        if (event->mask & (IN_CREATE | IN_MOVED_TO)) watch_tree(path);
+                        // A new or removed directory may hold a whole module.
+                        session.invalidate_directory(path);
+                        changed = true;
+                    } else if (path.extension() == ".str") {
+                        if (listing) session.invalidate_directory(directory->second);
+                        session.invalidate_file(path);
+                        changed = true;
+                    }
+                }
+            }
+
+            return changed;
+        }
+    };
+#endif
+
+    /// The address of the daemon socket.
+    inline auto socket_address() -> sockaddr_un {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, WATCH_SOCKET_PATH.data(), WATCH_SOCKET_PATH.size());
+        return address;
+    }
+
+    /// Writes a whole buffer to a socket, giving up if the other side went away.
+    inline void send_all(i32 fd, std::string_view data) {
+    #if defined(MSG_NOSIGNAL)
+        static constexpr i32 flags = MSG_NOSIGNAL;
+    #else
+        static constexpr i32 flags = 0;
+    #endif
+
+        while (not data.empty()) {
+            isize sent = send(fd, data.data(), data.size(), flags);
+            if (sent <= 0) return;
+            data.remove_prefix(usize(sent));
+        }
+    }
+
+#if defined(__linux__)
+    /// Opens the daemon socket, refusing if another daemon already serves it.
+    inline auto listen_socket() -> std::expected<i32, std::string> {
+        auto address = socket_address();
+
+        i32 probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) return std::unexpected("failed to create socket");
+        bool running = connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        close(probe);
+
+        if (running) return std::unexpected(std::format("another daemon is already serving {}", WATCH_SOCKET_PATH));
+
+        // A socket file left behind by a daemon that did not shut down cleanly.
+        unlink(address.sun_path);
+
+        i32 fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return std::unexpected("failed to create socket");
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 or listen(fd, 16) != 0) {
+            close(fd);
+            return std::unexpected(std::format("failed to listen on {}", WATCH_SOCKET_PATH));
+        }
+
+        return fd;
+    }
+
+    /// Sends the report of a build to a client. The last line carries the exit status.
+    inline void serve_client(i32 fd, Report const& report) {
+        send_all(fd, report.output);
+        send_all(fd, std::format("status {}\n", report.status));
+        close(fd);
+    }
+#endif
+
+    /// Asks a running daemon for a build and prints its report, answering its status.
+    inline auto client() -> i32 {
+        auto address = socket_address();
+
+        i32 fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 or connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            if (fd >= 0) close(fd);
+            std::println(std::cerr, "error: no daemon is serving {}, start one with `strc watch`", WATCH_SOCKET_PATH);
+            return -1;
+        }
+
+        ScopeExit scope_exit = [fd] { close(fd); };
+
+        send_all(fd, "build\n");
+
+        std::string response;
+        char buffer[4096];
+        while (true) {
+            isize size = recv(fd, buffer, sizeof(buffer), 0);
+            if (size <= 0) break;
+            response.append(buffer, usize(size));
+        }
+
+        // The connection ends with the status line, anything else means the daemon died mid build.
+        std::string_view text = response;
+        if (text.ends_with('\n')) text.remove_suffix(1);
+
+        auto newline = text.rfind('\n');
+        usize line = newline == std::string_view::npos ? 0 : newline + 1;
+
+        i32 status = -1;
+        auto value = text.substr(line);
+        if (not value.starts_with("status ")) {
+            std::println(std::cerr, "error: the daemon closed the connection without a result");
+            return -1;
+        }
+
+        std::print(std::cerr, "{}", text.substr(0, line));
+        std::from_chars(value.data() + 7, value.data() + value.size(), status);
+        return status;
+    }
+
+    /// The entry point for the watch subcommand.
+    ///
+    /// It builds once, then rebuilds whenever source files change and serves the latest build to clients
+    /// connecting to the daemon socket. With `--client` it asks a running daemon for a build instead.
+    inline i32 main(std::span<const std::string_view> args) {
+        if (std::ranges::contains(args, "--client")) return client();
+
+        auto options = run::parse_options(args);
+        if (not options) {
+            std::println(std::cerr, "error: {}", options.error());
+            return -1;
+        }
+
+        // The daemon never maps sources, see `Session::load`, and runs until it is killed, so it has
+        // no point at which to write reports.
+        for (auto arg : args) {
+            if (arg == "--mmap" or arg == "--time-report" or arg.starts_with("--trace") or arg.starts_with("--stats")) {
+                std::println(std::cerr, "error: option '{}' is not supported in watch mode", arg);
+                return -1;
+            }
+        }
+
+    #if defined(__linux__)
+        static constexpr i32 quiet_period = 50;
+        static constexpr i32 client_timeout = 1000;
+
+        auto watcher = Watcher::create();
+        if (not watcher) {
+            std::println(std::cerr, "error: failed to initialize inotify");
+            return -1;
+        }
+
+        watcher->watch_tree(ENTRY_PATH);
+        for (auto root : MODULE_PATHS) {
+            if (root != ENTRY_PATH) watcher->watch_tree(root);
+        }
+
+        auto server = listen_socket();
+        if (not server) {
+            std::println(std::cerr, "error: {}", server.error());
+            return -1;
+        }
+
+        ScopeExit scope_exit = [&] {
+            close(*server);
+            unlink(std::string(WATCH_SOCKET_PATH).c_str());
+        };
+
+        Session session(*options);
+
+        Report report = session.build();
+        std::print(std::cerr, "{}", report.output);
+
+        std::array<pollfd, 2> fds = {
+            pollfd { .fd = watcher->get_fd(), .events = POLLIN, .revents = 0 },
+            pollfd { .fd = *server, .events = POLLIN, .revents = 0 }
+        };
+
+        while (true) {
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+
+            if (fds[0].revents & POLLIN) {
+                // Editors often write a file in several steps, so changes are collected until things settle.
+                watcher->drain(session);
+
+                pollfd settle { .fd = watcher->get_fd(), .events = POLLIN, .revents = 0 };
+                while (poll(&settle, 1, quiet_period) > 0) watcher->drain(session);
+            }
+
+            if (session.pending()) {
+                report = session.build();
+                std::print(std::cerr, "{}", report.output);
+            }
+
+            if (fds[1].revents & POLLIN) {
+                i32 client = accept4(*server, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client < 0) continue;
+
+                // A client which connects and then stalls must not hold up rebuilds or the other clients.
+                timeval timeout { .tv_sec = client_timeout / 1000, .tv_usec = client_timeout % 1000 * 1000 };
+                setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+                // The request line is only a handshake, every request asks for the latest build.
+                char request[64];
+                if (recv(client, request, sizeof(request), 0) <= 0) {
+                    close(client);
+                    continue;
+                }
+
+                // A change may have landed between the last poll and the request.
+                if (watcher->drain(session) or session.pending()) {
+                    report = session.build();
+                    std::print(std::cerr, "{}", report.output);
+                }
+
+                serve_client(client, report);
+            }
+        }
+
+        return 0;
+    #else
+        std::println(std::cerr, "error: watch mode relies on inotify and is only available on Linux");
+        return -1;
+    #endif
+    }
+}